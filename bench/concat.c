@@ -0,0 +1,136 @@
+// measures two kinds of concatenation:
+//
+// - long chains, `s0 + s1 + s2 + ...`, compared with another string at the
+//   end so that the result has to be put together.
+// - short templates of a few pieces each, joined pairwise with `OP_CONCAT`
+//   and at once with `OP_CONCAT_N`.
+//
+// usage: neve-bench-concat [pieces] [runs]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "chunk.h"
+#include "obj.h"
+#include "vm.h"
+
+static const int defaultPieces = 4096;
+static const int defaultRuns = 100;
+
+static const int templatePieces = 8;
+static const int templateRuns = 1000000;
+
+// every piece is this long, and distinct, so that interning doesn’t merge
+// any of them.
+#define PIECE_LENGTH 16
+
+static void writeStr(VM *vm, Chunk *ch, int i) {
+  char chars[PIECE_LENGTH + 1];
+  snprintf(chars, sizeof (chars), "piece-%010d", i);
+
+  writeConst(ch, OBJ_VAL(allocStr(vm, chars, PIECE_LENGTH)), 1);
+}
+
+// the chunk is rooted as it’s built, so it can’t be a local that’s copied
+// out afterwards.
+static void concatChunk(VM *vm, Chunk *ch, int pieces) {
+  *ch = newChunk();
+  rootChunk(vm, ch);
+
+  writeStr(vm, ch, 0);
+
+  for (int i = 1; i < pieces; i++) {
+    writeStr(vm, ch, i);
+    writeChunk(ch, OP_CONCAT, 1);
+  }
+
+  writeStr(vm, ch, 0);
+  writeChunk(ch, OP_EQ, 1);
+  writeChunk(ch, OP_RET, 1);
+}
+
+// joins `templatePieces` pieces into one short message.
+static void templateChunk(VM *vm, Chunk *ch, bool isNary) {
+  *ch = newChunk();
+  rootChunk(vm, ch);
+
+  writeStr(vm, ch, 0);
+
+  for (int i = 1; i < templatePieces; i++) {
+    writeStr(vm, ch, i);
+
+    if (!isNary) {
+      writeChunk(ch, OP_CONCAT, 1);
+    }
+  }
+
+  if (isNary) {
+    writeChunk(ch, OP_CONCAT_N, 1);
+    writeChunk(ch, (uint8_t)templatePieces, 1);
+  }
+
+  writeChunk(ch, OP_RET, 1);
+}
+
+static double timeChunk(VM *vm, Chunk *ch, int runs) {
+  const clock_t start = clock();
+
+  for (int i = 0; i < runs; i++) {
+    resetStack(vm);
+    runChunk(vm, ch);
+  }
+
+  return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+int main(const int argc, const char **argv) {
+  const int pieces = argc > 1 ? atoi(argv[1]) : defaultPieces;
+  const int runs = argc > 2 ? atoi(argv[2]) : defaultRuns;
+
+  VM vm = newVM();
+  resetStack(&vm);
+
+  Chunk ch;
+  concatChunk(&vm, &ch, pieces);
+
+  if (freopen("/dev/null", "w", stdout) == NULL) {
+    return 1;
+  }
+
+  const size_t collectionsBefore = vm.gc.collections;
+  const double elapsed = timeChunk(&vm, &ch, runs);
+
+  fprintf(
+    stderr,
+    "%d runs of %d pieces: %.3f s, %zu collections\n",
+    runs,
+    pieces,
+    elapsed,
+    vm.gc.collections - collectionsBefore
+  );
+
+  Chunk pairwise;
+  templateChunk(&vm, &pairwise, false);
+  const double pairwiseTime = timeChunk(&vm, &pairwise, templateRuns);
+
+  Chunk nary;
+  templateChunk(&vm, &nary, true);
+  const double naryTime = timeChunk(&vm, &nary, templateRuns);
+
+  fprintf(
+    stderr,
+    "%d templates of %d pieces: %.3f s pairwise, %.3f s at once\n",
+    templateRuns,
+    templatePieces,
+    pairwiseTime,
+    naryTime
+  );
+
+  freeVM(&vm);
+  freeChunk(&ch);
+  freeChunk(&pairwise);
+  freeChunk(&nary);
+
+  return 0;
+}
@@ -0,0 +1,91 @@
+// measures how fast the VM gets through short, opcode-heavy chunks.
+//
+// the chunk is assembled by hand rather than compiled from source, so that
+// nothing the compiler does to an expression can skew what we’re measuring:
+// the only thing that matters here is the dispatch loop in `run()`, and how
+// much of it the JIT gets rid of.
+//
+// usage: neve-bench-dispatch [groups] [runs]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "chunk.h"
+#include "vm.h"
+
+static const int defaultGroups = 64;
+static const int defaultRuns = 200000;
+
+// builds `1 + 7 * 3 - 20 + 7 * 3 - 20 ...`, where every group adds 1 to the
+// running total, so the numbers stay small however long the chunk gets.
+static Chunk arithChunk(int groups) {
+  Chunk ch = newChunk();
+
+  writeChunk(&ch, OP_ONE, 1);
+
+  for (int i = 0; i < groups; i++) {
+    writeConst(&ch, INT_VAL(7), 1);
+    writeConst(&ch, INT_VAL(3), 1);
+    writeChunk(&ch, OP_INT_MUL, 1);
+    writeChunk(&ch, OP_INT_ADD, 1);
+    writeConst(&ch, INT_VAL(20), 1);
+    writeChunk(&ch, OP_INT_SUB, 1);
+  }
+
+  writeChunk(&ch, OP_RET, 1);
+
+  return ch;
+}
+
+// times `runs` runs of `ch`, with or without the JIT.
+static double timeChunk(VM *vm, Chunk *ch, int runs, bool useJit) {
+  vm->useJit = useJit;
+
+  const clock_t start = clock();
+
+  for (int i = 0; i < runs; i++) {
+    resetStack(vm);
+    runChunk(vm, ch);
+  }
+
+  return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+int main(const int argc, const char **argv) {
+  const int groups = argc > 1 ? atoi(argv[1]) : defaultGroups;
+  const int runs = argc > 2 ? atoi(argv[2]) : defaultRuns;
+
+  Chunk ch = arithChunk(groups);
+  VM vm = newVM();
+
+  // every run ends with `OP_RET` printing the result; we don’t want to time
+  // the terminal.
+  if (freopen("/dev/null", "w", stdout) == NULL) {
+    return 1;
+  }
+
+  const double instrs = (double)runs * (groups * 6 + 2);
+
+  for (int useJit = 0; useJit <= 1; useJit++) {
+    const double elapsed = timeChunk(&vm, &ch, runs, useJit);
+
+    // without the JIT built in, both runs are interpreted.
+    const char *tier = !useJit ? "run()" : ch.jit != NULL ? "jit" : "run()*";
+
+    fprintf(
+      stderr,
+      "%-6s %d runs of %zu bytes: %.3f s, %.2f ns/instr\n",
+      tier,
+      runs,
+      ch.next,
+      elapsed,
+      elapsed * 1e9 / instrs
+    );
+  }
+
+  freeVM(&vm);
+  freeChunk(&ch);
+
+  return 0;
+}
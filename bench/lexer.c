@@ -0,0 +1,157 @@
+// measures how many megabytes of source a second the lexer gets through, at
+// every scan level the CPU supports.
+//
+// the source is generated rather than read, in two flavors: one that’s
+// mostly short tokens, and one that’s mostly the long runs of characters
+// the scanner skips a block at a time.  neither has to parse.
+//
+// usage: neve-bench-lexer [megabytes] [runs]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "lexer.h"
+#include "scan.h"
+
+static const int defaultMegabytes = 16;
+static const int defaultRuns = 5;
+
+typedef struct {
+  const char *name;
+
+  const char **lines;
+  size_t lineCount;
+} Corpus;
+
+// mostly short tokens, a space apart.
+static const char *denseLines[] = {
+  "    let total_count = first_value + second_value * 42\n",
+  "    # keeps track of how many items were already processed\n",
+  "    let greeting = \"hello there, this is a string literal\"\n",
+  "        if remaining_items > 0 and not is_finished then\n",
+  "            result = (previous_result << 2) | flag_mask\n",
+  "        end\n",
+  "\n",
+  "    return accumulator / 3.14159\n"
+};
+
+// mostly long runs: comments, strings, indentation and long names.
+static const char *sparseLines[] = {
+  "# this function walks the whole table, and for every entry that is still "
+  "alive, works out where it should go in the new one before moving it\n",
+  "                let message = \"the quick brown fox jumps over the lazy "
+  "dog, again and again, until someone finally stops it\"\n",
+  "                                return configuration_value_from_environment"
+  "_or_the_default_one_we_were_given\n",
+  "\n",
+  "                # TODO: none of this handles the case where the table "
+  "is empty\n"
+};
+
+#define LINES(lines) lines, sizeof (lines) / sizeof (lines[0])
+
+static const Corpus corpora[] = {
+  { "dense", LINES(denseLines) },
+  { "sparse", LINES(sparseLines) }
+};
+
+#define CORPUS_COUNT (sizeof (corpora) / sizeof (corpora[0]))
+
+static char *makeSrc(Corpus corpus, size_t size, size_t *length) {
+  char *src = malloc(size + 1);
+
+  if (src == NULL) {
+    return NULL;
+  }
+
+  size_t next = 0;
+
+  for (size_t i = 0; ; i++) {
+    const char *line = corpus.lines[i % corpus.lineCount];
+    const size_t lineLength = strlen(line);
+
+    if (next + lineLength > size) {
+      break;
+    }
+
+    memcpy(src + next, line, lineLength);
+    next += lineLength;
+  }
+
+  src[next] = '\0';
+  *length = next;
+
+  return src;
+}
+
+static size_t lexAll(const char *src) {
+  Lexer lexer = newLexer(src);
+  size_t count = 0;
+
+  while (nextTok(&lexer).type != TOK_EOF) {
+    count++;
+  }
+
+  return count;
+}
+
+static void measure(
+  const char *name,
+  const char *src,
+  size_t length,
+  int runs
+) {
+  for (int level = SCAN_SCALAR; level <= SCAN_AVX2; level++) {
+    if (!setScanLevel((ScanLevel)level)) {
+      continue;
+    }
+
+    double best = 0;
+    size_t count = 0;
+
+    for (int i = 0; i < runs; i++) {
+      const clock_t start = clock();
+      count = lexAll(src);
+
+      const double elapsed = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+      if (i == 0 || elapsed < best) {
+        best = elapsed;
+      }
+    }
+
+    const double megabytes = (double)length / (1 << 20);
+
+    fprintf(
+      stderr,
+      "%-6s %-6s %zu tokens in %.1f MB: %.3f s, %.1f MB/s\n",
+      name,
+      scanLevelName((ScanLevel)level),
+      count,
+      megabytes,
+      best,
+      megabytes / best
+    );
+  }
+}
+
+int main(const int argc, const char **argv) {
+  const int megabytes = argc > 1 ? atoi(argv[1]) : defaultMegabytes;
+  const int runs = argc > 2 ? atoi(argv[2]) : defaultRuns;
+
+  for (size_t i = 0; i < CORPUS_COUNT; i++) {
+    size_t length;
+    char *src = makeSrc(corpora[i], (size_t)megabytes << 20, &length);
+
+    if (src == NULL) {
+      return 1;
+    }
+
+    measure(corpora[i].name, src, length, runs);
+    free(src);
+  }
+
+  return 0;
+}
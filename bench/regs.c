@@ -0,0 +1,176 @@
+// compares the register VM with the stack VM on arithmetic.
+//
+// the trees are built by hand rather than parsed, since the compiler would
+// fold them into a single constant.  both VMs get code emitted from the
+// same tree, and the stack VM gets the same peephole pass as always, but
+// runs without the JIT.
+//
+// usage: neve-bench-regs [groups] [runs]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "chunk.h"
+#include "ctx.h"
+#include "emit.h"
+#include "peephole.h"
+#include "reg.h"
+#include "regemit.h"
+#include "vm.h"
+
+static const int defaultGroups = 64;
+static const int defaultRuns = 200000;
+
+static const Span noSpan = {0, 0};
+
+// `1 + 7 * 3 - 20 + 7 * 3 - 20 ...`, where every group adds 1 to the
+// running total, so the numbers stay small however long the tree gets.
+static NodeId intTree(Tree *tree, int groups) {
+  NodeId total = newInt(tree, 1, noSpan);
+
+  for (int i = 0; i < groups; i++) {
+    const NodeId seven = newInt(tree, 7, noSpan);
+    const NodeId three = newInt(tree, 3, noSpan);
+    const NodeId product = newBinOp(tree, seven, TOK_STAR, three, noSpan);
+
+    total = newBinOp(tree, total, TOK_PLUS, product, noSpan);
+    total = newBinOp(
+      tree,
+      total,
+      TOK_MINUS,
+      newInt(tree, 20, noSpan),
+      noSpan
+    );
+  }
+
+  return total;
+}
+
+// `1 * 1.5 / 3 + 1 ...`, which mixes in Ints that have to be converted.
+static NodeId floatTree(Tree *tree, int groups) {
+  NodeId total = newFloat(tree, 1, noSpan);
+
+  for (int i = 0; i < groups; i++) {
+    const NodeId half = newBinOp(
+      tree,
+      newFloat(tree, 1.5, noSpan),
+      TOK_SLASH,
+      newInt(tree, 3, noSpan),
+      noSpan
+    );
+
+    total = newBinOp(tree, total, TOK_STAR, half, noSpan);
+    total = newBinOp(
+      tree,
+      total,
+      TOK_PLUS,
+      newInt(tree, 1, noSpan),
+      noSpan
+    );
+  }
+
+  return total;
+}
+
+static size_t stackInstrs(const Chunk *ch) {
+  size_t count = 0;
+
+  for (size_t offset = 0; offset < ch->next; count++) {
+    offset += instrLength(ch->code[offset]);
+  }
+
+  return count;
+}
+
+static double timeStack(VM *vm, Chunk *ch, int runs) {
+  const clock_t start = clock();
+
+  for (int i = 0; i < runs; i++) {
+    resetStack(vm);
+    runChunk(vm, ch);
+  }
+
+  return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+static double timeRegs(VM *vm, RegChunk *rc, int runs) {
+  const clock_t start = clock();
+
+  for (int i = 0; i < runs; i++) {
+    resetStack(vm);
+    runRegs(vm, rc);
+  }
+
+  return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+static void compare(
+  VM *vm,
+  const char *name,
+  NodeId (*build)(Tree *tree, int groups),
+  int groups,
+  int runs
+) {
+  Chunk ch = newChunk();
+  RegChunk rc = newRegChunk();
+
+  // `compile()` would root it for us.
+  rootChunk(vm, &ch);
+
+  Ctx ctx = newCtx(vm, newErrMod("bench", ""), 0, &ch, MODE_OPTIMIZE);
+  const NodeId root = build(&ctx.tree, groups);
+
+  emitNode(&ctx, root);
+  emitReturn(&ctx, getLoc(&ctx.tree, root));
+  optimizeChunk(&ch);
+
+  if (!emitRegs(vm, &ctx.tree, root, &rc)) {
+    fprintf(stderr, "%s: too many values for the register VM\n", name);
+    exit(1);
+  }
+
+  const double stackTime = timeStack(vm, &ch, runs);
+  const double regsTime = timeRegs(vm, &rc, runs);
+
+  fprintf(
+    stderr,
+    "%-5s stack: %4zu instrs, %.3f s\n"
+    "%-5s regs:  %4zu instrs, %.3f s (%u registers), %.2fx as fast\n",
+    name,
+    stackInstrs(&ch),
+    stackTime,
+    name,
+    rc.count,
+    regsTime,
+    rc.regCount,
+    stackTime / regsTime
+  );
+
+  freeTokStream(&ctx.toks);
+  freeTree(&ctx.tree);
+  freeArena(&ctx.arena);
+  freeRegChunk(&rc);
+  freeChunk(&ch);
+}
+
+int main(const int argc, const char **argv) {
+  const int groups = argc > 1 ? atoi(argv[1]) : defaultGroups;
+  const int runs = argc > 2 ? atoi(argv[2]) : defaultRuns;
+
+  VM vm = newVM();
+  vm.useJit = false;
+
+  // every run ends by printing the result; we don’t want to time the
+  // terminal.
+  if (freopen("/dev/null", "w", stdout) == NULL) {
+    return 1;
+  }
+
+  compare(&vm, "int", intTree, groups, runs);
+  compare(&vm, "float", floatTree, groups, runs);
+
+  freeVM(&vm);
+
+  return 0;
+}
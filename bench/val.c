@@ -0,0 +1,107 @@
+// compares what the value representation costs on stack-heavy and
+// constant-heavy chunks.  build it once with `-DNEVE_NAN_BOXING=ON` and once
+// without to see the difference.
+//
+// usage: neve-bench-val [runs]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "chunk.h"
+#include "vm.h"
+
+static const int defaultRuns = 500;
+
+// the stack chunk is much shorter, so it gets run this many more times.
+static const int stackRunFactor = 400;
+
+// as deep as a chunk may go.
+static const int stackDepth = MAX_DEPTH;
+
+// enough distinct constants that the pool spills out of the L2 cache.
+static const int constCount = 131072;
+
+// pushes `stackDepth` values, then folds them all with `OP_FLOAT_ADD`--the
+// stack grows to its full depth on every run.
+static Chunk stackChunk() {
+  Chunk ch = newChunk();
+
+  for (int i = 0; i < stackDepth; i++) {
+    writeChunk(&ch, OP_FLOAT_ONE, 1);
+  }
+
+  for (int i = 1; i < stackDepth; i++) {
+    writeChunk(&ch, OP_FLOAT_ADD, 1);
+  }
+
+  writeChunk(&ch, OP_RET, 1);
+
+  return ch;
+}
+
+// sums `constCount` distinct constants, so every push reads a different
+// slot of the pool.
+static Chunk constChunk() {
+  Chunk ch = newChunk();
+
+  writeChunk(&ch, OP_FLOAT_ZERO, 1);
+
+  for (int i = 0; i < constCount; i++) {
+    writeConst(&ch, NUM_VAL(i + 0.5), 1);
+    writeChunk(&ch, OP_FLOAT_ADD, 1);
+  }
+
+  writeChunk(&ch, OP_RET, 1);
+
+  return ch;
+}
+
+static double timeChunk(VM *vm, Chunk *ch, int runs) {
+  const clock_t start = clock();
+
+  for (int i = 0; i < runs; i++) {
+    resetStack(vm);
+    runChunk(vm, ch);
+  }
+
+  return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+int main(const int argc, const char **argv) {
+  const int runs = argc > 1 ? atoi(argv[1]) : defaultRuns;
+
+  Chunk stack = stackChunk();
+  Chunk consts = constChunk();
+  VM vm = newVM();
+
+  if (freopen("/dev/null", "w", stdout) == NULL) {
+    return 1;
+  }
+
+  const double stackTime = timeChunk(&vm, &stack, runs * stackRunFactor);
+  const double constTime = timeChunk(&vm, &consts, runs);
+
+  fprintf(stderr, "sizeof (Val):     %zu bytes\n", sizeof (Val));
+  fprintf(stderr, "VM stack:         %zu bytes\n", sizeof (vm.stack));
+  fprintf(
+    stderr,
+    "constant pool:    %zu bytes (%zu constants)\n",
+    consts.consts.next * sizeof (Val),
+    consts.consts.next
+  );
+
+  fprintf(
+    stderr, 
+    "stack-heavy:      %.3f s (%d runs)\n", 
+    stackTime, 
+    runs * stackRunFactor
+  );
+  fprintf(stderr, "constant-heavy:   %.3f s (%d runs)\n", constTime, runs);
+
+  freeVM(&vm);
+  freeChunk(&stack);
+  freeChunk(&consts);
+
+  return 0;
+}
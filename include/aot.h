@@ -0,0 +1,12 @@
+#ifndef AOT_H
+#define AOT_H
+
+#include <stdio.h>
+
+#include "ir.h"
+
+// writes a C program that evaluates `root` and prints the result, the way
+// `OP_RET` would.  it builds against src/runtime, and nothing else.
+void lowerToC(Tree *tree, NodeId root, const char *fname, FILE *out);
+
+#endif
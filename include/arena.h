@@ -0,0 +1,22 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include "common.h"
+
+typedef struct ArenaBlock ArenaBlock;
+
+// hands out memory by bumping a pointer, and gives it all back at once.
+// for things that live exactly as long as a single compilation.
+typedef struct {
+  ArenaBlock *blocks;
+
+  char *next;
+  char *end;
+} Arena;
+
+Arena newArena();
+void freeArena(Arena *arena);
+
+void *arenaAlloc(Arena *arena, size_t size);
+
+#endif
@@ -0,0 +1,13 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include "chunk.h"
+
+// where the cache lives when `NEVE_CACHE_DIR` isn’t set, under
+// `XDG_CACHE_HOME` or else `HOME/.cache`.
+#define CACHE_DIR_NAME "neve"
+
+char *cachePath(const char *src, size_t length, uint32_t superinstrs);
+bool storeCache(Chunk *ch, const char *path);
+
+#endif
@@ -4,6 +4,10 @@
 #include "common.h"
 #include "val.h"
 
+// the most pieces a single `OP_CONCAT_N` joins.  longer chains are joined a
+// group at a time, so that they can’t take up too much of the stack.
+#define MAX_CONCAT_PIECES 64
+
 typedef enum {
   OP_CONST,
   OP_CONST_LONG,
@@ -13,28 +17,56 @@ typedef enum {
   OP_ZERO,
   OP_ONE,
   OP_MINUS_ONE,
-  OP_NEG,
+  OP_FLOAT_ZERO,
+  OP_FLOAT_ONE,
+  OP_FLOAT_MINUS_ONE,
+  OP_INT_TO_FLOAT,
+  OP_INT_TO_FLOAT_UNDER,
   OP_NOT,
   OP_IS_NIL,
   OP_IS_ZERO,
   OP_IS_MINUS_ONE,
-  OP_ADD,
-  OP_SUB,
-  OP_MUL,
-  OP_DIV,
+  OP_INT_NEG,
+  OP_INT_ADD,
+  OP_INT_SUB,
+  OP_INT_MUL,
+  OP_INT_SHL,
+  OP_INT_SHR,
+  OP_INT_BIT_AND,
+  OP_INT_BIT_XOR,
+  OP_INT_BIT_OR,
+  OP_INT_GREATER,
+  OP_INT_LESS,
+  OP_INT_GREATER_EQ,
+  OP_INT_LESS_EQ,
+  OP_FLOAT_NEG,
+  OP_FLOAT_ADD,
+  OP_FLOAT_SUB,
+  OP_FLOAT_MUL,
+  OP_FLOAT_DIV,
+  OP_FLOAT_GREATER,
+  OP_FLOAT_LESS,
+  OP_FLOAT_GREATER_EQ,
+  OP_FLOAT_LESS_EQ,
   OP_CONCAT,
+  OP_CONCAT_N,
   // OP_INTERPOL,
-  OP_SHL,
-  OP_SHR,
-  OP_BIT_AND,
-  OP_BIT_XOR,
-  OP_BIT_OR,
   OP_EQ,
   OP_NEQ,
-  OP_GREATER,
-  OP_LESS,
-  OP_GREATER_EQ,
-  OP_LESS_EQ,
+
+  // superinstructions, which do the work of two of the above in a single
+  // dispatch.  the emitter only uses them when a profile says they pay off.
+  OP_INT_ADD_CONST,
+  OP_INT_SUB_CONST,
+  OP_INT_MUL_CONST,
+  OP_FLOAT_ADD_CONST,
+  OP_FLOAT_SUB_CONST,
+  OP_FLOAT_MUL_CONST,
+  OP_FLOAT_NOT_GREATER,
+  OP_FLOAT_NOT_LESS,
+  OP_FLOAT_NOT_GREATER_EQ,
+  OP_FLOAT_NOT_LESS_EQ,
+
   OP_RET
 } OpCode;
 
@@ -50,15 +82,39 @@ typedef struct {
   Line *lines;
 } LineArr;
 
+// maps each constant to its index in the pool, so that the same value is
+// never stored twice.  a slot holds the index plus one; zero means empty.
 typedef struct {
+  size_t cap;
+  size_t count;
+
+  uint32_t *slots;
+} ConstMap;
+
+typedef struct Jit Jit;
+typedef struct VM VM;
+typedef struct Chunk Chunk;
+
+struct Chunk {
   size_t cap;
   size_t next;
 
   uint8_t *code;
   ValArr consts;
+  ConstMap constMap;
 
   LineArr lines;
-} Chunk;
+
+  // how many times the chunk has run, and the machine code it was
+  // translated to once that was more than once.  see jit.h.
+  uint32_t runs;
+  Jit *jit;
+
+  // the VM whose collections keep the constants alive, and the next chunk
+  // it keeps alive.  see `rootChunk()`.
+  VM *vm;
+  Chunk *nextRooted;
+};
 
 Chunk newChunk();
 void writeChunk(Chunk *ch, uint8_t byte, int line);
@@ -66,6 +122,19 @@ void freeChunk(Chunk *ch);
 void writeConst(Chunk *ch, Val val, int line);
 int addConst(Chunk *ch, Val val);
 
+size_t instrLength(uint8_t op);
+
+// how many values `op` takes off the stack, and how many it puts back.
+// `OP_CONCAT_N` takes as many as its operand says.
+void stackEffect(uint8_t op, const uint8_t *operands, int *pops, int *pushes);
+
+// the most values `ch` ever has on the stack at once.  the code has to be
+// well-formed: see `checkCode()` in geada.c for code that might not be.
+int chunkDepth(const Chunk *ch);
+
+ConstMap newConstMap();
+void freeConstMap(ConstMap *map);
+
 LineArr newLineArr();
 void writeLineArr(LineArr *arr, int line, size_t offset);
 void freeLineArr(LineArr *arr);
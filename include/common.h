@@ -7,7 +7,50 @@
 
 #define IGNORE(x) (void)(x)
 
+#ifndef NEVE_NO_TRACE
 #define DEBUG_EXEC
 #define DEBUG_COMPILE
+#endif
+
+// #define DEBUG_STRESS_GC
+// #define DEBUG_LOG_GC
+// #define DEBUG_PEEPHOLE
+
+// dispatching through a table of label addresses is a GNU extension, so we 
+// fall back to a plain `switch` when it isn’t available (or not wanted.)
+#if defined(__GNUC__) && !defined(NEVE_NO_COMPUTED_GOTO)
+#define COMPUTED_GOTO
+#endif
+
+// skipping over runs of characters a block at a time takes x86 intrinsics,
+// and GNU attributes to build every instruction set into one binary and pick
+// one when the lexer starts up.
+#if (                                                                        \
+  defined(__GNUC__) && defined(__x86_64__) && !defined(NEVE_NO_SIMD_LEXER)   \
+)
+#define SIMD_LEXER
+#endif
+
+// counting which opcode follows which costs a little on every dispatch, so
+// only builds meant for training runs do it.
+#ifdef NEVE_PROFILE
+#define PROFILE_OPS
+#endif
+
+// the JIT writes x86-64 code for the System V calling convention, and skips
+// everything `run()` does for tracing and profiling, so builds that want
+// those stay in the interpreter.
+#if (                                                                        \
+  defined(__GNUC__) && defined(__x86_64__) && !defined(_WIN32) &&            \
+  !defined(NEVE_NO_JIT) && !defined(DEBUG_EXEC) && !defined(PROFILE_OPS)     \
+)
+#define JIT
+#endif
+
+// squeezing values into the payload of a NaN only works when pointers fit in 
+// 48 bits, which rules out anything but 64-bit targets.
+#if defined(NEVE_NAN_BOXING) && UINTPTR_MAX == UINT64_MAX
+#define NAN_BOXING
+#endif
 
 #endif
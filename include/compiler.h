@@ -1,8 +1,11 @@
 #ifndef COMPILER_H
 #define COMPILER_H
 
+#include <stdio.h>
+
 #include "tok.h"
 #include "chunk.h"
+#include "reg.h"
 #include "vm.h"
 
 #define CHECK_PANIC(ctx)                                    \
@@ -16,6 +19,18 @@
 
 #define IS_PANICKING(ctx) ((ctx)->parser.isPanicking)
 
+// part of the key of every cached chunk.  bump it whenever the same source
+// starts compiling to different code, so that stale chunks aren’t reused.
+#define COMPILER_VERSION "0.0.0-20211225.2"
+
+// `MODE_DIRECT` emits code as it parses, without building a tree or
+// optimizing anything.  it’s for when compiling quickly matters more than
+// running quickly, like in the REPL.
+typedef enum {
+  MODE_OPTIMIZE,
+  MODE_DIRECT
+} CompileMode;
+
 typedef struct {
   Tok curr;
   Tok prev;
@@ -25,6 +40,33 @@ typedef struct {
 
 Parser newParser();
 
-bool compile(VM *vm, const char *fname, const char *src, Chunk *ch);
+// `src` is `srcLength` characters long, and followed by a '\0'.
+bool compile(
+  VM *vm,
+  const char *fname,
+  const char *src,
+  size_t srcLength,
+  Chunk *ch,
+  CompileMode mode
+);
+
+// like `compile()`, but for the register VM.  an expression with more
+// values than fit in its frame is reported as an error.
+bool compileRegs(
+  VM *vm,
+  const char *fname,
+  const char *src,
+  size_t srcLength,
+  RegChunk *rc
+);
+
+// writes a C program to `out` that does what running `src` would, for
+// `neve --aot`.  nothing is written if `src` doesn’t compile.
+bool compileToC(
+  const char *fname,
+  const char *src,
+  size_t srcLength,
+  FILE *out
+);
 
 #endif
@@ -1,21 +1,44 @@
 #ifndef CTX_H
 #define CTX_H
 
+#include "arena.h"
 #include "compiler.h"
 #include "err.h"
-#include "lexer.h"
-#include "type.h"
+#include "ir.h"
+#include "stream.h"
 #include "vm.h"
 
 typedef struct {
   VM *vm;
   ErrMod errMod;
   Parser parser;
-  Lexer lexer;
+  TokStream toks;
   Chunk *currCh;
-  TypeTable *types;
+  CompileMode mode;
+
+  // where the last instruction we emitted starts, so that the next one can
+  // be fused with it.
+  size_t lastInstr;
+
+  Tree tree;
+
+  // where anything the tree points to but doesn’t own lives, like the
+  // strings folding builds.  it all goes away at once when compilation ends.
+  Arena arena;
 } Ctx;
 
-Ctx newCtx(VM *vm, ErrMod mod, Chunk *ch);
+// `srcLength` is how long `mod.src` is, so that nothing has to look for its
+// end.
+Ctx newCtx(
+  VM *vm,
+  ErrMod mod,
+  size_t srcLength,
+  Chunk *ch,
+  CompileMode mode
+);
+
+// puts the parser in panic mode, so that the errors an error causes aren’t
+// reported too.
+void markErr(Ctx *ctx);
 
 #endif
@@ -2,8 +2,16 @@
 #define DEBUG_H
 
 #include "chunk.h"
+#include "reg.h"
+
+const char *opName(uint8_t op);
 
 void disasmChunk(Chunk *ch, const char *name);
 size_t disasmInstr(Chunk *ch, size_t offset);
 
+const char *regOpName(uint8_t op);
+
+void disasmRegChunk(RegChunk *rc, const char *name);
+void disasmRegInstr(RegChunk *rc, size_t index);
+
 #endif
@@ -11,6 +11,24 @@ void emitBoth(Ctx *ctx, uint8_t one, uint8_t two, Loc loc);
 void emitConst(Ctx *ctx, Val val, Loc loc);
 void emitReturn(Ctx *ctx, Loc loc);
 
-void emitNode(Ctx *ctx, Node *node);
+void emitInt(Ctx *ctx, long value, Loc loc);
+void emitFloat(Ctx *ctx, double value, Loc loc);
+void emitStr(Ctx *ctx, StrLit lit, Loc loc);
+
+// what comes after the operands of an operation, once they’re on the stack.
+void emitUnOpcode(Ctx *ctx, UnOpType op, TypeId operandType, Loc loc);
+void emitBinOpcode(
+  Ctx *ctx,
+  TypeId leftType,
+  TokType op,
+  TypeId rightType,
+  Loc loc
+);
+
+// mixing an Int with a Float promotes the Int, and division always produces
+// a Float.
+bool isFloatOp(TypeId leftType, TokType op, TypeId rightType);
+
+void emitNode(Ctx *ctx, NodeId node);
 
 #endif
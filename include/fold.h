@@ -0,0 +1,12 @@
+#ifndef FOLD_H
+#define FOLD_H
+
+#include "ctx.h"
+#include "ir.h"
+
+// shifts only look at the lowest 6 bits of the count, like the VM’s do.
+#define SHIFT_MASK 63
+
+void foldConsts(Ctx *ctx);
+
+#endif
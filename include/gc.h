@@ -0,0 +1,48 @@
+#ifndef GC_H
+#define GC_H
+
+#include "chunk.h"
+#include "common.h"
+#include "val.h"
+
+typedef struct VM VM;
+
+typedef struct {
+  size_t bytesAllocated;
+  size_t nextGC;
+
+  // how much the heap may grow past what survived the last collection before
+  // we collect again.  it adapts to how much each collection frees.
+  double growFactor;
+
+  size_t grayCount;
+  size_t grayCap;
+  Obj **grayStack;
+
+  size_t collections;
+  size_t bytesFreed;
+
+  // in seconds.
+  double totalPause;
+  double maxPause;
+} GC;
+
+GC newGC();
+void freeGC(GC *gc);
+
+// a chunk’s constants are roots for as long as the chunk is rooted, whether
+// it’s running or not.  rooting it again is harmless, and `freeChunk()`
+// unroots it.
+void rootChunk(VM *vm, Chunk *ch);
+void unrootChunk(Chunk *ch);
+void unrootChunks(VM *vm);
+
+// accounts for an object growing from `oldSize` to `newSize` bytes, which
+// may set off a collection.
+void trackAlloc(VM *vm, size_t oldSize, size_t newSize);
+void collectGarbage(VM *vm);
+
+void markVal(GC *gc, Val val);
+void markObj(GC *gc, Obj *obj);
+
+#endif
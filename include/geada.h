@@ -0,0 +1,26 @@
+#ifndef GEADA_H
+#define GEADA_H
+
+#include "chunk.h"
+#include "vm.h"
+
+// bumped whenever the layout or the opcodes change, since a file is just the
+// chunk as the VM that wrote it understood it.
+#define GEADA_VERSION 3
+
+// a chunk loaded from a `.geada` file.  its code and its strings point
+// straight into the mapped file, so the mapping has to outlive every VM the
+// chunk was loaded into.
+typedef struct {
+  void *map;
+  size_t size;
+
+  Chunk ch;
+} Geada;
+
+bool saveGeada(Chunk *ch, const char *path);
+
+bool loadGeada(VM *vm, const char *path, Geada *file);
+void closeGeada(Geada *file);
+
+#endif
@@ -4,14 +4,22 @@
 #include "tok.h"
 #include "type.h"
 
-#define NODE_AS_INT(node)       ((node)->as.i)
-#define NODE_AS_FLOAT(node)     ((node)->as.f)
-#define NODE_AS_BOOL(node)      ((node)->as.b)
-#define NODE_AS_NIL(node)       ((node)->as.nilLoc)
-#define NODE_AS_STR(node)       ((node)->as.str)
-// #define NODE_AS_INTERPOL(node)  ((node)->as.interpol)
-#define NODE_AS_UNOP(node)      ((node)->as.unOp)
-#define NODE_AS_BINOP(node)     ((node)->as.binOp)
+#define SHOW_SPAN(tree, span) (int)((span).length), ((tree)->src + (span).start)
+
+#define NODE_TYPE(tree, node)     ((NodeType)(tree)->nodeTypes[node])
+#define NODE_VAL_TYPE(tree, node) ((tree)->valTypes[node])
+#define NODE_SPAN(tree, node)     ((tree)->spans[node])
+
+#define NODE_AS_INT(tree, node)   ((tree)->data[node].i)
+#define NODE_AS_FLOAT(tree, node) ((tree)->data[node].f)
+#define NODE_AS_BOOL(tree, node)  ((tree)->data[node].b)
+#define NODE_AS_STR(tree, node)   ((tree)->strs[(tree)->data[node].str])
+
+// `TokType` for binary operations, `UnOpType` for unary ones.
+#define NODE_OP(tree, node)       ((tree)->ops[node])
+#define NODE_LEFT(tree, node)     ((tree)->data[node].kids.left)
+#define NODE_RIGHT(tree, node)    ((tree)->data[node].kids.right)
+#define NODE_OPERAND(tree, node)  ((tree)->data[node].kids.left)
 
 typedef enum {
   NODE_INT,
@@ -32,87 +40,109 @@ typedef enum {
   UNOP_IS_NIL     = 1 << 4
 } UnOpType;
 
-typedef struct Node Node;
-
-typedef struct {
-  long value;
-  Loc loc;
-} Int;
-
-typedef struct {
-  double value;
-  Loc loc;
-} Float;
+// where a node is in the tree.  nodes are only ever appended, and always
+// after their children, so walking the tree from the first node to the last
+// one visits every child before its parent.
+typedef uint32_t NodeId;
 
+// a stretch of the source, by offset.  it’s only turned into a line and a
+// column when something needs to be reported.
 typedef struct {
-  bool value;
-  Loc loc;
-} Bool;
+  uint32_t start;
+  uint32_t length;
+} Span;
 
 typedef struct {
-  Tok str;
-  
-  bool ownsLexeme;
-} Str;
-
-/*
-typedef struct {
-  Tok str;
-  bool ownsLexeme;
-
-  Node *expr;
-  Node *next;
-} Interpol;
-*/
-
-typedef struct {
-  Tok op;
-  UnOpType opType;
-  Node *operand;
-} UnOp;
-
+  const char *chars;
+  size_t length;
+
+  // set when the characters live in the compiler’s arena instead of the
+  // source, like the result of folding two strings together.
+  bool isOwned;
+} StrLit;
+
+typedef union {
+  long i;
+  double f;
+  bool b;
+
+  // an index into the tree’s `strs`.
+  uint32_t str;
+
+  // a unary operation only uses `left`.
+  struct {
+    NodeId left;
+    NodeId right;
+  } kids;
+} NodeData;
+
+// the whole tree, one array per field.  passes that only care about one or
+// two fields don’t have to drag the rest through the cache.
 typedef struct {
-  Node *left;
-  Tok op;
-  Node *right;
-} BinOp;
-
-struct Node {
-  union {
-    Int i;
-    Float f;
-    Bool b;
-    UnOp unOp;
-    BinOp binOp;
-    Str str;
-    // Interpol interpol;
-
-    Loc nilLoc;
-  } as;
-
-  NodeType type;
-  Type valType;
-};
-
-Node *newInt(TypeTable *table, long value, Loc loc);
-Node *newFloat(TypeTable *table, double value, Loc loc);
-Node *newBool(TypeTable *table, bool value, Loc loc);
-Node *newNil(TypeTable *table, Loc loc);
-Node *newStr(TypeTable *table, Tok tok);
-Node *newInterpol(TypeTable *table, Tok tok, Node *expr, Node *next);
-Node *newUnOp(TypeTable *table, Tok op, UnOpType type, Node *operand);
-Node *newBinOp(TypeTable *table, Node *left, Tok op, Node *right);
-
-void freeNode(Node *node);
-
-// we could keep this function in type.h instead, but that would just create 
-// some recursive dependencies.
-Type inferType(TypeTable *table, Node *node);
-
-bool checkType(Node *node, TypeKind kind);
-bool isNum(Node *node);
-
-Loc getLoc(Node *node);
-Loc getFullLoc(Node *node);
+  const char *src;
+  size_t srcLength;
+
+  size_t cap;
+  size_t count;
+
+  uint8_t *nodeTypes;
+  TypeId *valTypes;
+  uint8_t *ops;
+  NodeData *data;
+  Span *spans;
+
+  size_t strCap;
+  size_t strCount;
+  StrLit *strs;
+
+  // where every line of `src` starts.  built the first time a span is turned
+  // into a `Loc`.
+  size_t lineCap;
+  size_t lineCount;
+  uint32_t *lineStarts;
+} Tree;
+
+Tree newTree(const char *src, size_t srcLength);
+void freeTree(Tree *tree);
+
+NodeId newInt(Tree *tree, long value, Span span);
+NodeId newFloat(Tree *tree, double value, Span span);
+NodeId newBool(Tree *tree, bool value, Span span);
+NodeId newNil(Tree *tree, Span span);
+NodeId newStr(
+  Tree *tree,
+  const char *chars,
+  size_t length,
+  bool isOwned,
+  Span span
+);
+NodeId newUnOp(Tree *tree, UnOpType op, NodeId operand, Span span);
+NodeId newBinOp(Tree *tree, NodeId left, TokType op, NodeId right, Span span);
+
+// adds a string to `tree` without a node of its own, and returns its index.
+uint32_t addStrLit(
+  Tree *tree,
+  const char *chars,
+  size_t length,
+  bool isOwned
+);
+
+// the node `tree` was built up to.
+NodeId rootNode(Tree *tree);
+
+// the type an operation produces, given the types of its operands.
+TypeId inferUnOp(UnOpType op, TypeId operandType);
+TypeId inferBinOp(TypeId leftType, TokType op, TypeId rightType);
+
+bool checkType(Tree *tree, NodeId node, TypeId type);
+bool isNum(Tree *tree, NodeId node);
+
+Span tokSpan(Tree *tree, Tok tok);
+Span mergeSpans(Span left, Span right);
+Span getFullSpan(Tree *tree, NodeId node);
+
+Loc spanLoc(Tree *tree, Span span);
+Loc getLoc(Tree *tree, NodeId node);
+Loc getFullLoc(Tree *tree, NodeId node);
 
 #endif
@@ -0,0 +1,41 @@
+#ifndef JIT_H
+#define JIT_H
+
+#include "chunk.h"
+#include "vm.h"
+
+// how many times a chunk has to run before it’s translated.  the first run
+// is always interpreted: translating costs more than a single run saves.
+#define JIT_THRESHOLD 2
+
+// called with the VM and its stack top, which it leaves like `run()` would.
+typedef Aftermath (*Native)(VM *vm, Val *stackTop);
+
+// a chunk translated to x86-64 machine code.  every instruction becomes a
+// few native ones working on the VM’s stack, with no dispatch in between;
+// the ones that allocate, compare or print call back into C.
+struct Jit {
+  Native native;
+
+  void *map;
+  size_t mapSize;
+
+  // the most values the code has on the stack at once, counted from the
+  // stack top it starts at.  nothing checks for room while it runs.
+  int maxDepth;
+};
+
+// returns NULL when the chunk can’t be translated, in which case it should
+// be interpreted.  that’s always the case in builds without the JIT, and
+// otherwise only if the chunk is malformed or the OS won’t give us
+// executable memory.
+Jit *newJit(const Chunk *ch);
+void freeJit(Jit *jit);
+
+// whether the code has room to run from the VM’s current stack top, which
+// isn’t necessarily the bottom of the stack.  if not, it should be
+// interpreted.
+bool jitFits(VM *vm, const Jit *jit);
+Aftermath runJit(VM *vm, Jit *jit);
+
+#endif
@@ -4,6 +4,8 @@
 #include "common.h"
 #include "val.h"
 
+typedef struct VM VM;
+
 #define ALLOC(type, size)                                   \
   (type *)reallocate(NULL, 0, sizeof (type) * (size))
 
@@ -21,6 +23,6 @@
   reallocate(ptr, sizeof (type) * (oldSize), 0)
 
 void *reallocate(void *ptr, size_t oldSize, size_t newSize);
-void freeObjs(Obj *objs);
+void freeObjs(VM *vm, Obj *objs);
 
 #endif
@@ -9,13 +9,19 @@
 
 #define VAL_AS_STR(val)   ((ObjStr *)VAL_AS_OBJ(val))
 #define VAL_AS_CSTR(val)  (((ObjStr *)VAL_AS_OBJ(val))->chars)
+#define VAL_AS_ROPE(val)  ((ObjRope *)VAL_AS_OBJ(val))
+
+#define IS_VAL_STR(val)   (IS_VAL_OBJ(val) && OBJ_TYPE(val) == OBJ_STR)
+#define IS_VAL_ROPE(val)  (IS_VAL_OBJ(val) && OBJ_TYPE(val) == OBJ_ROPE)
 
 typedef enum {
-  OBJ_STR
+  OBJ_STR,
+  OBJ_ROPE
 } ObjType;
 
 struct Obj {
   ObjType type;
+  bool isMarked;
 
   struct Obj *next;
 };
@@ -23,9 +29,29 @@ struct Obj {
 struct ObjStr {
   Obj obj; 
 
-  bool ownsStr;
+  uint32_t hash;
   size_t length;
+
+  // points at `inlineChars`, unless the string is borrowed: string literals
+  // point straight into the source instead of keeping a copy.
   const char *chars;
+  char inlineChars[];
+};
+
+// a Str that hasn’t been put together yet: `left` followed by `right`, each
+// either an `ObjStr` or another `ObjRope`.  concatenating ropes is O(1), and
+// the characters are only copied into one place once something needs them
+// there.
+struct ObjRope {
+  Obj obj;
+
+  size_t length;
+  Obj *left;
+  Obj *right;
+
+  // set once the rope has been flattened.  `left` and `right` are dropped
+  // then, so the pieces can be collected.
+  ObjStr *flat;
 };
 
 /*
@@ -37,11 +63,19 @@ static inline bool isObjType(Val val, ObjType type) {
 }
 */
 
-ObjStr *allocStr(VM *vm, bool ownsStr, const char *chars, size_t length);
+ObjStr *allocStr(VM *vm, const char *chars, size_t length);
+ObjStr *borrowStr(VM *vm, const char *chars, size_t length);
+ObjStr *reserveStr(VM *vm, size_t length);
+ObjStr *internStr(VM *vm, ObjStr *str);
+ObjRope *allocRope(VM *vm, Obj *left, Obj *right);
+
+size_t strLength(Obj *obj);
+char *copyChars(char *dest, Obj *obj);
+ObjStr *flattenRope(VM *vm, ObjRope *rope);
 
 void printObj(Val val);
 
-void freeObj(Obj *obj);
+void freeObj(VM *vm, Obj *obj);
 
 size_t objAsStr(const char *buffer, Obj *obj);
 
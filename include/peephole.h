@@ -0,0 +1,8 @@
+#ifndef PEEPHOLE_H
+#define PEEPHOLE_H
+
+#include "chunk.h"
+
+void optimizeChunk(Chunk *ch);
+
+#endif
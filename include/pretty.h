@@ -7,6 +7,6 @@ typedef struct {
   int indentation;
 } PrettyPrinter;
 
-void prettyPrint(Node *node);
+void prettyPrint(Tree *tree, NodeId node);
 
 #endif
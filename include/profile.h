@@ -0,0 +1,16 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include "common.h"
+
+// where profiling builds add up the opcode pairs of every run.
+#define PROFILE_PATH "neve.profile"
+
+void recordPair(uint8_t first, uint8_t second);
+bool saveProfile(const char *path);
+bool showProfile(const char *path);
+
+bool loadSuperinstrs(const char *path, uint32_t *enabled);
+bool fusePair(uint32_t enabled, uint8_t first, uint8_t second, uint8_t *fused);
+
+#endif
@@ -0,0 +1,84 @@
+#ifndef REG_H
+#define REG_H
+
+#include "chunk.h"
+#include "vm.h"
+
+// how many slots a register chunk’s frame may have, registers and constants
+// together.  the frame sits on the VM’s stack wherever its top happens to
+// be, and needs room above it for the pieces of a concatenation, which
+// `runRegs()` checks for before every run.  this only bounds what the
+// emitter may hand it.
+#define REG_FRAME_MAX (STACK_MAX / 2)
+
+// a register-based instruction set.  every instruction names where its
+// result goes and where its operands come from, so an operation takes a
+// single dispatch and never moves its operands around.
+typedef enum {
+  REG_MOVE,
+  REG_INT_TO_FLOAT,
+  REG_NOT,
+  REG_IS_NIL,
+  REG_IS_ZERO,
+  REG_IS_MINUS_ONE,
+  REG_INT_NEG,
+  REG_INT_ADD,
+  REG_INT_SUB,
+  REG_INT_MUL,
+  REG_INT_SHL,
+  REG_INT_SHR,
+  REG_INT_BIT_AND,
+  REG_INT_BIT_XOR,
+  REG_INT_BIT_OR,
+  REG_INT_GREATER,
+  REG_INT_LESS,
+  REG_INT_GREATER_EQ,
+  REG_INT_LESS_EQ,
+  REG_FLOAT_NEG,
+  REG_FLOAT_ADD,
+  REG_FLOAT_SUB,
+  REG_FLOAT_MUL,
+  REG_FLOAT_DIV,
+  REG_FLOAT_GREATER,
+  REG_FLOAT_LESS,
+  REG_FLOAT_GREATER_EQ,
+  REG_FLOAT_LESS_EQ,
+  REG_CONCAT,
+  REG_CONCAT_N,
+  REG_EQ,
+  REG_NEQ,
+  REG_RET
+} RegOp;
+
+// `dst = a op b`, where each of them is a slot in the frame.  unary
+// operations leave `b` unused; `REG_CONCAT_N` joins the `b` slots starting
+// at `a`, and `REG_RET` prints `a`.
+typedef struct {
+  uint8_t op;
+  uint8_t dst;
+  uint8_t a;
+  uint8_t b;
+} RegInstr;
+
+// the frame holds the registers first, then a copy of every constant, so an
+// operand is just an index into it--reading one never has to ask whether
+// it’s a register or a constant.
+typedef struct {
+  size_t cap;
+  size_t count;
+  RegInstr *code;
+
+  // a stack chunk’s pool, so that constants are shared and rooted the same
+  // way.  its code stays empty.
+  Chunk pool;
+
+  uint8_t regCount;
+} RegChunk;
+
+RegChunk newRegChunk();
+void freeRegChunk(RegChunk *rc);
+void writeRegInstr(RegChunk *rc, RegInstr instr);
+
+Aftermath runRegs(VM *vm, RegChunk *rc);
+
+#endif
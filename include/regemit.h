@@ -0,0 +1,14 @@
+#ifndef REGEMIT_H
+#define REGEMIT_H
+
+#include "ir.h"
+#include "reg.h"
+#include "vm.h"
+
+// emits `root` and everything under it as register code, ending in a
+// `REG_RET`.  the constants go in `rc->pool`, which is rooted in `vm`.
+// returns false if the registers and constants wouldn’t fit in a frame, in
+// which case `rc` is left empty.
+bool emitRegs(VM *vm, Tree *tree, NodeId root, RegChunk *rc);
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef SCAN_H
+#define SCAN_H
+
+#include "common.h"
+
+// how many characters the lexer looks at in one go when it skips over a run
+// of them.  the widest one the CPU has is picked the first time a lexer is
+// made.
+typedef enum {
+  SCAN_SCALAR,
+  SCAN_SSE2,
+  SCAN_AVX2
+} ScanLevel;
+
+ScanLevel bestScanLevel();
+const char *scanLevelName(ScanLevel level);
+
+// makes every lexer scan at `level` from now on.  returns false, changing
+// nothing, if the CPU can’t.
+bool setScanLevel(ScanLevel level);
+
+// each of these returns the first character from `c` on that ends the run.
+// a '\0' always does.
+
+// ' ', '\t' and '\r'.
+const char *skipSpaces(const char *c);
+
+// anything up to the end of the line.
+const char *skipLine(const char *c);
+
+// anything but '"', '#' and '\n', which the lexer has to deal with itself.
+const char *skipStrChars(const char *c);
+
+// letters, digits and '_'.
+const char *skipIdChars(const char *c);
+
+#endif
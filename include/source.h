@@ -0,0 +1,23 @@
+#ifndef SOURCE_H
+#define SOURCE_H
+
+#include "common.h"
+
+// a source file, as the lexer sees it.  `chars` is always followed by a
+// '\0', which is where the lexer stops.
+typedef struct {
+  const char *chars;
+  size_t length;
+
+  // set when `chars` points into a mapping of the file, instead of a buffer
+  // we read it into.  tokens and borrowed strings point straight into it, so
+  // it has to outlive every chunk compiled from it.
+  void *map;
+  size_t mapSize;
+} Source;
+
+// `-` is the standard input.  on failure, `errno` says why.
+bool openSource(const char *path, Source *src);
+void closeSource(Source *src);
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef STREAM_H
+#define STREAM_H
+
+#include "lexer.h"
+
+// how many tokens the stream lexes whenever it runs out.
+#define STREAM_BLOCK 256
+
+// the tokens of a source, lexed a block at a time into one buffer, so that
+// the lexer runs in a tight loop and the parser can look as far ahead as it
+// likes.  newlines are left out unless they were asked for.
+typedef struct {
+  Lexer lexer;
+  bool keepNewlines;
+
+  size_t cap;
+  Tok *toks;
+
+  // the first token that hasn’t been consumed, and the one after the last
+  // token lexed.
+  size_t start;
+  size_t end;
+
+  // set once the lexer has given us `TOK_EOF`.
+  bool isDone;
+} TokStream;
+
+TokStream newTokStream(const char *src, bool keepNewlines);
+void freeTokStream(TokStream *stream);
+
+// the token `ahead` tokens past the next one, without consuming anything.
+// there’s always a `TOK_EOF` at the end, however far ahead that is.
+Tok peekTok(TokStream *stream, size_t ahead);
+Tok nextStreamTok(TokStream *stream);
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef TABLE_H
+#define TABLE_H
+
+#include "common.h"
+#include "val.h"
+
+typedef struct {
+  ObjStr *key;
+  Val val;
+} Entry;
+
+typedef struct {
+  size_t count;
+  size_t cap;
+
+  Entry *entries;
+} Table;
+
+Table newTable();
+void freeTable(Table *table);
+
+bool tableGet(Table *table, ObjStr *key, Val *val);
+bool tableSet(Table *table, ObjStr *key, Val val);
+bool tableDelete(Table *table, ObjStr *key);
+
+ObjStr *tableFindStr(
+  Table *table, 
+  const char *chars, 
+  size_t length, 
+  uint32_t hash
+);
+
+void tableRemoveUnmarked(Table *table);
+
+#endif
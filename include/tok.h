@@ -51,6 +51,7 @@ Loc newLoc();
 Loc mergeLocs(Loc left, Loc right);
 
 void advanceLoc(Loc *loc);
+void advanceLocBy(Loc *loc, size_t length);
 void newlineLoc(Loc *loc);
 void syncLoc(Loc *loc);
 
@@ -1,7 +1,11 @@
 #ifndef TYPE_H
 #define TYPE_H
 
-#include <stdbool.h>
+#include "common.h"
+
+// the most types a program can have, ids included.  an id has to fit in a
+// single byte, since that’s what every node keeps.
+#define MAX_TYPES (UINT8_MAX + 1)
 
 typedef enum {
   TYPE_UNKNOWN,
@@ -12,6 +16,10 @@ typedef enum {
   TYPE_STR
 } TypeKind;
 
+// an index into the type registry.  every primitive type’s id is the same as
+// its kind, so `TYPE_INT` can stand for either.
+typedef uint8_t TypeId;
+
 typedef struct {
   TypeKind kind;
   const char *name;
@@ -24,22 +32,12 @@ typedef struct {
   */
 } Type;
 
-typedef struct {
-  // replace this whole thing with a table once we can
-  Type *intType;
-  Type *floatType;
-  Type *boolType;
-  Type *nilType;
-  Type *strType;
-} TypeTable;
-
-TypeTable *allocTypeTable();
-
-bool typesMatch(Type a, Type b);
-bool isTypeKnown(Type t);
+TypeId registerType(TypeKind kind, const char *name);
 
-Type unknownType();
+const Type *getType(TypeId id);
+const char *typeName(TypeId id);
 
-void freeTypeTable(TypeTable *table);
+bool typesMatch(TypeId a, TypeId b);
+bool isTypeKnown(TypeId id);
 
 #endif
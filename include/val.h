@@ -5,38 +5,146 @@
 
 typedef struct Obj Obj;
 typedef struct ObjStr ObjStr;
+typedef struct ObjRope ObjRope;
+
+typedef enum {
+  VAL_INT,
+  VAL_NUM,
+  VAL_BOOL,
+  VAL_NIL,
+  VAL_OBJ
+} ValType;
+
+// Ints are 48 bits wide in every build, since that’s all the room a
+// NaN-boxed value has for them.  arithmetic wraps around at 48 bits, and
+// literals that don’t fit aren’t allowed.
+#define INT_WIDTH 48
+#define INT_SHIFT (64 - INT_WIDTH)
+
+// sign-extends the lower 48 bits of `val`.
+static inline int64_t wrapInt(int64_t val) {
+  return (int64_t)((uint64_t)val << INT_SHIFT) >> INT_SHIFT;
+}
+
+// whether `val` is an Int as it is, rather than once it wraps around.
+static inline bool fitsInt(int64_t val) {
+  return wrapInt(val) == val;
+}
+
+#ifdef NAN_BOXING
+
+#include <string.h>
+
+// a NaN-boxed value fits in a single 64-bit word.  any double that isn’t a
+// quiet NaN with these bits set is stored as-is; everything else lives in
+// the unused payload bits of that NaN.
+#define SIGN_BIT  ((uint64_t)0x8000000000000000)
+#define QNAN      ((uint64_t)0x7ffc000000000000)
+
+#define TAG_NIL   1
+#define TAG_FALSE 2
+#define TAG_TRUE  3
+
+// integers get the lower 48 bits of the payload, and are sign-extended back
+// when unboxed.
+#define INT_BIT   ((uint64_t)0x0001000000000000)
+#define INT_MASK  ((uint64_t)0x0000ffffffffffff)
+
+typedef uint64_t Val;
+
+#define FALSE_VAL ((Val)(QNAN | TAG_FALSE))
+#define TRUE_VAL  ((Val)(QNAN | TAG_TRUE))
+
+#define BOOL_VAL(val) ((val) ? TRUE_VAL : FALSE_VAL)
+#define NIL_VAL       ((Val)(QNAN | TAG_NIL))
+#define INT_VAL(val)  ((Val)(QNAN | INT_BIT | ((uint64_t)(val) & INT_MASK)))
+#define NUM_VAL(val)  numToVal(val)
+#define OBJ_VAL(val)  ((Val)(SIGN_BIT | QNAN | (uint64_t)(uintptr_t)(val)))
+
+#define IS_VAL_BOOL(val)  (((val) | 1) == TRUE_VAL)
+#define IS_VAL_NIL(val)   ((val) == NIL_VAL)
+#define IS_VAL_INT(val)                                                       \
+  (((val) & (SIGN_BIT | QNAN | INT_BIT)) == (QNAN | INT_BIT))
+#define IS_VAL_NUM(val)   (((val) & QNAN) != QNAN)
+#define IS_VAL_OBJ(val)   (((val) & (QNAN | SIGN_BIT)) == (QNAN | SIGN_BIT))
+
+#define VAL_AS_BOOL(val)    ((val) == TRUE_VAL)
+#define VAL_AS_INT(val)     valToInt(val)
+#define VAL_AS_NUM(val)     valToNum(val)
+#define VAL_AS_OBJ(val)     ((Obj *)(uintptr_t)((val) & ~(SIGN_BIT | QNAN)))
+
+#define VAL_TYPE(val)       valType(val)
+
+// memcpy() is the only type pun the standard blesses; compilers turn it into
+// a plain register move.
+static inline Val numToVal(double num) {
+  Val val;
+  memcpy(&val, &num, sizeof (num));
+
+  return val;
+}
+
+static inline double valToNum(Val val) {
+  double num;
+  memcpy(&num, &val, sizeof (val));
+
+  return num;
+}
+
+static inline int64_t valToInt(Val val) {
+  return wrapInt((int64_t)val);
+}
+
+static inline ValType valType(Val val) {
+  if (IS_VAL_NUM(val)) {
+    return VAL_NUM;
+  }
+
+  if (IS_VAL_INT(val)) {
+    return VAL_INT;
+  }
+
+  if (IS_VAL_OBJ(val)) {
+    return VAL_OBJ;
+  }
+
+  return IS_VAL_NIL(val) ? VAL_NIL : VAL_BOOL;
+}
+
+#else
 
 #define BOOL_VAL(val) ((Val){ VAL_BOOL, {.boolean = (val) } })
 #define NIL_VAL       ((Val){ VAL_NIL, { .num = 0 } })
+#define INT_VAL(val)  ((Val){ VAL_INT, { .integer = wrapInt(val) } })
 #define NUM_VAL(val)  ((Val){ VAL_NUM, { .num = (val) } })
 #define OBJ_VAL(val)  ((Val){ VAL_OBJ, { .obj = (Obj *)(val) } })
 
 #define IS_VAL_BOOL(val)  ((val).type == VAL_BOOL)
 #define IS_VAL_NIL(val)   ((val).type == VAL_NIL)
+#define IS_VAL_INT(val)   ((val).type == VAL_INT)
 #define IS_VAL_NUM(val)   ((val).type == VAL_NUM)
 #define IS_VAL_OBJ(val)   ((val).type == VAL_OBJ)
 
 #define VAL_AS_BOOL(val)    ((val).as.boolean)
+#define VAL_AS_INT(val)     ((val).as.integer)
 #define VAL_AS_NUM(val)     ((val).as.num)
 #define VAL_AS_OBJ(val)     ((val).as.obj)
 
-typedef enum {
-  VAL_NUM,
-  VAL_BOOL,
-  VAL_NIL,
-  VAL_OBJ
-} ValType;
+#define VAL_TYPE(val)       ((val).type)
 
 typedef struct {
   ValType type;
 
   union {
     bool boolean;
+    int64_t integer;
     double num;
     Obj *obj;
   } as;
 } Val;
 
+#endif
+
 typedef struct {
   size_t cap; 
   size_t next;
@@ -2,11 +2,17 @@
 #define VM_H
 
 #include "chunk.h"
+#include "gc.h"
+#include "table.h"
 #include "val.h"
 
 #define STACK_MAX 256
 
-typedef struct {
+// the most values a chunk may ever have on the stack.  `run()` keeps a Nil of
+// its own under them, so one slot is always taken.
+#define MAX_DEPTH (STACK_MAX - 1)
+
+struct VM {
   Chunk *ch;
   uint8_t *ip;
 
@@ -14,7 +20,20 @@ typedef struct {
   Val *stackTop;
 
   Obj *objs;
-} VM;
+  Table strs;
+  GC gc;
+
+  // every chunk whose constants are roots.  see `rootChunk()`.
+  Chunk *chunks;
+
+  // which superinstructions the emitter may use, one bit for each of the
+  // ones in profile.c.
+  uint32_t superinstrs;
+
+  // whether chunks that run more than once may be translated to machine
+  // code.  it makes no difference in builds without the JIT.
+  bool useJit;
+};
 
 typedef enum {
   AFTERMATH_OK,
@@ -22,14 +41,24 @@ typedef enum {
   AFTERMATH_RUNTIME_ERR
 } Aftermath;
 
+// these, `push()`, `pop()` and the string functions below live in
+// src/runtime, which is all a compiled program links.
 VM newVM();
 void freeVM(VM *vm);
 
 void resetStack(VM *vm);
 
 Aftermath interpret(const char *fname, VM *vm, const char *src);
+Aftermath runChunk(VM *vm, Chunk *ch);
 
 void push(VM *vm, Val val);
 Val pop(VM *vm);
 
+// what the string instructions do, for the JIT and compiled programs to call
+// into.  they work on the top of `vm->stackTop`, like the instructions
+// themselves.
+void concat(VM *vm);
+void concatN(VM *vm, uint8_t count);
+void flattenOperands(VM *vm);
+
 #endif
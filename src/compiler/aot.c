@@ -0,0 +1,551 @@
+#include <inttypes.h>
+#include <limits.h>
+#include <math.h>
+#include <string.h>
+
+#include "aot.h"
+#include "emit.h"
+
+// every value is computed into a `const` local of its own C type, so the C
+// compiler sees plain int64_t and double arithmetic.  Strs are the
+// exception: they live on the VM’s stack, like in the interpreter, where
+// the collector can find them.
+
+// what a node lowers to when its type has no local, like Nil or Str.
+#define NO_TEMP UINT32_MAX
+
+typedef uint32_t Temp;
+
+typedef struct {
+  Tree *tree;
+  FILE *out;
+
+  Temp nextTemp;
+} Lowering;
+
+static Temp lowerNode(Lowering *low, NodeId node);
+
+static TypeKind kindOf(TypeId type) {
+  return getType(type)->kind;
+}
+
+static const char *cType(TypeId type) {
+  switch (kindOf(type)) {
+    case TYPE_INT:
+      return "int64_t";
+
+    case TYPE_FLOAT:
+      return "double";
+
+    default:
+      return "bool";
+  }
+}
+
+static const char *cOperator(TokType op) {
+  switch (op) {
+    case TOK_PLUS:
+      return "+";
+
+    case TOK_MINUS:
+      return "-";
+
+    case TOK_STAR:
+      return "*";
+
+    case TOK_SLASH:
+      return "/";
+
+    case TOK_BIT_AND:
+      return "&";
+
+    case TOK_BIT_XOR:
+      return "^";
+
+    case TOK_PIPE:
+      return "|";
+
+    case TOK_GREATER:
+      return ">";
+
+    case TOK_LESS:
+      return "<";
+
+    case TOK_GREATER_EQUAL:
+      return ">=";
+
+    case TOK_EQUAL:
+      return "==";
+
+    case TOK_NEQUAL:
+      return "!=";
+
+    default:
+      return "<=";
+  }
+}
+
+// starts the declaration of a new local, up to the `=`.  the caller writes
+// the rest.
+static Temp startTemp(Lowering *low, TypeId type) {
+  const Temp temp = low->nextTemp++;
+
+  fprintf(low->out, "  const %s t%" PRIu32 " = ", cType(type), temp);
+
+  return temp;
+}
+
+static void writeTemp(Lowering *low, Temp temp, TypeId type, bool asFloat) {
+  if (asFloat && kindOf(type) == TYPE_INT) {
+    fprintf(low->out, "(double)t%" PRIu32, temp);
+  } else {
+    fprintf(low->out, "t%" PRIu32, temp);
+  }
+}
+
+// a Str the program is done with, which only has to come off the stack.
+static void dropStr(Lowering *low, TypeId type) {
+  if (kindOf(type) == TYPE_STR) {
+    fputs("  vm.stackTop--;\n", low->out);
+  }
+}
+
+// every byte that isn’t printable ASCII is escaped in octal, with all three
+// digits, so that a digit after it can’t become part of the escape.  `?` is
+// escaped too, so that nothing turns into a trigraph.
+static void writeStrLit(FILE *out, StrLit lit) {
+  fputc('"', out);
+
+  for (size_t i = 0; i < lit.length; i++) {
+    const unsigned char c = (unsigned char)lit.chars[i];
+
+    if (c == '"' || c == '\\' || c == '?') {
+      fprintf(out, "\\%c", c);
+    } else if (c >= ' ' && c <= '~') {
+      fputc(c, out);
+    } else {
+      fprintf(out, "\\%03o", c);
+    }
+  }
+
+  fputc('"', out);
+}
+
+static Temp lowerInt(Lowering *low, long value) {
+  const Temp temp = startTemp(low, TYPE_INT);
+
+  // `-9223372036854775808` is the negation of a literal that doesn’t fit.
+  if (value == LONG_MIN) {
+    fputs("WRAP(INT64_MIN);\n", low->out);
+  } else {
+    fprintf(low->out, "WRAP(INT64_C(%ld));\n", value);
+  }
+
+  return temp;
+}
+
+// hexadecimal floats are exact, but there’s no literal for infinities and
+// NaNs, so those are written as their bits.  zeroes are all positive, like
+// they are as `OP_FLOAT_ZERO`.
+static Temp lowerFloat(Lowering *low, double value) {
+  const Temp temp = startTemp(low, TYPE_FLOAT);
+
+  if (value == 0) {
+    value = 0;
+  }
+
+  if (isfinite(value)) {
+    fprintf(low->out, "%a;\n", value);
+  } else {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof (bits));
+
+    fprintf(low->out, "bitsToNum(UINT64_C(0x%016" PRIx64 "));\n", bits);
+  }
+
+  return temp;
+}
+
+static void lowerStr(Lowering *low, StrLit lit) {
+  fputs("  push(&vm, OBJ_VAL(borrowStr(&vm, ", low->out);
+  writeStrLit(low->out, lit);
+  fprintf(low->out, ", %zu)));\n", lit.length);
+}
+
+static bool isConcat(Tree *tree, NodeId node) {
+  return (
+    NODE_TYPE(tree, node) == NODE_BINOP &&
+    NODE_OP(tree, node) == TOK_PLUS &&
+    checkType(tree, node, TYPE_STR)
+  );
+}
+
+// joins Strs the way `emitConcat()` does, so that compiled programs build
+// the same ropes the interpreter would.
+static void lowerPieces(Lowering *low, NodeId node, int *count) {
+  Tree *tree = low->tree;
+
+  if (isConcat(tree, node)) {
+    lowerPieces(low, NODE_LEFT(tree, node), count);
+    lowerPieces(low, NODE_RIGHT(tree, node), count);
+    return;
+  }
+
+  lowerNode(low, node);
+
+  if (++*count == MAX_CONCAT_PIECES) {
+    fprintf(low->out, "  concatN(&vm, %d);\n", *count);
+    *count = 1;
+  }
+}
+
+static void lowerConcat(Lowering *low, NodeId node) {
+  int count = 0;
+
+  lowerPieces(low, NODE_LEFT(low->tree, node), &count);
+  lowerPieces(low, NODE_RIGHT(low->tree, node), &count);
+
+  if (count == 2) {
+    fputs("  concat(&vm);\n", low->out);
+  } else if (count > 2) {
+    fprintf(low->out, "  concatN(&vm, %d);\n", count);
+  }
+}
+
+// values of different types are never equal, and all Nils are.
+static Temp lowerEq(Lowering *low, NodeId node) {
+  Tree *tree = low->tree;
+  const NodeId left = NODE_LEFT(tree, node);
+  const NodeId right = NODE_RIGHT(tree, node);
+  const TypeId leftType = NODE_VAL_TYPE(tree, left);
+  const TypeId rightType = NODE_VAL_TYPE(tree, right);
+  const bool isEq = NODE_OP(tree, node) == TOK_EQUAL;
+
+  const Temp leftTemp = lowerNode(low, left);
+  const Temp rightTemp = lowerNode(low, right);
+
+  if (!typesMatch(leftType, rightType) || kindOf(leftType) == TYPE_NIL) {
+    dropStr(low, rightType);
+    dropStr(low, leftType);
+
+    const bool isSame = typesMatch(leftType, rightType);
+    const Temp temp = startTemp(low, TYPE_BOOL);
+
+    fprintf(low->out, "%s;\n", isSame == isEq ? "true" : "false");
+    return temp;
+  }
+
+  // ropes have to be flattened before they can be compared, just like in
+  // `run()`.
+  if (kindOf(leftType) == TYPE_STR) {
+    fputs("  flattenOperands(&vm);\n", low->out);
+
+    const Temp temp = startTemp(low, TYPE_BOOL);
+
+    fprintf(
+      low->out,
+      "%svalsEq(vm.stackTop[-2], vm.stackTop[-1]);\n",
+      isEq ? "" : "!"
+    );
+    fputs("  vm.stackTop -= 2;\n", low->out);
+
+    return temp;
+  }
+
+  const Temp temp = startTemp(low, TYPE_BOOL);
+
+  writeTemp(low, leftTemp, leftType, false);
+  fprintf(low->out, " %s ", isEq ? "==" : "!=");
+  writeTemp(low, rightTemp, rightType, false);
+  fputs(";\n", low->out);
+
+  return temp;
+}
+
+// Int arithmetic happens on the unsigned bit patterns, so that it wraps
+// around instead of being undefined, and shift counts keep their lower six
+// bits--all like `run()`.
+static void writeIntOp(
+  Lowering *low,
+  Temp left,
+  TokType op,
+  Temp right
+) {
+  FILE *out = low->out;
+
+  switch (op) {
+    case TOK_PLUS:
+    case TOK_MINUS:
+    case TOK_STAR:
+      fprintf(
+        out,
+        "WRAP((int64_t)((uint64_t)t%" PRIu32 " %s (uint64_t)t%" PRIu32 "));\n",
+        left,
+        cOperator(op),
+        right
+      );
+      break;
+
+    case TOK_SHL:
+      fprintf(
+        out,
+        "WRAP((int64_t)((uint64_t)t%" PRIu32 " << ((uint64_t)t%" PRIu32
+        " & 63)));\n",
+        left,
+        right
+      );
+      break;
+
+    case TOK_SHR:
+      fprintf(
+        out,
+        "WRAP(t%" PRIu32 " >> ((uint64_t)t%" PRIu32 " & 63));\n",
+        left,
+        right
+      );
+      break;
+
+    case TOK_BIT_AND:
+    case TOK_BIT_XOR:
+    case TOK_PIPE:
+      fprintf(
+        out,
+        "WRAP(t%" PRIu32 " %s t%" PRIu32 ");\n",
+        left,
+        cOperator(op),
+        right
+      );
+      break;
+
+    default:
+      fprintf(
+        out,
+        "t%" PRIu32 " %s t%" PRIu32 ";\n",
+        left,
+        cOperator(op),
+        right
+      );
+      break;
+  }
+}
+
+static Temp lowerBinOp(Lowering *low, NodeId node) {
+  Tree *tree = low->tree;
+  const TokType op = NODE_OP(tree, node);
+  const NodeId left = NODE_LEFT(tree, node);
+  const NodeId right = NODE_RIGHT(tree, node);
+  const TypeId leftType = NODE_VAL_TYPE(tree, left);
+  const TypeId rightType = NODE_VAL_TYPE(tree, right);
+
+  if (op == TOK_EQUAL || op == TOK_NEQUAL) {
+    return lowerEq(low, node);
+  }
+
+  if (kindOf(leftType) == TYPE_STR && kindOf(rightType) == TYPE_STR) {
+    lowerConcat(low, node);
+    return NO_TEMP;
+  }
+
+  const Temp leftTemp = lowerNode(low, left);
+  const Temp rightTemp = lowerNode(low, right);
+  const Temp temp = startTemp(low, NODE_VAL_TYPE(tree, node));
+
+  if (!isFloatOp(leftType, op, rightType)) {
+    writeIntOp(low, leftTemp, op, rightTemp);
+    return temp;
+  }
+
+  writeTemp(low, leftTemp, leftType, true);
+  fprintf(low->out, " %s ", cOperator(op));
+  writeTemp(low, rightTemp, rightType, true);
+  fputs(";\n", low->out);
+
+  return temp;
+}
+
+static Temp lowerNeg(Lowering *low, Temp operand, TypeId type) {
+  const Temp temp = startTemp(low, type);
+
+  if (kindOf(type) == TYPE_FLOAT) {
+    fprintf(low->out, "-t%" PRIu32 ";\n", operand);
+  } else {
+    fprintf(
+      low->out,
+      "WRAP((int64_t)(0 - (uint64_t)t%" PRIu32 "));\n",
+      operand
+    );
+  }
+
+  return temp;
+}
+
+// a comparison of `operand` with an Int, which is what the `UNOP_IS_*`s are.
+static Temp lowerIsInt(Lowering *low, Temp operand, long value) {
+  const Temp temp = startTemp(low, TYPE_BOOL);
+
+  fprintf(low->out, "t%" PRIu32 " == %ld;\n", operand, value);
+
+  return temp;
+}
+
+// the combined operations are applied in the same order as in
+// `emitUnOpcode()`.
+static Temp lowerUnOp(Lowering *low, NodeId node) {
+  Tree *tree = low->tree;
+  const UnOpType op = NODE_OP(tree, node);
+  const NodeId operand = NODE_OPERAND(tree, node);
+
+  Temp temp = lowerNode(low, operand);
+  TypeId type = NODE_VAL_TYPE(tree, operand);
+
+  if (op == UNOP_NOT) {
+    const Temp result = startTemp(low, TYPE_BOOL);
+
+    fprintf(low->out, "!t%" PRIu32 ";\n", temp);
+    return result;
+  }
+
+  // this one is true for anything but Nil, like `OP_IS_NIL`.
+  if (op & UNOP_IS_NIL) {
+    dropStr(low, type);
+
+    const bool isNil = kindOf(type) == TYPE_NIL;
+
+    temp = startTemp(low, TYPE_BOOL);
+    fprintf(low->out, "%s;\n", isNil ? "false" : "true");
+    type = TYPE_BOOL;
+  }
+
+  if (op & UNOP_IS_ZERO) {
+    temp = lowerIsInt(low, temp, 0);
+    type = TYPE_BOOL;
+  }
+
+  if (op & UNOP_IS_NEG_ONE) {
+    temp = lowerIsInt(low, temp, -1);
+    type = TYPE_BOOL;
+  }
+
+  if (op & UNOP_NEG) {
+    temp = lowerNeg(low, temp, type);
+  }
+
+  return temp;
+}
+
+static Temp lowerNode(Lowering *low, NodeId node) {
+  Tree *tree = low->tree;
+
+  switch (NODE_TYPE(tree, node)) {
+    case NODE_BINOP:
+      return lowerBinOp(low, node);
+
+    case NODE_UNOP:
+      return lowerUnOp(low, node);
+
+    case NODE_INT:
+      return lowerInt(low, NODE_AS_INT(tree, node));
+
+    case NODE_FLOAT:
+      return lowerFloat(low, NODE_AS_FLOAT(tree, node));
+
+    case NODE_BOOL: {
+      const Temp temp = startTemp(low, TYPE_BOOL);
+
+      fprintf(low->out, "%s;\n", NODE_AS_BOOL(tree, node) ? "true" : "false");
+      return temp;
+    }
+
+    case NODE_NIL:
+      return NO_TEMP;
+
+    case NODE_STR:
+      lowerStr(low, NODE_AS_STR(tree, node));
+      return NO_TEMP;
+  }
+
+  return NO_TEMP;
+}
+
+// prints the result like `OP_RET` does.
+static void lowerRet(Lowering *low, Temp temp, TypeId type) {
+  switch (kindOf(type)) {
+    case TYPE_INT:
+      fprintf(low->out, "  printVal(INT_VAL(t%" PRIu32 "));\n", temp);
+      break;
+
+    case TYPE_FLOAT:
+      fprintf(low->out, "  printVal(NUM_VAL(t%" PRIu32 "));\n", temp);
+      break;
+
+    case TYPE_BOOL:
+      fprintf(low->out, "  printVal(BOOL_VAL(t%" PRIu32 "));\n", temp);
+      break;
+
+    case TYPE_STR:
+      fputs("  printVal(pop(&vm));\n", low->out);
+      break;
+
+    default:
+      fputs("  printVal(NIL_VAL);\n", low->out);
+      break;
+  }
+
+  fputs("  printf(\"\\n\");\n", low->out);
+}
+
+// the program is built with the same value representation as we were.
+static void writePrelude(FILE *out, const char *fname) {
+  fprintf(out, "// generated by `neve --aot` from %s.\n\n", fname);
+
+#ifdef NAN_BOXING
+  fputs("#define NEVE_NAN_BOXING\n\n", out);
+#endif
+
+  fputs(
+    "#include <stdio.h>\n"
+    "#include <string.h>\n"
+    "\n"
+    "#include \"obj.h\"\n"
+    "#include \"vm.h\"\n"
+    "\n"
+    "// Ints wrap around at 48 bits, like the VM’s.\n"
+    "#define WRAP(i) wrapInt(i)\n"
+    "\n"
+    "static inline double bitsToNum(uint64_t bits) {\n"
+    "  double num;\n"
+    "  memcpy(&num, &bits, sizeof (num));\n"
+    "\n"
+    "  return num;\n"
+    "}\n"
+    "\n"
+    "int main(void) {\n"
+    "  VM vm = newVM();\n"
+    "  resetStack(&vm);\n"
+    "\n",
+    out
+  );
+}
+
+void lowerToC(Tree *tree, NodeId root, const char *fname, FILE *out) {
+  Lowering low = {
+    .tree = tree,
+    .out = out,
+    .nextTemp = 0
+  };
+
+  writePrelude(out, fname);
+
+  const Temp result = lowerNode(&low, root);
+
+  fputs("\n", out);
+  lowerRet(&low, result, NODE_VAL_TYPE(tree, root));
+
+  fputs(
+    "\n"
+    "  freeVM(&vm);\n"
+    "  return 0;\n"
+    "}\n",
+    out
+  );
+}
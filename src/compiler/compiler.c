@@ -2,11 +2,15 @@
 #include <stdlib.h>
 #include <limits.h>
 
+#include "aot.h"
 #include "compiler.h"
 #include "ctx.h"
 #include "emit.h"
 #include "err.h"
+#include "fold.h"
+#include "peephole.h"
 #include "pretty.h"
+#include "regemit.h"
 #include "tok.h"
 #include "ir.h"
 
@@ -14,6 +18,20 @@
 #include "debug.h"
 #endif
 
+// what parsing an expression leaves behind.  the type checks and the errors
+// they report only need its type and where it is, so those are kept even
+// when there’s no tree for `node` to be in.
+typedef struct {
+  NodeId node;
+  TypeId type;
+
+  // the whole expression, operands included.
+  Span span;
+} Expr;
+
+// the node of an expression that was emitted straight away.
+#define NO_NODE UINT32_MAX
+
 Parser newParser() {
   Tok nothing = emptyTok();
 
@@ -26,8 +44,26 @@ Parser newParser() {
   return parser;
 }
 
-static void markErr(Ctx *ctx) {
-  ctx->parser.isPanicking = true;
+static Expr newExpr(NodeId node, TypeId type, Span span) {
+  Expr expr = {
+    .node = node,
+    .type = type,
+    .span = span
+  };
+
+  return expr;
+}
+
+static bool isOfType(Expr expr, TypeId type) {
+  return typesMatch(expr.type, type);
+}
+
+static bool isNumeric(Expr expr) {
+  return isOfType(expr, TYPE_FLOAT) || isOfType(expr, TYPE_INT);
+}
+
+static bool isDirect(Ctx *ctx) {
+  return ctx->mode == MODE_DIRECT;
 }
 
 static void unexpectedToken(Ctx *ctx, Tok tok) {
@@ -58,7 +94,7 @@ static void unexpectedToken(Ctx *ctx, Tok tok) {
   }
 }
 
-static void unaryNegationErr(Ctx *ctx, Tok op, Tok tok, Node *operand) {
+static void unaryNegationErr(Ctx *ctx, Tok op, Tok tok, Expr operand) {
   CHECK_PANIC(ctx);
   markErr(ctx);
 
@@ -71,7 +107,7 @@ static void unaryNegationErr(Ctx *ctx, Tok op, Tok tok, Node *operand) {
     mod, 
     "cannot negate ‘%.*s’ of type ‘%s’", 
     SHOW_LEXEME(tok), 
-    operand->valType.name
+    typeName(operand.type)
   );
 
   showOffendingLine(mod, "can’t negate ‘%.*s’", SHOW_LEXEME(tok));
@@ -85,12 +121,15 @@ static void unaryNegationErr(Ctx *ctx, Tok op, Tok tok, Node *operand) {
   endErr(mod);
 }
 
-static void binOpTypeErr(Ctx *ctx, Node *left, Tok op, Node *right) {
+static void binOpTypeErr(Ctx *ctx, Expr left, Tok op, Expr right) {
   CHECK_PANIC(ctx);
   markErr(ctx);
 
-  Loc leftLoc = getFullLoc(left);
-  Loc rightLoc = getFullLoc(right);
+  const char *leftName = typeName(left.type);
+  const char *rightName = typeName(right.type);
+
+  Loc leftLoc = spanLoc(&ctx->tree, left.span);
+  Loc rightLoc = spanLoc(&ctx->tree, right.span);
   Loc loc = op.loc;
 
   setNewErr(&ctx->errMod, ERR_UNAPPLICABLE_OP, loc); 
@@ -135,12 +174,12 @@ static void binOpTypeErr(Ctx *ctx, Node *left, Tok op, Node *right) {
     mod, 
     "cannot %s ‘%s’ and ‘%s’", 
     actionName, 
-    left->valType.name, 
-    right->valType.name
+    leftName, 
+    rightName
   );
 
-  showNote(mod, leftLoc, "%s", left->valType.name);
-  showNote(mod, rightLoc, "%s", right->valType.name);
+  showNote(mod, leftLoc, "%s", leftName);
+  showNote(mod, rightLoc, "%s", rightName);
 
   endErr(mod);
 }
@@ -150,11 +189,7 @@ static void advance(Ctx *ctx) {
   parser->prev = parser->curr;
   
   while (true) {
-    parser->curr = nextTok(&ctx->lexer);
-
-    if (parser->curr.type == TOK_NEWLINE) {
-      continue;
-    }
+    parser->curr = nextStreamTok(&ctx->toks);
 
     if (parser->curr.type != TOK_ERR) {
       break;
@@ -245,10 +280,12 @@ static bool match(Ctx *ctx, TokType type) {
 static void endCompiler(Ctx *ctx) {
   Tok curr = ctx->parser.curr;
 
-  freeTypeTable(ctx->types);
-
   emitReturn(ctx, curr.loc);
 
+  if (ctx->errMod.errCount == 0 && !isDirect(ctx)) {
+    optimizeChunk(currChunk(ctx));
+  }
+
 #ifdef DEBUG_COMPILE
   if (ctx->errMod.errCount == 0) {
     disasmChunk(currChunk(ctx), "code");
@@ -256,35 +293,144 @@ static void endCompiler(Ctx *ctx) {
 #endif
 }
 
-static Node *expr(Ctx *ctx);
-static Node *bitOr(Ctx *ctx);
-static Node *bitXor(Ctx *ctx);
-static Node *bitAnd(Ctx *ctx);
-static Node *equality(Ctx *ctx);
-static Node *comparison(Ctx *ctx);
-static Node *bitShift(Ctx *ctx);
-static Node *term(Ctx *ctx);
-static Node *factor(Ctx *ctx);
-static Node *unary(Ctx *ctx);
-static Node *primary(Ctx *ctx);
-
-static Node *intLiteral(Ctx *ctx);
-static Node *floatLiteral(Ctx *ctx);
-static Node *grouping(Ctx *ctx);
-static Node *str(Ctx *ctx);
-static Node *interpol(Ctx *ctx);
-
-static Node *expr(Ctx *ctx) {
+// in direct mode, every expression is emitted as soon as it’s parsed, which
+// works because operands always come before what’s done with them.
+// otherwise, it becomes a node in the tree.
+static Expr intExpr(Ctx *ctx, long value, Tok tok) {
+  const Span span = tokSpan(&ctx->tree, tok);
+
+  if (isDirect(ctx)) {
+    emitInt(ctx, value, tok.loc);
+    return newExpr(NO_NODE, TYPE_INT, span);
+  }
+
+  return newExpr(newInt(&ctx->tree, value, span), TYPE_INT, span);
+}
+
+static Expr floatExpr(Ctx *ctx, double value, Tok tok) {
+  const Span span = tokSpan(&ctx->tree, tok);
+
+  if (isDirect(ctx)) {
+    emitFloat(ctx, value, tok.loc);
+    return newExpr(NO_NODE, TYPE_FLOAT, span);
+  }
+
+  return newExpr(newFloat(&ctx->tree, value, span), TYPE_FLOAT, span);
+}
+
+static Expr boolExpr(Ctx *ctx, bool value, Tok tok) {
+  const Span span = tokSpan(&ctx->tree, tok);
+
+  if (isDirect(ctx)) {
+    emit(ctx, value ? OP_TRUE : OP_FALSE, tok.loc);
+    return newExpr(NO_NODE, TYPE_BOOL, span);
+  }
+
+  return newExpr(newBool(&ctx->tree, value, span), TYPE_BOOL, span);
+}
+
+static Expr nilExpr(Ctx *ctx, Tok tok) {
+  const Span span = tokSpan(&ctx->tree, tok);
+
+  if (isDirect(ctx)) {
+    emitConst(ctx, NIL_VAL, tok.loc);
+    return newExpr(NO_NODE, TYPE_NIL, span);
+  }
+
+  return newExpr(newNil(&ctx->tree, span), TYPE_NIL, span);
+}
+
+// `tok` has already had its quotes trimmed.
+static Expr strExpr(Ctx *ctx, Tok tok) {
+  const Span span = tokSpan(&ctx->tree, tok);
+
+  if (isDirect(ctx)) {
+    StrLit lit = {
+      .chars = tok.lexeme,
+      .length = tok.loc.length,
+      .isOwned = false
+    };
+
+    emitStr(ctx, lit, tok.loc);
+    return newExpr(NO_NODE, TYPE_STR, span);
+  }
+
+  const NodeId node = newStr(
+    &ctx->tree,
+    tok.lexeme,
+    tok.loc.length,
+    false,
+    span
+  );
+
+  return newExpr(node, TYPE_STR, span);
+}
+
+static Expr unOp(Ctx *ctx, UnOpType type, Tok op, Expr operand) {
+  const Span span = tokSpan(&ctx->tree, op);
+  const TypeId valType = inferUnOp(type, operand.type);
+  const Span fullSpan = mergeSpans(span, operand.span);
+
+  if (isDirect(ctx)) {
+    emitUnOpcode(ctx, type, operand.type, op.loc);
+    return newExpr(NO_NODE, valType, fullSpan);
+  }
+
+  const NodeId node = newUnOp(&ctx->tree, type, operand.node, span);
+
+  return newExpr(node, valType, fullSpan);
+}
+
+static Expr binOp(Ctx *ctx, Expr left, Tok op, Expr right) {
+  const Span span = tokSpan(&ctx->tree, op);
+  const TypeId valType = inferBinOp(left.type, op.type, right.type);
+  const Span fullSpan = mergeSpans(mergeSpans(left.span, span), right.span);
+
+  if (isDirect(ctx)) {
+    emitBinOpcode(ctx, left.type, op.type, right.type, op.loc);
+    return newExpr(NO_NODE, valType, fullSpan);
+  }
+
+  const NodeId node = newBinOp(
+    &ctx->tree,
+    left.node,
+    op.type,
+    right.node,
+    span
+  );
+
+  return newExpr(node, valType, fullSpan);
+}
+
+static Expr expr(Ctx *ctx);
+static Expr bitOr(Ctx *ctx);
+static Expr bitXor(Ctx *ctx);
+static Expr bitAnd(Ctx *ctx);
+static Expr equality(Ctx *ctx);
+static Expr comparison(Ctx *ctx);
+static Expr bitShift(Ctx *ctx);
+static Expr term(Ctx *ctx);
+static Expr factor(Ctx *ctx);
+static Expr unary(Ctx *ctx);
+static Expr primary(Ctx *ctx);
+
+static Expr intLiteral(Ctx *ctx);
+static Expr floatLiteral(Ctx *ctx);
+static Expr grouping(Ctx *ctx);
+static Expr str(Ctx *ctx);
+static Expr interpol(Ctx *ctx);
+
+static Expr expr(Ctx *ctx) {
   return bitOr(ctx);
 }
 
-static Node *bitOr(Ctx *ctx) {
-  Node *left = bitXor(ctx); 
+static Expr bitOr(Ctx *ctx) {
+  Expr left = bitXor(ctx); 
 
   while (check(ctx, TOK_PIPE)) {
     Tok op = consume(ctx);
 
-    Node *right = bitXor(ctx);
+    Expr right = bitXor(ctx);
 
     // in the future, allow enum flag values.  still gotta determine a syntax
     // for them.  a good candidate could be:
@@ -294,76 +440,72 @@ static Node *bitOr(Ctx *ctx) {
     // but that’s really unintuitive.  we’ll see--i’d like not to have to 
     // introduce a specific ‘bitwise’ keyword.  and `enum X for &` has its
     // charm, too.
-    if (!checkType(left, TYPE_INT) || !checkType(right, TYPE_INT)) {
+    if (!isOfType(left, TYPE_INT) || !isOfType(right, TYPE_INT)) {
       binOpTypeErr(ctx, left, op, right);
     }
 
-    Node *binOp = newBinOp(ctx->types, left, op, right);
-    left = binOp; 
+    left = binOp(ctx, left, op, right);
   }
 
   return left;
 }
 
-static Node *bitXor(Ctx *ctx) {
-  Node *left = bitAnd(ctx); 
+static Expr bitXor(Ctx *ctx) {
+  Expr left = bitAnd(ctx); 
 
   while (check(ctx, TOK_BIT_XOR)) {
     Tok op = consume(ctx);
 
-    Node *right = bitAnd(ctx);
+    Expr right = bitAnd(ctx);
 
-    if (!checkType(left, TYPE_INT) || !checkType(right, TYPE_INT)) {
+    if (!isOfType(left, TYPE_INT) || !isOfType(right, TYPE_INT)) {
       binOpTypeErr(ctx, left, op, right);
     }
 
-    Node *binOp = newBinOp(ctx->types, left, op, right);
-    left = binOp; 
+    left = binOp(ctx, left, op, right);
   }
 
   return left;
 }
 
-static Node *bitAnd(Ctx *ctx) {
-  Node *left = equality(ctx); 
+static Expr bitAnd(Ctx *ctx) {
+  Expr left = equality(ctx); 
 
   while (check(ctx, TOK_BIT_AND)) {
     Tok op = consume(ctx);
 
-    Node *right = equality(ctx);
+    Expr right = equality(ctx);
 
-    if (!checkType(left, TYPE_INT) || !checkType(right, TYPE_INT)) {
+    if (!isOfType(left, TYPE_INT) || !isOfType(right, TYPE_INT)) {
       binOpTypeErr(ctx, left, op, right);
     }
 
-    Node *binOp = newBinOp(ctx->types, left, op, right);
-    left = binOp; 
+    left = binOp(ctx, left, op, right);
   }
 
   return left;
 }
 
-static Node *equality(Ctx *ctx) {
-  Node *left = comparison(ctx); 
+static Expr equality(Ctx *ctx) {
+  Expr left = comparison(ctx); 
 
   while (checkEither(ctx, TOK_EQUAL, TOK_NEQUAL)) {
     Tok op = consume(ctx);
 
-    Node *right = comparison(ctx);
+    Expr right = comparison(ctx);
 
-    if (!typesMatch(left->valType, right->valType)) {
+    if (!isOfType(right, left.type)) {
       binOpTypeErr(ctx, left, op, right);
     }
 
-    Node *binOp = newBinOp(ctx->types, left, op, right);
-    left = binOp; 
+    left = binOp(ctx, left, op, right);
   }
 
   return left;
 }
 
-static Node *comparison(Ctx *ctx) {
-  Node *left = bitShift(ctx); 
+static Expr comparison(Ctx *ctx) {
+  Expr left = bitShift(ctx); 
 
   while (
     checkEither(ctx, TOK_LESS, TOK_GREATER) ||
@@ -371,110 +513,107 @@ static Node *comparison(Ctx *ctx) {
   ) {
     Tok op = consume(ctx);
 
-    Node *right = bitShift(ctx);
+    Expr right = bitShift(ctx);
 
-    if (!isNum(left) || !isNum(right)) {
+    if (!isNumeric(left) || !isNumeric(right)) {
       binOpTypeErr(ctx, left, op, right);
     }
 
-    Node *binOp = newBinOp(ctx->types, left, op, right);
-    left = binOp; 
+    left = binOp(ctx, left, op, right);
   }
 
   return left;
 }
 
-static Node *bitShift(Ctx *ctx) {
-  Node *left = term(ctx); 
+static Expr bitShift(Ctx *ctx) {
+  Expr left = term(ctx); 
 
   while (checkEither(ctx, TOK_SHL, TOK_SHR)) {
     Tok op = consume(ctx);
 
-    Node *right = comparison(ctx);
+    Expr right = comparison(ctx);
 
-    if (!checkType(left, TYPE_INT) || !checkType(right, TYPE_INT)) {
+    if (!isOfType(left, TYPE_INT) || !isOfType(right, TYPE_INT)) {
       binOpTypeErr(ctx, left, op, right);
     }
 
-    Node *binOp = newBinOp(ctx->types, left, op, right);
-    left = binOp; 
+    left = binOp(ctx, left, op, right);
   }
 
   return left;
 }
 
-static Node *term(Ctx *ctx) {
-  Node *left = factor(ctx); 
+static Expr term(Ctx *ctx) {
+  Expr left = factor(ctx); 
 
   while (checkEither(ctx, TOK_PLUS, TOK_MINUS)) {
     Tok op = consume(ctx);
 
-    Node *right = factor(ctx);
+    Expr right = factor(ctx);
 
-    if (!isNum(left) || !isNum(right)) {
+    if (!isNumeric(left) || !isNumeric(right)) {
       if (
-        (op.type != TOK_PLUS && 
-        !checkType(left, TYPE_STR)) || !checkType(right, TYPE_STR)
+        op.type != TOK_PLUS || 
+        !isOfType(left, TYPE_STR) || 
+        !isOfType(right, TYPE_STR)
       ) {
         binOpTypeErr(ctx, left, op, right);
       }
     }
 
-    Node *binOp = newBinOp(ctx->types, left, op, right);
-    left = binOp; 
+    left = binOp(ctx, left, op, right);
   }
 
   return left;
 }
 
-static Node *factor(Ctx *ctx) {
-  Node *left = unary(ctx); 
+static Expr factor(Ctx *ctx) {
+  Expr left = unary(ctx); 
 
   while (checkEither(ctx, TOK_STAR, TOK_SLASH)) {
     Tok op = consume(ctx);
 
-    Node *right = unary(ctx);
+    Expr right = unary(ctx);
 
-    if (!isNum(left) || !isNum(right)) {
+    if (!isNumeric(left) || !isNumeric(right)) {
       binOpTypeErr(ctx, left, op, right);
     }
 
-    Node *binOp = newBinOp(ctx->types, left, op, right);
-    left = binOp; 
+    left = binOp(ctx, left, op, right);
   }
 
   return left;
 }
 
-static Node *unary(Ctx *ctx) {
+static Expr unary(Ctx *ctx) {
   if (!checkEither(ctx, TOK_MINUS, TOK_NOT)) {
     return primary(ctx);
   }
 
   Tok op = consume(ctx); 
-  Node *operand = unary(ctx);
+  Expr operand = unary(ctx);
 
   switch (op.type) {
     case TOK_MINUS: {
       // TODO: make this more robust once we implement classes--
       // allow for operator overloading and replace this check
-      if (!isNum(operand)) {
+      if (!isNumeric(operand)) {
         Tok tok = ctx->parser.prev;
 
         unaryNegationErr(ctx, op, tok, operand);
       }
 
-      return newUnOp(ctx->types, op, UNOP_NEG, operand);
+      return unOp(ctx, UNOP_NEG, op, operand);
     }
     
     case TOK_NOT: {
-      if (!checkType(operand, TYPE_BOOL)) {
+      if (!isOfType(operand, TYPE_BOOL)) {
         Tok tok = ctx->parser.prev;
 
         unaryNegationErr(ctx, op, tok, operand);
       }
 
-      return newUnOp(ctx->types, op, UNOP_NOT, operand);
+      return unOp(ctx, UNOP_NOT, op, operand);
     }
 
     default:
@@ -482,7 +621,7 @@ static Node *unary(Ctx *ctx) {
   }
 }
 
-static Node *primary(Ctx *ctx) {
+static Expr primary(Ctx *ctx) {
   Tok tok = ctx->parser.curr;
 
   switch (tok.type) {
@@ -495,11 +634,11 @@ static Node *primary(Ctx *ctx) {
     case TOK_TRUE:
     case TOK_FALSE:
       advance(ctx);
-      return newBool(ctx->types, tok.type == TOK_TRUE, tok.loc);
+      return boolExpr(ctx, tok.type == TOK_TRUE, tok);
 
     case TOK_NIL:
       advance(ctx);
-      return newNil(ctx->types, tok.loc);
+      return nilExpr(ctx, tok);
       
     case TOK_LPAREN:
       return grouping(ctx);
@@ -518,7 +657,7 @@ static Node *primary(Ctx *ctx) {
 
   if (IS_PANICKING(ctx)) {
     // TODO: replace this with a `nil` node
-    return newInt(ctx->types, -1L, curr.loc);
+    return intExpr(ctx, -1L, curr);
   }
 
   markErr(ctx);
@@ -536,17 +675,21 @@ static Node *primary(Ctx *ctx) {
 
   endErr(mod);
 
-  return newNil(ctx->types, curr.loc);
+  return nilExpr(ctx, curr);
 }
 
-static Node *intLiteral(Ctx *ctx) {
+static Expr intLiteral(Ctx *ctx) {
   Tok integer = consume(ctx);
   
   // TODO: allow hexadecimal, binary, and octal sometime.
   const int base = 10;
   const long value = strtol(integer.lexeme, NULL, base);
 
-  if ((value == LONG_MIN || value == LONG_MAX) && !IS_PANICKING(ctx)) {
+  // an Int only has 48 bits, and would silently lose the rest.
+  if (
+    (value == LONG_MIN || value == LONG_MAX || !fitsInt(value)) &&
+    !IS_PANICKING(ctx)
+  ) {
     markErr(ctx);
 
     // TODO: use long longs at some point
@@ -568,23 +711,25 @@ static Node *intLiteral(Ctx *ctx) {
     endErr(mod);
   }
 
-  return newInt(ctx->types, value, integer.loc);
+  // whatever doesn’t fit has been reported already, and shouldn’t be again
+  // when it’s emitted.
+  return intExpr(ctx, fitsInt(value) ? value : 0, integer);
 }
 
-static Node *floatLiteral(Ctx *ctx) {
+static Expr floatLiteral(Ctx *ctx) {
   Tok f = consume(ctx);
 
   const double value = strtod(f.lexeme, NULL);
 
-  return newFloat(ctx->types, value, f.loc);
+  return floatExpr(ctx, value, f);
 }
 
-static Node *grouping(Ctx *ctx) {
+static Expr grouping(Ctx *ctx) {
   advance(ctx);
 
   // TODO: maybe we’ll need a separate NODE_GROUPED variant
   // for constant folding?
-  Node *grouped = expr(ctx);
+  Expr grouped = expr(ctx);
 
   if (!match(ctx, TOK_RPAREN) && !IS_PANICKING(ctx)) {
     markErr(ctx);
@@ -604,75 +749,164 @@ static Node *grouping(Ctx *ctx) {
   return grouped;
 }
 
-static Node *str(Ctx *ctx) {
+static Expr str(Ctx *ctx) {
   Tok tok = consume(ctx);
 
   trimStrTokQuotes(&tok);
 
-  return newStr(ctx->types, tok);
+  return strExpr(ctx, tok);
 }
 
-static Node *interpol(Ctx *ctx) {
+static Expr interpol(Ctx *ctx) {
   // interpolation not yet supported
   Tok tok = consume(ctx);
 
   unexpectedToken(ctx, tok);
 
-  return newStr(ctx->types, tok);
+  return strExpr(ctx, tok);
   /*
   Tok tok = consume(ctx); 
 
   trimStrTokQuotes(&tok);
 
-  Node *interpolExpr = expr(ctx);
+  NodeId interpolExpr = expr(ctx);
 
   // TODO: check if the interpolExpr is Showable.  if not, make it
   // an error.
   
-  Node *next;
+  NodeId next;
   if (check(ctx, TOK_INTERPOL)) {
     next = interpol(ctx);
   } else {
     if (!check(ctx, TOK_STR)) {
       unexpectedToken(ctx, tok);
 
-      return newInterpol(ctx->types, tok, interpolExpr, NULL);
+      return newInterpol(&ctx->tree, tok, interpolExpr, NULL);
     }
 
     next = str(ctx);
   }
 
-  return newInterpol(ctx->types, tok, interpolExpr, next);
+  return newInterpol(&ctx->tree, tok, interpolExpr, next);
   */
 }
 
-bool compile(VM *vm, const char *fname, const char *src, Chunk *ch) {
-  ErrMod mod = newErrMod(fname, src);
-  Ctx ctx = newCtx(vm, mod, ch);
-
-  advance(&ctx);
-  Node *ast = expr(&ctx);
-  expect(&ctx, TOK_EOF, "end of file");
+// parses the whole source, and folds the tree unless there isn’t one.  false
+// if anything was reported, in which case there’s nothing to emit.
+static bool parseChecked(Ctx *ctx, NodeId *root) {
+  advance(ctx);
+  const Expr ast = expr(ctx);
+  expect(ctx, TOK_EOF, "end of file");
 
-  ErrMod newMod = ctx.errMod;
+  if (ctx->errMod.errCount == 0 && !isDirect(ctx)) {
+    foldConsts(ctx);
+  }
 
-  const bool hadErrs = newMod.errCount != 0;
+  if (ctx->errMod.errCount != 0) {
+    return false;
+  }
 
-  if (!hadErrs) {
 #ifdef DEBUG_COMPILE
-    prettyPrint(ast);
+  if (!isDirect(ctx)) {
+    prettyPrint(&ctx->tree, ast.node);
+  }
 #endif
 
-    emitNode(&ctx, ast);
+  *root = ast.node;
+  return true;
+}
+
+// frees everything compiling needed but its output doesn’t, and says whether
+// it worked.  errors reported while emitting count too.
+static bool finishCtx(Ctx *ctx) {
+  const int errCount = ctx->errMod.errCount;
+
+  freeTokStream(&ctx->toks);
+  freeTree(&ctx->tree);
+  freeArena(&ctx->arena);
+
+  if (errCount != 0) {
+    cliErr("compilation failed due to %d previous errors", errCount);
   }
 
-  freeNode(ast);
+  return errCount == 0;
+}
+
+bool compile(
+  VM *vm,
+  const char *fname,
+  const char *src,
+  size_t srcLength,
+  Chunk *ch,
+  CompileMode mode
+) {
+  ErrMod mod = newErrMod(fname, src);
+  Ctx ctx = newCtx(vm, mod, srcLength, ch, mode);
+  NodeId root;
+
+  // direct mode adds constants while it parses.
+  rootChunk(vm, ch);
+
+  // in direct mode, the code is already there.
+  if (parseChecked(&ctx, &root) && !isDirect(&ctx)) {
+    emitNode(&ctx, root);
+  }
 
   endCompiler(&ctx);
 
-  if (hadErrs) {
-    cliErr("compilation failed due to %d previous errors", newMod.errCount);
+  // only direct mode can get this deep: folding leaves a single constant.
+  const bool fits = ctx.errMod.errCount != 0 || chunkDepth(ch) <= MAX_DEPTH;
+
+  if (!fits) {
+    cliErr("%s: too deeply nested for the VM’s stack", fname);
+  }
+
+  return finishCtx(&ctx) && fits;
+}
+
+bool compileRegs(
+  VM *vm,
+  const char *fname,
+  const char *src,
+  size_t srcLength,
+  RegChunk *rc
+) {
+  ErrMod mod = newErrMod(fname, src);
+  Ctx ctx = newCtx(vm, mod, srcLength, NULL, MODE_OPTIMIZE);
+  NodeId root;
+  bool fits = true;
+
+  if (parseChecked(&ctx, &root)) {
+    fits = emitRegs(vm, &ctx.tree, root, rc);
+
+    if (!fits) {
+      cliErr("%s: too many values for the register VM", fname);
+    }
+
+#ifdef DEBUG_COMPILE
+    if (fits) {
+      disasmRegChunk(rc, "code");
+    }
+#endif
+  }
+
+  return finishCtx(&ctx) && fits;
+}
+
+// the tree is all C needs, so there’s neither a VM nor a chunk.
+bool compileToC(
+  const char *fname,
+  const char *src,
+  size_t srcLength,
+  FILE *out
+) {
+  ErrMod mod = newErrMod(fname, src);
+  Ctx ctx = newCtx(NULL, mod, srcLength, NULL, MODE_OPTIMIZE);
+  NodeId root;
+
+  if (parseChecked(&ctx, &root)) {
+    lowerToC(&ctx.tree, root, fname, out);
   }
 
-  return !hadErrs;
+  return finishCtx(&ctx);
 }
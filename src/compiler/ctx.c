@@ -1,18 +1,29 @@
 #include "ctx.h"
 
-Ctx newCtx(VM *vm, ErrMod mod, Chunk *ch) {
-  Lexer lexer = newLexer(mod.src);
+Ctx newCtx(
+  VM *vm,
+  ErrMod mod,
+  size_t srcLength,
+  Chunk *ch,
+  CompileMode mode
+) {
   Parser parser = newParser();
-  TypeTable *table = allocTypeTable();
 
   Ctx ctx = {
     .vm = vm,
     .errMod = mod,
     .parser = parser,
-    .lexer = lexer,
+    .toks = newTokStream(mod.src, false),
     .currCh = ch,
-    .types = table
+    .mode = mode,
+    .lastInstr = 0,
+    .tree = newTree(mod.src, srcLength),
+    .arena = newArena()
   };
 
   return ctx;
 }
+
+void markErr(Ctx *ctx) {
+  ctx->parser.isPanicking = true;
+}
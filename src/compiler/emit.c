@@ -1,49 +1,238 @@
-#include <stdio.h>
-
 #include "chunk.h"
 #include "emit.h"
+#include "err.h"
 #include "obj.h"
+#include "profile.h"
+
+static uint8_t intOpcode(TokType type) {
+  switch (type) {
+    case TOK_PLUS:
+      return OP_INT_ADD;
+
+    case TOK_MINUS:
+      return OP_INT_SUB;
+
+    case TOK_STAR:
+      return OP_INT_MUL;
+
+    case TOK_SHL:
+      return OP_INT_SHL;
+
+    case TOK_SHR:
+      return OP_INT_SHR;
+
+    case TOK_BIT_AND:
+      return OP_INT_BIT_AND;
+
+    case TOK_BIT_XOR:
+      return OP_INT_BIT_XOR;
+
+    case TOK_PIPE:
+      return OP_INT_BIT_OR;
+
+    case TOK_GREATER:
+      return OP_INT_GREATER;
+
+    case TOK_LESS:
+      return OP_INT_LESS;
+
+    case TOK_GREATER_EQUAL:
+      return OP_INT_GREATER_EQ;
 
-static uint8_t binOpTable[] = {
-  OP_ADD, OP_SUB, OP_MUL, OP_DIV,
-  OP_SHL, OP_SHR, OP_BIT_AND, OP_BIT_XOR,
-  OP_BIT_OR, OP_EQ, OP_NEQ, OP_GREATER, 
-  OP_LESS, OP_GREATER_EQ, OP_LESS_EQ
-};
+    default:
+      return OP_INT_LESS_EQ;
+  }
+}
+
+static uint8_t floatOpcode(TokType type) {
+  switch (type) {
+    case TOK_PLUS:
+      return OP_FLOAT_ADD;
+
+    case TOK_MINUS:
+      return OP_FLOAT_SUB;
+
+    case TOK_STAR:
+      return OP_FLOAT_MUL;
 
-static void emitBinOp(Ctx *ctx, BinOp binOp) {
-  emitNode(ctx, binOp.left);
-  emitNode(ctx, binOp.right);
+    case TOK_SLASH:
+      return OP_FLOAT_DIV;
+
+    case TOK_GREATER:
+      return OP_FLOAT_GREATER;
+
+    case TOK_LESS:
+      return OP_FLOAT_LESS;
+
+    case TOK_GREATER_EQUAL:
+      return OP_FLOAT_GREATER_EQ;
+
+    default:
+      return OP_FLOAT_LESS_EQ;
+  }
+}
 
-  const Tok op = binOp.op;
+bool isFloatOp(TypeId leftType, TokType op, TypeId rightType) {
+  return (
+    op == TOK_SLASH ||
+    typesMatch(leftType, TYPE_FLOAT) ||
+    typesMatch(rightType, TYPE_FLOAT)
+  );
+}
 
-  uint8_t opcode = binOpTable[op.type - TOK_PLUS];
+// emits `op`, or turns the instruction before it into a superinstruction if
+// the two make up one the VM was told to use.
+static void emitOp(Ctx *ctx, uint8_t op, Loc loc) {
+  Chunk *ch = currChunk(ctx);
+  uint8_t fused;
 
   if (
-    opcode == OP_ADD &&
-    checkType(binOp.left, TYPE_STR) && 
-    checkType(binOp.right, TYPE_STR)
+    ch->next > 0 &&
+    fusePair(ctx->vm->superinstrs, ch->code[ctx->lastInstr], op, &fused)
   ) {
-    emit(ctx, OP_CONCAT, op.loc); 
+    ch->code[ctx->lastInstr] = fused;
+    return;
+  }
+
+  emit(ctx, op, loc);
+}
+
+// emits `node`, converting it to a Float first if the operation it’s part of 
+// needs one.
+static void emitOperand(Ctx *ctx, NodeId node, bool asFloat) {
+  emitNode(ctx, node);
+
+  if (asFloat && checkType(&ctx->tree, node, TYPE_INT)) {
+    emit(ctx, OP_INT_TO_FLOAT, getLoc(&ctx->tree, node));
+  }
+}
+
+static bool isConcat(Tree *tree, NodeId node) {
+  return (
+    NODE_TYPE(tree, node) == NODE_BINOP &&
+    NODE_OP(tree, node) == TOK_PLUS &&
+    checkType(tree, node, TYPE_STR)
+  );
+}
+
+// concatenation is associative, so a whole tree of `+`s over Strs can be
+// emitted as its leaves, in order, followed by a single join.
+static void emitPieces(Ctx *ctx, NodeId node, uint8_t *count, Loc loc) {
+  Tree *tree = &ctx->tree;
+
+  if (isConcat(tree, node)) {
+    emitPieces(ctx, NODE_LEFT(tree, node), count, loc);
+    emitPieces(ctx, NODE_RIGHT(tree, node), count, loc);
     return;
   }
 
-  emit(ctx, opcode, op.loc);
+  emitNode(ctx, node);
+
+  if (++*count == MAX_CONCAT_PIECES) {
+    emitBoth(ctx, OP_CONCAT_N, *count, loc);
+
+    // the joined group is the first piece of the next one.
+    *count = 1;
+  }
+}
+
+static void emitConcat(Ctx *ctx, NodeId node, Loc loc) {
+  uint8_t count = 0;
+
+  emitPieces(ctx, NODE_LEFT(&ctx->tree, node), &count, loc);
+  emitPieces(ctx, NODE_RIGHT(&ctx->tree, node), &count, loc);
+
+  // a lone `OP_CONCAT` may build a rope, which is what repeated appending
+  // wants.
+  if (count == 2) {
+    emit(ctx, OP_CONCAT, loc);
+  } else if (count > 2) {
+    emitBoth(ctx, OP_CONCAT_N, count, loc);
+  }
 }
 
-static void emitUnOp(Ctx *ctx, UnOp unOp) {
-  emitNode(ctx, unOp.operand); 
+static void emitBinOp(Ctx *ctx, NodeId node) {
+  Tree *tree = &ctx->tree;
+  const TokType op = NODE_OP(tree, node);
+  const NodeId left = NODE_LEFT(tree, node);
+  const NodeId right = NODE_RIGHT(tree, node);
+  const Loc loc = getLoc(tree, node);
 
-  Loc loc = unOp.op.loc;
-  const UnOpType op = unOp.opType;
+  // the type checker guarantees both sides have the same type here, so 
+  // there’s nothing to convert.
+  if (op == TOK_EQUAL || op == TOK_NEQUAL) {
+    emitNode(ctx, left);
+    emitNode(ctx, right);
+
+    emit(ctx, op == TOK_EQUAL ? OP_EQ : OP_NEQ, loc);
+    return;
+  }
+
+  if (checkType(tree, left, TYPE_STR) && checkType(tree, right, TYPE_STR)) {
+    emitConcat(ctx, node, loc);
+    return;
+  }
+
+  const bool isFloat = isFloatOp(
+    NODE_VAL_TYPE(tree, left),
+    op,
+    NODE_VAL_TYPE(tree, right)
+  );
+
+  emitOperand(ctx, left, isFloat);
+  emitOperand(ctx, right, isFloat);
+
+  emitOp(ctx, isFloat ? floatOpcode(op) : intOpcode(op), loc);
+}
+
+// without a tree, the left operand was emitted before anyone knew what the
+// right one would be.  so it’s converted where it is, under the right one,
+// and strings are joined a pair at a time.
+void emitBinOpcode(
+  Ctx *ctx,
+  TypeId leftType,
+  TokType op,
+  TypeId rightType,
+  Loc loc
+) {
+  if (op == TOK_EQUAL || op == TOK_NEQUAL) {
+    emit(ctx, op == TOK_EQUAL ? OP_EQ : OP_NEQ, loc);
+    return;
+  }
+
+  if (typesMatch(leftType, TYPE_STR) && typesMatch(rightType, TYPE_STR)) {
+    emit(ctx, OP_CONCAT, loc);
+    return;
+  }
+
+  if (!isFloatOp(leftType, op, rightType)) {
+    emitOp(ctx, intOpcode(op), loc);
+    return;
+  }
+
+  if (typesMatch(rightType, TYPE_INT)) {
+    emit(ctx, OP_INT_TO_FLOAT, loc);
+  }
+
+  if (typesMatch(leftType, TYPE_INT)) {
+    emit(ctx, OP_INT_TO_FLOAT_UNDER, loc);
+  }
+
+  emitOp(ctx, floatOpcode(op), loc);
+}
+
+void emitUnOpcode(Ctx *ctx, UnOpType op, TypeId operandType, Loc loc) {
+  const uint8_t negOp = (
+    typesMatch(operandType, TYPE_FLOAT) ? OP_FLOAT_NEG : OP_INT_NEG
+  );
 
   switch (op) {
     case UNOP_NEG:
-      emit(ctx, OP_NEG, loc);
+      emit(ctx, negOp, loc);
       break;
     
     case UNOP_NOT:
-      emit(ctx, OP_NOT, loc);
+      emitOp(ctx, OP_NOT, loc);
       break;
 
     default:
@@ -61,65 +250,99 @@ static void emitUnOp(Ctx *ctx, UnOp unOp) {
       }
 
       if (op & UNOP_NEG) {
-        emit(ctx, OP_NEG, loc);
+        emit(ctx, negOp, loc);
       }
       break;
   }
 }
 
-static void emitInt(Ctx *ctx, Int node) {
-  switch (node.value) {
+static void emitUnOp(Ctx *ctx, NodeId node) {
+  Tree *tree = &ctx->tree;
+  const NodeId operand = NODE_OPERAND(tree, node);
+
+  emitNode(ctx, operand); 
+  emitUnOpcode(
+    ctx,
+    NODE_OP(tree, node),
+    NODE_VAL_TYPE(tree, operand),
+    getLoc(tree, node)
+  );
+}
+
+// parsing and folding already keep every Int in range, so this only catches
+// one that slipped past them, before boxing it can wrap it around.
+static void intRangeErr(Ctx *ctx, long value, Loc loc) {
+  CHECK_PANIC(ctx);
+  markErr(ctx);
+
+  setNewErr(&ctx->errMod, ERR_INTEGER_OUT_OF_RANGE, loc);
+  ErrMod mod = ctx->errMod;
+
+  reportErr(mod, "integer out of range");
+  showOffendingLine(mod, "%ld doesn’t fit in an Int", value);
+  showHint(mod, "you can use Floats instead if you need bigger numbers");
+
+  endErr(mod);
+}
+
+void emitInt(Ctx *ctx, long value, Loc loc) {
+  if (!fitsInt(value)) {
+    intRangeErr(ctx, value, loc);
+
+    // something has to be there for whatever uses it.
+    emit(ctx, OP_ZERO, loc);
+    return;
+  }
+
+  switch (value) {
     case -1L:
-      emit(ctx, OP_MINUS_ONE, node.loc);
+      emit(ctx, OP_MINUS_ONE, loc);
       break;
 
     case 0L:
-      emit(ctx, OP_ZERO, node.loc);
+      emit(ctx, OP_ZERO, loc);
       break;
 
     case 1L:
-      emit(ctx, OP_ONE, node.loc);
+      emit(ctx, OP_ONE, loc);
       break;
 
     default:
-      emitConst(ctx, NUM_VAL((double)node.value), node.loc);
+      emitConst(ctx, INT_VAL((int64_t)value), loc);
       break;
   }
 }
 
-static void emitFloat(Ctx *ctx, Float node) {
-  if (node.value == -1) {
-    emit(ctx, OP_MINUS_ONE, node.loc);
+void emitFloat(Ctx *ctx, double value, Loc loc) {
+  if (value == -1) {
+    emit(ctx, OP_FLOAT_MINUS_ONE, loc);
     return;
   }
 
-  if (node.value == 0) {
-    emit(ctx, OP_ZERO, node.loc);
+  if (value == 0) {
+    emit(ctx, OP_FLOAT_ZERO, loc);
     return;
   }
 
-  if (node.value == 1) {
-    emit(ctx, OP_ONE, node.loc);
+  if (value == 1) {
+    emit(ctx, OP_FLOAT_ONE, loc);
     return;
   }
 
-  emitConst(ctx, NUM_VAL(node.value), node.loc);
+  emitConst(ctx, NUM_VAL(value), loc);
 }
 
-static void emitStr(Ctx *ctx, Str node) {
-  Tok tok = node.str;
-
-  fprintf(stderr, "in emitStr(): %.*s\n", SHOW_LEXEME(tok));
-
-  const char *chars = (
-    node.ownsLexeme ? copyLexeme(tok) : tok.lexeme
-  );
-
-  Val val = OBJ_VAL(
-    allocStr(ctx->vm, node.ownsLexeme, chars, tok.loc.length)
+void emitStr(Ctx *ctx, StrLit lit, Loc loc) {
+  // a string we own goes away with the tree, so it needs a copy.  anything
+  // else points into the source, which outlives the chunk.
+  ObjStr *str = (
+    lit.isOwned ?
+    allocStr(ctx->vm, lit.chars, lit.length) :
+    borrowStr(ctx->vm, lit.chars, lit.length)
   );
 
-  emitConst(ctx, val, tok.loc);
+  // the pool isn’t on the GC’s heap, so growing it can’t collect `str`.
+  emitConst(ctx, OBJ_VAL(str), loc);
 }
 
 /*
@@ -168,56 +391,59 @@ Chunk *currChunk(Ctx *ctx) {
 }
 
 void emit(Ctx *ctx, uint8_t byte, Loc loc) {
+  ctx->lastInstr = currChunk(ctx)->next;
   writeChunk(currChunk(ctx), byte, loc.line);
 }
 
 void emitConst(Ctx *ctx, Val val, Loc loc) {
+  ctx->lastInstr = currChunk(ctx)->next;
   writeConst(currChunk(ctx), val, loc.line);
 }
 
+// `two` is an operand, not an instruction of its own.
 void emitBoth(Ctx *ctx, uint8_t one, uint8_t two, Loc loc) {
   emit(ctx, one, loc);
-  emit(ctx, two, loc);
+  writeChunk(currChunk(ctx), two, loc.line);
 }
 
 void emitReturn(Ctx *ctx, Loc loc) {
   emit(ctx, OP_RET, loc);
 }
 
-void emitNode(Ctx *ctx, Node *node) {
-  switch (node->type) {
+void emitNode(Ctx *ctx, NodeId node) {
+  Tree *tree = &ctx->tree;
+
+  switch (NODE_TYPE(tree, node)) {
     case NODE_BINOP:
-      emitBinOp(ctx, NODE_AS_BINOP(node));
+      emitBinOp(ctx, node);
       break;
 
     case NODE_UNOP:
-      emitUnOp(ctx, NODE_AS_UNOP(node));
+      emitUnOp(ctx, node);
       break;
 
     case NODE_INT:
-      emitInt(ctx, NODE_AS_INT(node));
+      emitInt(ctx, NODE_AS_INT(tree, node), getLoc(tree, node));
       break;
     
     case NODE_FLOAT:
-      emitFloat(ctx, NODE_AS_FLOAT(node));
+      emitFloat(ctx, NODE_AS_FLOAT(tree, node), getLoc(tree, node));
       break;
     
-    case NODE_BOOL: {
-      Bool b = NODE_AS_BOOL(node);
-
-      emit(ctx, b.value ? OP_TRUE : OP_FALSE, b.loc);
+    case NODE_BOOL:
+      emit(
+        ctx,
+        NODE_AS_BOOL(tree, node) ? OP_TRUE : OP_FALSE,
+        getLoc(tree, node)
+      );
       break;
-    }
 
-    case NODE_NIL: {
-      Loc loc = NODE_AS_NIL(node);
-      
-      emitConst(ctx, NIL_VAL, loc);
+    case NODE_NIL:
+      emitConst(ctx, NIL_VAL, getLoc(tree, node));
       break;
-    }
 
     case NODE_STR:
-      emitStr(ctx, NODE_AS_STR(node));
+      emitStr(ctx, NODE_AS_STR(tree, node), getLoc(tree, node));
       break;
     
     /*
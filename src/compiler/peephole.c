@@ -0,0 +1,196 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "mem.h"
+#include "peephole.h"
+
+// no pattern is longer than this, before or after rewriting.
+#define MAX_PATTERN 3
+
+// a pattern matches a run of instructions without operands, and replaces it
+// with another such run, which may be empty.
+typedef struct {
+  const char *name;
+
+  uint8_t from[MAX_PATTERN];
+  size_t fromLength;
+
+  uint8_t to[MAX_PATTERN];
+  size_t toLength;
+} Pattern;
+
+// Floats get fewer of these than Ints, since `x + 0.0` isn’t `x` when `x` is
+// `-0.0`, and `not (x < y)` isn’t `x >= y` when either side is NaN.
+static const Pattern patterns[] = {
+  { "not not => _", { OP_NOT, OP_NOT }, 2, { 0 }, 0 },
+  { "eq not => neq", { OP_EQ, OP_NOT }, 2, { OP_NEQ }, 1 },
+  { "neq not => eq", { OP_NEQ, OP_NOT }, 2, { OP_EQ }, 1 },
+  { "igt not => ilte", { OP_INT_GREATER, OP_NOT }, 2, { OP_INT_LESS_EQ }, 1 },
+  { "ilt not => igte", { OP_INT_LESS, OP_NOT }, 2, { OP_INT_GREATER_EQ }, 1 },
+  { "igte not => ilt", { OP_INT_GREATER_EQ, OP_NOT }, 2, { OP_INT_LESS }, 1 },
+  { "ilte not => igt", { OP_INT_LESS_EQ, OP_NOT }, 2, { OP_INT_GREATER }, 1 },
+
+  { "pushz iadd => _", { OP_ZERO, OP_INT_ADD }, 2, { 0 }, 0 },
+  { "pushz isub => _", { OP_ZERO, OP_INT_SUB }, 2, { 0 }, 0 },
+  { "pushz ibor => _", { OP_ZERO, OP_INT_BIT_OR }, 2, { 0 }, 0 },
+  { "pushz ixor => _", { OP_ZERO, OP_INT_BIT_XOR }, 2, { 0 }, 0 },
+  { "pushz ishl => _", { OP_ZERO, OP_INT_SHL }, 2, { 0 }, 0 },
+  { "pushz ishr => _", { OP_ZERO, OP_INT_SHR }, 2, { 0 }, 0 },
+  { "push1 imul => _", { OP_ONE, OP_INT_MUL }, 2, { 0 }, 0 },
+  { "pushm1 iband => _", { OP_MINUS_ONE, OP_INT_BIT_AND }, 2, { 0 }, 0 },
+  { "pushm1 imul => ineg", { OP_MINUS_ONE, OP_INT_MUL }, 2, { OP_INT_NEG }, 1 },
+  { "ineg ineg => _", { OP_INT_NEG, OP_INT_NEG }, 2, { 0 }, 0 },
+
+  { "fpushz fsub => _", { OP_FLOAT_ZERO, OP_FLOAT_SUB }, 2, { 0 }, 0 },
+  { "fpush1 fmul => _", { OP_FLOAT_ONE, OP_FLOAT_MUL }, 2, { 0 }, 0 },
+  { "fpush1 fdiv => _", { OP_FLOAT_ONE, OP_FLOAT_DIV }, 2, { 0 }, 0 },
+  {
+    "fpushm1 fmul => fneg",
+    { OP_FLOAT_MINUS_ONE, OP_FLOAT_MUL }, 2,
+    { OP_FLOAT_NEG }, 1
+  },
+  { "fneg fneg => _", { OP_FLOAT_NEG, OP_FLOAT_NEG }, 2, { 0 }, 0 }
+};
+
+#define PATTERN_COUNT (sizeof (patterns) / sizeof (patterns[0]))
+
+// the instructions written so far, each with where it starts in `code` and
+// the line it came from.  rewriting only ever touches the end of it.
+typedef struct {
+  size_t cap;
+  size_t count;
+
+  size_t *offsets;
+  int *lines;
+
+  size_t codeLength;
+  uint8_t *code;
+} Output;
+
+static void pushInstr(Output *out, const uint8_t *instr, int line) {
+  if (out->count == out->cap) {
+    const size_t oldCap = out->cap;
+
+    out->cap = GROW_CAP(oldCap);
+    out->offsets = GROW_ARR(size_t, out->offsets, oldCap, out->cap);
+    out->lines = GROW_ARR(int, out->lines, oldCap, out->cap);
+  }
+
+  const size_t length = instrLength(instr[0]);
+
+  out->offsets[out->count] = out->codeLength;
+  out->lines[out->count] = line;
+  out->count++;
+
+  memcpy(out->code + out->codeLength, instr, length);
+  out->codeLength += length;
+}
+
+static void popInstrs(Output *out, size_t count) {
+  out->count -= count;
+  out->codeLength = out->offsets[out->count];
+}
+
+static bool matches(Output *out, const Pattern *pattern) {
+  if (out->count < pattern->fromLength) {
+    return false;
+  }
+
+  const size_t first = out->count - pattern->fromLength;
+
+  for (size_t i = 0; i < pattern->fromLength; i++) {
+    if (out->code[out->offsets[first + i]] != pattern->from[i]) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+// rewrites the end of `out` for as long as some pattern matches it, since a
+// rewrite may leave behind something that matches again (like `not not not
+// not`.)
+static void rewriteTail(Output *out) {
+  bool rewrote = true;
+
+  while (rewrote) {
+    rewrote = false;
+
+    for (size_t i = 0; i < PATTERN_COUNT; i++) {
+      const Pattern *pattern = &patterns[i];
+
+      if (!matches(out, pattern)) {
+        continue;
+      }
+
+      const size_t first = out->count - pattern->fromLength;
+      const int line = out->lines[first];
+
+#ifdef DEBUG_PEEPHOLE
+      fprintf(
+        stderr,
+        "peephole: %s on line %d\n",
+        pattern->name,
+        line
+      );
+#else
+      IGNORE(pattern->name);
+#endif
+
+      popInstrs(out, pattern->fromLength);
+
+      for (size_t j = 0; j < pattern->toLength; j++) {
+        pushInstr(out, &pattern->to[j], line);
+      }
+
+      rewrote = true;
+      break;
+    }
+  }
+}
+
+// rewrites common instruction sequences into cheaper ones.  nothing jumps
+// yet, so the only thing tied to code offsets that needs fixing up is the
+// line table, which we rebuild from scratch.
+void optimizeChunk(Chunk *ch) {
+  // rewriting never makes the code longer, so the old size always suffices.
+  Output out = {
+    .cap = 0,
+    .count = 0,
+    .offsets = NULL,
+    .lines = NULL,
+    .codeLength = 0,
+    .code = ALLOC(uint8_t, ch->next)
+  };
+
+  size_t offset = 0;
+
+  while (offset < ch->next) {
+    pushInstr(&out, &ch->code[offset], getLine(ch, offset));
+    rewriteTail(&out);
+
+    offset += instrLength(ch->code[offset]);
+  }
+
+  const size_t codeCap = ch->next;
+
+  freeLineArr(&ch->lines);
+  FREE_ARR(uint8_t, ch->code, ch->cap);
+
+  ch->code = NULL;
+  ch->cap = 0;
+  ch->next = 0;
+
+  for (size_t i = 0; i < out.count; i++) {
+    const size_t start = out.offsets[i];
+    const size_t end = i + 1 < out.count ? out.offsets[i + 1] : out.codeLength;
+
+    for (size_t j = start; j < end; j++) {
+      writeChunk(ch, out.code[j], out.lines[i]);
+    }
+  }
+
+  FREE_ARR(size_t, out.offsets, out.cap);
+  FREE_ARR(int, out.lines, out.cap);
+  FREE_ARR(uint8_t, out.code, codeCap);
+}
@@ -0,0 +1,432 @@
+#include "emit.h"
+#include "mem.h"
+#include "obj.h"
+#include "regemit.h"
+
+// a register, or a constant as `-(index + 1)`.  which slot a constant ends
+// up in depends on how many registers there are, which is only known once
+// everything has been emitted.
+typedef int32_t Operand;
+
+typedef struct {
+  uint8_t op;
+  Operand dst;
+  Operand a;
+  Operand b;
+} Pending;
+
+typedef struct {
+  VM *vm;
+  Tree *tree;
+  RegChunk *rc;
+
+  size_t cap;
+  size_t count;
+  Pending *code;
+
+  // registers are handed out like a stack.  an operation’s operands are
+  // always the last registers taken, so they’re given back before its
+  // result takes one, and the result usually reuses the first of them.
+  Operand nextReg;
+  Operand maxRegs;
+} RegEmitter;
+
+static Operand emitRegNode(RegEmitter *em, NodeId node);
+
+static void emitPending(
+  RegEmitter *em,
+  RegOp op,
+  Operand dst,
+  Operand a,
+  Operand b
+) {
+  if (em->count == em->cap) {
+    const size_t oldCap = em->cap;
+
+    em->cap = GROW_CAP(oldCap);
+    em->code = GROW_ARR(Pending, em->code, oldCap, em->cap);
+  }
+
+  const Pending instr = {
+    .op = (uint8_t)op,
+    .dst = dst,
+    .a = a,
+    .b = b
+  };
+
+  em->code[em->count++] = instr;
+}
+
+static Operand takeReg(RegEmitter *em) {
+  const Operand reg = em->nextReg++;
+
+  if (em->nextReg > em->maxRegs) {
+    em->maxRegs = em->nextReg;
+  }
+
+  return reg;
+}
+
+// constants don’t take up a register, so there’s nothing to give back.
+static void giveBack(RegEmitter *em, Operand operand) {
+  if (operand >= 0) {
+    em->nextReg--;
+  }
+}
+
+static Operand constOperand(RegEmitter *em, Val val) {
+  return -(Operand)addConst(&em->rc->pool, val) - 1;
+}
+
+// an Int that’s about to become a Float is converted here, so that it
+// doesn’t take an instruction at runtime.  it’s made an Int first all the
+// same, in case that wraps it around.
+static Operand intOperand(RegEmitter *em, long value, bool asFloat) {
+  const Val val = INT_VAL((int64_t)value);
+
+  return constOperand(em, asFloat ? NUM_VAL((double)VAL_AS_INT(val)) : val);
+}
+
+// all zeroes are positive, like they are as `OP_FLOAT_ZERO`.
+static Operand floatOperand(RegEmitter *em, double value) {
+  return constOperand(em, NUM_VAL(value == 0 ? 0 : value));
+}
+
+static Operand strOperand(RegEmitter *em, StrLit lit) {
+  // a string we own goes away with the tree, so it needs a copy.
+  ObjStr *str = (
+    lit.isOwned ?
+    allocStr(em->vm, lit.chars, lit.length) :
+    borrowStr(em->vm, lit.chars, lit.length)
+  );
+
+  return constOperand(em, OBJ_VAL(str));
+}
+
+// the result of a unary operation, which takes its operand’s register if it
+// had one.
+static Operand emitUnary(RegEmitter *em, RegOp op, Operand operand) {
+  giveBack(em, operand);
+
+  const Operand dst = takeReg(em);
+
+  emitPending(em, op, dst, operand, 0);
+  return dst;
+}
+
+static Operand emitRegOperand(RegEmitter *em, NodeId node, bool asFloat) {
+  Tree *tree = em->tree;
+
+  if (!asFloat || !checkType(tree, node, TYPE_INT)) {
+    return emitRegNode(em, node);
+  }
+
+  if (NODE_TYPE(tree, node) == NODE_INT) {
+    return intOperand(em, NODE_AS_INT(tree, node), true);
+  }
+
+  return emitUnary(em, REG_INT_TO_FLOAT, emitRegNode(em, node));
+}
+
+static bool isConcat(Tree *tree, NodeId node) {
+  return (
+    NODE_TYPE(tree, node) == NODE_BINOP &&
+    NODE_OP(tree, node) == TOK_PLUS &&
+    checkType(tree, node, TYPE_STR)
+  );
+}
+
+// `REG_CONCAT_N` wants its pieces in consecutive registers, which they are
+// as long as each one takes the next register.  they’re joined a group at
+// a time, like the stack emitter’s `emitPieces()` does, and each group
+// becomes the first piece of the next one.
+static void emitRegPieces(
+  RegEmitter *em,
+  NodeId node,
+  Operand first,
+  int *count
+) {
+  Tree *tree = em->tree;
+
+  if (isConcat(tree, node)) {
+    emitRegPieces(em, NODE_LEFT(tree, node), first, count);
+    emitRegPieces(em, NODE_RIGHT(tree, node), first, count);
+    return;
+  }
+
+  const Operand piece = emitRegNode(em, node);
+
+  if (piece < 0) {
+    emitPending(em, REG_MOVE, takeReg(em), piece, 0);
+  }
+
+  if (++*count == MAX_CONCAT_PIECES) {
+    emitPending(em, REG_CONCAT_N, first, first, *count);
+
+    em->nextReg = first + 1;
+    *count = 1;
+  }
+}
+
+static Operand emitRegConcat(RegEmitter *em, NodeId node) {
+  Tree *tree = em->tree;
+  const NodeId left = NODE_LEFT(tree, node);
+  const NodeId right = NODE_RIGHT(tree, node);
+
+  // a lone pair needs no moving around.
+  if (!isConcat(tree, left) && !isConcat(tree, right)) {
+    const Operand a = emitRegNode(em, left);
+    const Operand b = emitRegNode(em, right);
+
+    giveBack(em, b);
+    giveBack(em, a);
+
+    const Operand dst = takeReg(em);
+
+    emitPending(em, REG_CONCAT, dst, a, b);
+    return dst;
+  }
+
+  const Operand first = em->nextReg;
+  int count = 0;
+
+  emitRegPieces(em, left, first, &count);
+  emitRegPieces(em, right, first, &count);
+
+  if (count == 2) {
+    emitPending(em, REG_CONCAT, first, first, first + 1);
+  } else if (count > 2) {
+    emitPending(em, REG_CONCAT_N, first, first, count);
+  }
+
+  em->nextReg = first + 1;
+  return first;
+}
+
+static RegOp intOp(TokType op) {
+  switch (op) {
+    case TOK_PLUS:
+      return REG_INT_ADD;
+
+    case TOK_MINUS:
+      return REG_INT_SUB;
+
+    case TOK_STAR:
+      return REG_INT_MUL;
+
+    case TOK_SHL:
+      return REG_INT_SHL;
+
+    case TOK_SHR:
+      return REG_INT_SHR;
+
+    case TOK_BIT_AND:
+      return REG_INT_BIT_AND;
+
+    case TOK_BIT_XOR:
+      return REG_INT_BIT_XOR;
+
+    case TOK_PIPE:
+      return REG_INT_BIT_OR;
+
+    case TOK_GREATER:
+      return REG_INT_GREATER;
+
+    case TOK_LESS:
+      return REG_INT_LESS;
+
+    case TOK_GREATER_EQUAL:
+      return REG_INT_GREATER_EQ;
+
+    default:
+      return REG_INT_LESS_EQ;
+  }
+}
+
+static RegOp floatOp(TokType op) {
+  switch (op) {
+    case TOK_PLUS:
+      return REG_FLOAT_ADD;
+
+    case TOK_MINUS:
+      return REG_FLOAT_SUB;
+
+    case TOK_STAR:
+      return REG_FLOAT_MUL;
+
+    case TOK_SLASH:
+      return REG_FLOAT_DIV;
+
+    case TOK_GREATER:
+      return REG_FLOAT_GREATER;
+
+    case TOK_LESS:
+      return REG_FLOAT_LESS;
+
+    case TOK_GREATER_EQUAL:
+      return REG_FLOAT_GREATER_EQ;
+
+    default:
+      return REG_FLOAT_LESS_EQ;
+  }
+}
+
+static Operand emitRegBinOp(RegEmitter *em, NodeId node) {
+  Tree *tree = em->tree;
+  const TokType op = NODE_OP(tree, node);
+  const NodeId left = NODE_LEFT(tree, node);
+  const NodeId right = NODE_RIGHT(tree, node);
+
+  if (isConcat(tree, node)) {
+    return emitRegConcat(em, node);
+  }
+
+  RegOp regOp;
+  bool isFloat = false;
+
+  if (op == TOK_EQUAL || op == TOK_NEQUAL) {
+    regOp = op == TOK_EQUAL ? REG_EQ : REG_NEQ;
+  } else {
+    isFloat = isFloatOp(
+      NODE_VAL_TYPE(tree, left),
+      op,
+      NODE_VAL_TYPE(tree, right)
+    );
+    regOp = isFloat ? floatOp(op) : intOp(op);
+  }
+
+  const Operand a = emitRegOperand(em, left, isFloat);
+  const Operand b = emitRegOperand(em, right, isFloat);
+
+  giveBack(em, b);
+  giveBack(em, a);
+
+  const Operand dst = takeReg(em);
+
+  emitPending(em, regOp, dst, a, b);
+  return dst;
+}
+
+// the combined operations are applied in the same order as in
+// `emitUnOpcode()`.
+static Operand emitRegUnOp(RegEmitter *em, NodeId node) {
+  Tree *tree = em->tree;
+  const UnOpType op = NODE_OP(tree, node);
+  const NodeId operand = NODE_OPERAND(tree, node);
+
+  const RegOp negOp = (
+    checkType(tree, operand, TYPE_FLOAT) ? REG_FLOAT_NEG : REG_INT_NEG
+  );
+
+  Operand result = emitRegNode(em, operand);
+
+  if (op == UNOP_NOT) {
+    return emitUnary(em, REG_NOT, result);
+  }
+
+  if (op & UNOP_IS_NIL) {
+    result = emitUnary(em, REG_IS_NIL, result);
+  }
+
+  if (op & UNOP_IS_ZERO) {
+    result = emitUnary(em, REG_IS_ZERO, result);
+  }
+
+  if (op & UNOP_IS_NEG_ONE) {
+    result = emitUnary(em, REG_IS_MINUS_ONE, result);
+  }
+
+  if (op & UNOP_NEG) {
+    result = emitUnary(em, negOp, result);
+  }
+
+  return result;
+}
+
+static Operand emitRegNode(RegEmitter *em, NodeId node) {
+  Tree *tree = em->tree;
+
+  switch (NODE_TYPE(tree, node)) {
+    case NODE_BINOP:
+      return emitRegBinOp(em, node);
+
+    case NODE_UNOP:
+      return emitRegUnOp(em, node);
+
+    case NODE_INT:
+      return intOperand(em, NODE_AS_INT(tree, node), false);
+
+    case NODE_FLOAT:
+      return floatOperand(em, NODE_AS_FLOAT(tree, node));
+
+    case NODE_BOOL:
+      return constOperand(em, BOOL_VAL(NODE_AS_BOOL(tree, node)));
+
+    case NODE_NIL:
+      return constOperand(em, NIL_VAL);
+
+    case NODE_STR:
+      return strOperand(em, NODE_AS_STR(tree, node));
+  }
+
+  return constOperand(em, NIL_VAL);
+}
+
+// constants go right after the registers.
+static uint8_t slotOf(RegEmitter *em, Operand operand) {
+  if (operand >= 0) {
+    return (uint8_t)operand;
+  }
+
+  return (uint8_t)(em->maxRegs - operand - 1);
+}
+
+bool emitRegs(VM *vm, Tree *tree, NodeId root, RegChunk *rc) {
+  RegEmitter em = {
+    .vm = vm,
+    .tree = tree,
+    .rc = rc,
+    .cap = 0,
+    .count = 0,
+    .code = NULL,
+    .nextReg = 0,
+    .maxRegs = 0
+  };
+
+  rootChunk(vm, &rc->pool);
+
+  const Operand result = emitRegNode(&em, root);
+  emitPending(&em, REG_RET, 0, result, 0);
+
+  const size_t frameSize = (size_t)em.maxRegs + rc->pool.consts.next;
+  const bool fits = frameSize <= REG_FRAME_MAX;
+
+  for (size_t i = 0; fits && i < em.count; i++) {
+    const Pending pending = em.code[i];
+
+    // the count of a `REG_CONCAT_N` is no slot.
+    const RegInstr instr = {
+      .op = pending.op,
+      .dst = slotOf(&em, pending.dst),
+      .a = slotOf(&em, pending.a),
+      .b = (
+        pending.op == REG_CONCAT_N ?
+        (uint8_t)pending.b :
+        slotOf(&em, pending.b)
+      )
+    };
+
+    writeRegInstr(rc, instr);
+  }
+
+  if (fits) {
+    rc->regCount = (uint8_t)em.maxRegs;
+  } else {
+    freeRegChunk(rc);
+    *rc = newRegChunk();
+  }
+
+  FREE_ARR(Pending, em.code, em.cap);
+
+  return fits;
+}
@@ -90,11 +90,17 @@ void showHint(ErrMod mod, const char *fmt, ...) {
 void suggestFix(ErrMod mod, Loc fixLoc, const char *fmt, ...) {
   va_list args;
 
+  va_list again;
+
   va_start(args, fmt);
 
+  // rendering the line uses `args` up, and the highlight needs them again.
+  va_copy(again, args);
+
   renderModifiedLine(fixLoc, mod.src, fmt, args);
-  highlightChange(fixLoc, fmt, args);
+  highlightChange(fixLoc, fmt, again);
 
+  va_end(again);
   va_end(args);
 }
 
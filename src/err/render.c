@@ -208,9 +208,15 @@ void renderFix(Loc fixLoc, const char *fmt, va_list args) {
 
   writeLinePipes(newLineDigits, fixLoc.line);
 
+  // printing the fix uses `args` up, and the highlight needs them again.
+  va_list again;
+  va_copy(again, args);
+
   write(GREEN);
   vfprintf(stderr, fmt, args);
-  highlightChange(fixLoc, fmt, args);
+  highlightChange(fixLoc, fmt, again);
+
+  va_end(again);
 
   endFormat();
 }
@@ -0,0 +1,320 @@
+#include <string.h>
+
+#include "fold.h"
+
+static bool isConst(Tree *tree, NodeId node) {
+  switch (NODE_TYPE(tree, node)) {
+    case NODE_INT:
+    case NODE_FLOAT:
+    case NODE_BOOL:
+    case NODE_NIL:
+    case NODE_STR:
+      return true;
+
+    default:
+      return false;
+  }
+}
+
+static double asFloat(Tree *tree, NodeId node) {
+  if (NODE_TYPE(tree, node) == NODE_INT) {
+    return (double)NODE_AS_INT(tree, node);
+  }
+
+  return NODE_AS_FLOAT(tree, node);
+}
+
+// the folded node replaces the old one in place, so that whoever points to
+// it doesn’t have to know anything changed.  its children stay in the tree
+// until compilation ends, but nothing reaches them anymore.
+static void become(Tree *tree, NodeId node, NodeType type, TypeId valType) {
+  tree->spans[node] = getFullSpan(tree, node);
+  tree->nodeTypes[node] = (uint8_t)type;
+  tree->valTypes[node] = valType;
+  tree->ops[node] = 0;
+}
+
+static void becomeInt(Tree *tree, NodeId node, long value) {
+  become(tree, node, NODE_INT, TYPE_INT);
+  tree->data[node].i = value;
+}
+
+static void becomeFloat(Tree *tree, NodeId node, double value) {
+  become(tree, node, NODE_FLOAT, TYPE_FLOAT);
+  tree->data[node].f = value;
+}
+
+static void becomeBool(Tree *tree, NodeId node, bool value) {
+  become(tree, node, NODE_BOOL, TYPE_BOOL);
+  tree->data[node].b = value;
+}
+
+// the characters live in the arena, so the node’s span can keep pointing at
+// the whole expression it came from.
+static void becomeStr(Tree *tree, NodeId node, char *chars, size_t length) {
+  become(tree, node, NODE_STR, TYPE_STR);
+  tree->data[node].str = addStrLit(tree, chars, length, true);
+}
+
+static void foldIntBinOp(Tree *tree, NodeId node) {
+  const TokType op = NODE_OP(tree, node);
+
+  const long a = NODE_AS_INT(tree, NODE_LEFT(tree, node));
+  const long b = NODE_AS_INT(tree, NODE_RIGHT(tree, node));
+
+  // everything goes through the bit pattern, like it does in the VM, so
+  // that the result wraps around wherever the VM’s would.
+  long result = 0;
+
+  switch (op) {
+    case TOK_PLUS:
+      result = (long)((unsigned long)a + (unsigned long)b);
+      break;
+
+    case TOK_MINUS:
+      result = (long)((unsigned long)a - (unsigned long)b);
+      break;
+
+    case TOK_STAR:
+      result = (long)((unsigned long)a * (unsigned long)b);
+      break;
+
+    case TOK_SHL:
+      result = (long)((unsigned long)a << (b & SHIFT_MASK));
+      break;
+
+    case TOK_SHR:
+      result = a >> (b & SHIFT_MASK);
+      break;
+
+    case TOK_BIT_AND:
+      result = a & b;
+      break;
+
+    case TOK_BIT_XOR:
+      result = a ^ b;
+      break;
+
+    case TOK_PIPE:
+      result = a | b;
+      break;
+
+    case TOK_EQUAL:
+      becomeBool(tree, node, a == b);
+      return;
+
+    case TOK_NEQUAL:
+      becomeBool(tree, node, a != b);
+      return;
+
+    case TOK_GREATER:
+      becomeBool(tree, node, a > b);
+      return;
+
+    case TOK_LESS:
+      becomeBool(tree, node, a < b);
+      return;
+
+    case TOK_GREATER_EQUAL:
+      becomeBool(tree, node, a >= b);
+      return;
+
+    case TOK_LESS_EQUAL:
+      becomeBool(tree, node, a <= b);
+      return;
+
+    default:
+      return;
+  }
+
+  becomeInt(tree, node, (long)wrapInt(result));
+}
+
+static void foldFloatBinOp(Tree *tree, NodeId node) {
+  const double a = asFloat(tree, NODE_LEFT(tree, node));
+  const double b = asFloat(tree, NODE_RIGHT(tree, node));
+
+  switch (NODE_OP(tree, node)) {
+    case TOK_PLUS:
+      becomeFloat(tree, node, a + b);
+      break;
+
+    case TOK_MINUS:
+      becomeFloat(tree, node, a - b);
+      break;
+
+    case TOK_STAR:
+      becomeFloat(tree, node, a * b);
+      break;
+
+    case TOK_SLASH:
+      becomeFloat(tree, node, a / b);
+      break;
+
+    case TOK_EQUAL:
+      becomeBool(tree, node, a == b);
+      break;
+
+    case TOK_NEQUAL:
+      becomeBool(tree, node, a != b);
+      break;
+
+    case TOK_GREATER:
+      becomeBool(tree, node, a > b);
+      break;
+
+    case TOK_LESS:
+      becomeBool(tree, node, a < b);
+      break;
+
+    case TOK_GREATER_EQUAL:
+      becomeBool(tree, node, a >= b);
+      break;
+
+    case TOK_LESS_EQUAL:
+      becomeBool(tree, node, a <= b);
+      break;
+
+    default:
+      break;
+  }
+}
+
+static void foldStrBinOp(Ctx *ctx, NodeId node) {
+  Tree *tree = &ctx->tree;
+
+  const StrLit a = NODE_AS_STR(tree, NODE_LEFT(tree, node));
+  const StrLit b = NODE_AS_STR(tree, NODE_RIGHT(tree, node));
+
+  const bool areEqual = (
+    a.length == b.length &&
+    memcmp(a.chars, b.chars, a.length) == 0
+  );
+
+  switch (NODE_OP(tree, node)) {
+    case TOK_PLUS: {
+      const size_t length = a.length + b.length;
+      char *chars = arenaAlloc(&ctx->arena, length + 1);
+
+      memcpy(chars, a.chars, a.length);
+      memcpy(chars + a.length, b.chars, b.length);
+      chars[length] = '\0';
+
+      becomeStr(tree, node, chars, length);
+      break;
+    }
+
+    case TOK_EQUAL:
+      becomeBool(tree, node, areEqual);
+      break;
+
+    case TOK_NEQUAL:
+      becomeBool(tree, node, !areEqual);
+      break;
+
+    default:
+      break;
+  }
+}
+
+static void foldBinOp(Ctx *ctx, NodeId node) {
+  Tree *tree = &ctx->tree;
+  const NodeId left = NODE_LEFT(tree, node);
+  const NodeId right = NODE_RIGHT(tree, node);
+
+  if (!isConst(tree, left) || !isConst(tree, right)) {
+    return;
+  }
+
+  if (checkType(tree, left, TYPE_STR) && checkType(tree, right, TYPE_STR)) {
+    foldStrBinOp(ctx, node);
+    return;
+  }
+
+  const TokType op = NODE_OP(tree, node);
+
+  if (checkType(tree, left, TYPE_INT) && checkType(tree, right, TYPE_INT)) {
+    // dividing two Ints still yields a Float.
+    if (op == TOK_SLASH) {
+      foldFloatBinOp(tree, node);
+      return;
+    }
+
+    foldIntBinOp(tree, node);
+    return;
+  }
+
+  if (isNum(tree, left) && isNum(tree, right)) {
+    foldFloatBinOp(tree, node);
+    return;
+  }
+
+  // the only thing left is comparing two Bools or two Nils.
+  if (op != TOK_EQUAL && op != TOK_NEQUAL) {
+    return;
+  }
+
+  bool areEqual = true;
+
+  if (checkType(tree, left, TYPE_BOOL)) {
+    areEqual = NODE_AS_BOOL(tree, left) == NODE_AS_BOOL(tree, right);
+  }
+
+  becomeBool(tree, node, op == TOK_EQUAL ? areEqual : !areEqual);
+}
+
+static void foldUnOp(Tree *tree, NodeId node) {
+  const NodeId operand = NODE_OPERAND(tree, node);
+
+  if (!isConst(tree, operand)) {
+    return;
+  }
+
+  switch (NODE_OP(tree, node)) {
+    case UNOP_NEG:
+      if (NODE_TYPE(tree, operand) == NODE_FLOAT) {
+        becomeFloat(tree, node, -NODE_AS_FLOAT(tree, operand));
+        return;
+      }
+
+      if (NODE_TYPE(tree, operand) == NODE_INT) {
+        const unsigned long bits = (unsigned long)NODE_AS_INT(tree, operand);
+        becomeInt(tree, node, (long)wrapInt((int64_t)(0 - bits)));
+      }
+
+      return;
+
+    case UNOP_NOT:
+      if (NODE_TYPE(tree, operand) == NODE_BOOL) {
+        becomeBool(tree, node, !NODE_AS_BOOL(tree, operand));
+      }
+
+      return;
+
+    default:
+      return;
+  }
+}
+
+// folds every constant subtree into a single literal.  this runs after type
+// checking, so the types on each node can be trusted.  children always come
+// before their parents, so one pass from the first node to the last one sees
+// every operand folded before the operation that uses it.
+void foldConsts(Ctx *ctx) {
+  Tree *tree = &ctx->tree;
+
+  for (NodeId node = 0; node < tree->count; node++) {
+    switch (NODE_TYPE(tree, node)) {
+      case NODE_BINOP:
+        foldBinOp(ctx, node);
+        break;
+
+      case NODE_UNOP:
+        foldUnOp(tree, node);
+        break;
+
+      default:
+        break;
+    }
+  }
+}
@@ -1,75 +1,21 @@
-#include <stdlib.h>
-#include <stdio.h>
+#include <string.h>
 
 #include "ir.h"
+#include "mem.h"
 
-static void freeInt(Int *node) {
-  node->value = 0;
-  node->loc = newLoc();
-}
-
-static void freeFloat(Float *node) {
-  node->value = 0;
-  node->loc = newLoc();
-}
-
-static void freeBool(Bool *node) {
-  node->value = false;
-  node->loc = newLoc();
-}
-
-static void freeStr(Str *node) {
-  if (node->ownsLexeme) {
-    free((char *)node->str.lexeme);
-  } 
-
-  node->str = emptyTok();
-  node->ownsLexeme = false;
-}
-
-/*
-static void freeInterpol(Interpol *node) {
-  if (node->ownsLexeme) {
-    free((char *)node->str.lexeme);
-  }
-
-  node->str = emptyTok();
-  node->ownsLexeme = false;
-
-  freeNode(node->expr);
-  freeNode(node->next);
-}
-*/
-
-static void freeUnOp(UnOp *node) {
-  node->op = emptyTok();
-  freeNode(node->operand);
-}
-
-static void freeBinOp(BinOp *node) {
-  freeNode(node->left);
-  node->op = emptyTok();
-  freeNode(node->right);
-}
-
-static Type inferUnOp(TypeTable *table, UnOp node) {
-  Tok op = node.op;
-
-  if (op.type == TOK_NOT) {
-    return *table->boolType;
+TypeId inferUnOp(UnOpType op, TypeId operandType) {
+  if (op == UNOP_NOT) {
+    return TYPE_BOOL;
   }
 
-  return inferType(table, node.operand);
+  return operandType;
 }
 
-static Type inferBinOp(TypeTable *table, BinOp node) {
-  const Type leftType = inferType(table, node.left);
-  const Type rightType = inferType(table, node.right);
-
-  switch (node.op.type) {
+TypeId inferBinOp(TypeId leftType, TokType op, TypeId rightType) {
+  switch (op) {
     case TOK_PLUS:
-      if (leftType.kind == TYPE_STR && rightType.kind == TYPE_STR) {
-        return *table->strType; 
+      if (leftType == TYPE_STR && rightType == TYPE_STR) {
+        return TYPE_STR;
       }
 
       __attribute__ ((fallthrough));
@@ -82,298 +28,300 @@ static Type inferBinOp(TypeTable *table, BinOp node) {
         return leftType;
       }
 
-      if (leftType.kind == TYPE_FLOAT || rightType.kind == TYPE_FLOAT) {
-        return *table->floatType;
-      } 
+      if (leftType == TYPE_FLOAT || rightType == TYPE_FLOAT) {
+        return TYPE_FLOAT;
+      }
 
       break;
 
     case TOK_SLASH:
-      return *table->floatType;
+      return TYPE_FLOAT;
 
     case TOK_SHL:
     case TOK_SHR:
     case TOK_BIT_AND:
     case TOK_BIT_XOR:
     case TOK_PIPE:
-      return *table->intType;
+      return TYPE_INT;
 
     default:
-      return *table->boolType;
+      return TYPE_BOOL;
   }
 
-  return unknownType();
+  return TYPE_UNKNOWN;
 }
 
-Node *newInt(TypeTable *table, long value, Loc loc) {
-  Int i = {
-    .value = value,
-    .loc = loc
+Tree newTree(const char *src, size_t srcLength) {
+  Tree tree = {
+    .src = src,
+    .srcLength = srcLength,
+    .cap = 0,
+    .count = 0,
+    .nodeTypes = NULL,
+    .valTypes = NULL,
+    .ops = NULL,
+    .data = NULL,
+    .spans = NULL,
+    .strCap = 0,
+    .strCount = 0,
+    .strs = NULL,
+    .lineCap = 0,
+    .lineCount = 0,
+    .lineStarts = NULL
   };
 
-  Node *node = malloc(sizeof (*node));
-  node->type = NODE_INT;
-  node->valType = *table->intType;
+  return tree;
+}
 
-  node->as.i = i;
+void freeTree(Tree *tree) {
+  FREE_ARR(uint8_t, tree->nodeTypes, tree->cap);
+  FREE_ARR(TypeId, tree->valTypes, tree->cap);
+  FREE_ARR(uint8_t, tree->ops, tree->cap);
+  FREE_ARR(NodeData, tree->data, tree->cap);
+  FREE_ARR(Span, tree->spans, tree->cap);
+  FREE_ARR(StrLit, tree->strs, tree->strCap);
+  FREE_ARR(uint32_t, tree->lineStarts, tree->lineCap);
 
-  return node;
+  *tree = newTree(tree->src, tree->srcLength);
 }
 
-Node *newFloat(TypeTable *table, double value, Loc loc) {
-  Float f = {
-    .value = value,
-    .loc = loc
-  };
+static NodeId addNode(Tree *tree, NodeType type, TypeId valType, Span span) {
+  if (tree->count == tree->cap) {
+    const size_t oldCap = tree->cap;
+    tree->cap = GROW_CAP(oldCap);
+
+    tree->nodeTypes = GROW_ARR(uint8_t, tree->nodeTypes, oldCap, tree->cap);
+    tree->valTypes = GROW_ARR(TypeId, tree->valTypes, oldCap, tree->cap);
+    tree->ops = GROW_ARR(uint8_t, tree->ops, oldCap, tree->cap);
+    tree->data = GROW_ARR(NodeData, tree->data, oldCap, tree->cap);
+    tree->spans = GROW_ARR(Span, tree->spans, oldCap, tree->cap);
+  }
 
-  Node *node = malloc(sizeof (*node));
-  node->type = NODE_FLOAT;
-  node->valType = unknownType();
-  node->valType = *table->floatType;
+  const NodeId node = (NodeId)tree->count++;
 
-  node->as.f = f;
+  tree->nodeTypes[node] = (uint8_t)type;
+  tree->valTypes[node] = valType;
+  tree->ops[node] = 0;
+  tree->spans[node] = span;
 
   return node;
 }
 
-Node *newBool(TypeTable *table, bool value, Loc loc) {
-  Bool b = {
-    .value = value,
-    .loc = loc
-  };
-
-  Node *node = malloc(sizeof (*node));
-  node->type = NODE_BOOL;
-  node->valType = unknownType();
-  node->valType = *table->boolType;
-
-  node->as.b = b;
+NodeId newInt(Tree *tree, long value, Span span) {
+  const NodeId node = addNode(tree, NODE_INT, TYPE_INT, span);
+  tree->data[node].i = value;
 
   return node;
 }
 
-Node *newNil(TypeTable *table, Loc loc) {
-  Node *node = malloc(sizeof (*node));
-  node->type = NODE_NIL;
-  node->valType = unknownType();
-  node->valType = *table->nilType;
-
-  node->as.nilLoc = loc;
+NodeId newFloat(Tree *tree, double value, Span span) {
+  const NodeId node = addNode(tree, NODE_FLOAT, TYPE_FLOAT, span);
+  tree->data[node].f = value;
 
   return node;
 }
 
-Node *newStr(TypeTable *table, Tok tok) {
-  Str str = {
-    .str = tok,
-    .ownsLexeme = false
-  };
-
-  Node *node = malloc(sizeof (*node));
-  node->type = NODE_STR;
-  node->valType = unknownType();
-  node->valType = *table->strType;
-
-  node->as.str = str;
+NodeId newBool(Tree *tree, bool value, Span span) {
+  const NodeId node = addNode(tree, NODE_BOOL, TYPE_BOOL, span);
+  tree->data[node].b = value;
 
   return node;
 }
 
-/*
-Node *newInterpol(TypeTable *table, Tok tok, Node *expr, Node *next) {
-  Interpol interpol = {
-    .str = tok,
-    .expr = expr,
-    .next = next
+NodeId newNil(Tree *tree, Span span) {
+  return addNode(tree, NODE_NIL, TYPE_NIL, span);
+}
+
+uint32_t addStrLit(
+  Tree *tree,
+  const char *chars,
+  size_t length,
+  bool isOwned
+) {
+  if (tree->strCount == tree->strCap) {
+    const size_t oldCap = tree->strCap;
+    tree->strCap = GROW_CAP(oldCap);
+    tree->strs = GROW_ARR(StrLit, tree->strs, oldCap, tree->strCap);
+  }
+
+  StrLit str = {
+    .chars = chars,
+    .length = length,
+    .isOwned = isOwned
   };
 
-  Node *node = malloc(sizeof (*node));
-  node->type = NODE_INTERPOL;
-  node->valType = unknownType();
-  node->valType = *table->strType;
+  tree->strs[tree->strCount] = str;
+
+  return (uint32_t)tree->strCount++;
+}
 
-  node->as.interpol = interpol;
+NodeId newStr(
+  Tree *tree,
+  const char *chars,
+  size_t length,
+  bool isOwned,
+  Span span
+) {
+  const uint32_t str = addStrLit(tree, chars, length, isOwned);
+  const NodeId node = addNode(tree, NODE_STR, TYPE_STR, span);
+  tree->data[node].str = str;
 
-  fprintf(stderr, "node: %p\n", (void *)node);
-  
   return node;
 }
-*/
 
-Node *newUnOp(TypeTable *table, Tok op, UnOpType opType, Node *operand) {
-  UnOp unOp = {
-    .op = op,
-    .opType = opType,
-    .operand = operand
-  };
-
-  Node *node = malloc(sizeof (*node));
-  node->type = NODE_UNOP;
-  node->valType = unknownType();
-  node->valType = inferUnOp(table, unOp);
+NodeId newUnOp(Tree *tree, UnOpType op, NodeId operand, Span span) {
+  const TypeId valType = inferUnOp(op, NODE_VAL_TYPE(tree, operand));
+  const NodeId node = addNode(tree, NODE_UNOP, valType, span);
 
-  node->as.unOp = unOp;
+  tree->ops[node] = (uint8_t)op;
+  tree->data[node].kids.left = operand;
+  tree->data[node].kids.right = operand;
 
   return node;
 }
 
-Node *newBinOp(TypeTable *table, Node *left, Tok op, Node *right) {
-  BinOp binOp = {
-    .left = left,
-    .op = op,
-    .right = right
-  };
+NodeId newBinOp(Tree *tree, NodeId left, TokType op, NodeId right, Span span) {
+  const TypeId valType = inferBinOp(
+    NODE_VAL_TYPE(tree, left),
+    op,
+    NODE_VAL_TYPE(tree, right)
+  );
+  const NodeId node = addNode(tree, NODE_BINOP, valType, span);
 
-  Node *node = malloc(sizeof (*node));
-  node->type = NODE_BINOP;
-  node->valType = unknownType();
-  node->valType = inferBinOp(table, binOp);
-
-  node->as.binOp = binOp;
+  tree->ops[node] = (uint8_t)op;
+  tree->data[node].kids.left = left;
+  tree->data[node].kids.right = right;
 
   return node;
 }
 
-void freeNode(Node *node) {
-  fprintf(stderr, "freeing: %p\n", (void *)node);
+NodeId rootNode(Tree *tree) {
+  return (NodeId)(tree->count - 1);
+}
 
-  switch (node->type) {
-    case NODE_INT:
-      freeInt(&NODE_AS_INT(node));
-      break;
-    
-    case NODE_FLOAT:
-      freeFloat(&NODE_AS_FLOAT(node));
-      break;
+bool checkType(Tree *tree, NodeId node, TypeId type) {
+  return typesMatch(NODE_VAL_TYPE(tree, node), type);
+}
 
-    case NODE_BOOL:
-      freeBool(&NODE_AS_BOOL(node));
-      break;
-    
-    case NODE_NIL:
-      node->as.nilLoc = newLoc();
-      break;
+bool isNum(Tree *tree, NodeId node) {
+  return checkType(tree, node, TYPE_FLOAT) || checkType(tree, node, TYPE_INT);
+}
 
-    case NODE_STR:
-      freeStr(&NODE_AS_STR(node));
-      break;
-    
-    /*
-    case NODE_INTERPOL:
-      freeInterpol(&NODE_AS_INTERPOL(node));
-      break;
-    */
+// tokens that don’t come from the source, like the one the parser starts
+// with, get an empty span at its very end.
+Span tokSpan(Tree *tree, Tok tok) {
+  const uintptr_t start = (uintptr_t)tree->src;
+  const uintptr_t lexeme = (uintptr_t)tok.lexeme;
 
-    case NODE_UNOP:
-      freeUnOp(&NODE_AS_UNOP(node));
-      break;
+  if (lexeme < start || lexeme - start > tree->srcLength) {
+    Span span = {
+      .start = (uint32_t)tree->srcLength,
+      .length = 0
+    };
 
-    case NODE_BINOP:
-      freeBinOp(&NODE_AS_BINOP(node));
-      break;
+    return span;
   }
 
-  free(node);
-  node = NULL;
-}
+  Span span = {
+    .start = (uint32_t)(lexeme - start),
+    .length = (uint32_t)tok.loc.length
+  };
 
-Type inferType(TypeTable *table, Node *node) {
-  if (isTypeKnown(node->valType)) {
-    return node->valType;
-  }
+  return span;
+}
 
-  switch (node->type) {
-    case NODE_INT:
-      return *table->intType; 
+Span mergeSpans(Span left, Span right) {
+  const uint32_t leftEnd = left.start + left.length;
+  const uint32_t rightEnd = right.start + right.length;
 
-    case NODE_FLOAT:
-      return *table->floatType;
+  const uint32_t start = left.start < right.start ? left.start : right.start;
+  const uint32_t end = leftEnd > rightEnd ? leftEnd : rightEnd;
 
-    case NODE_BOOL:
-      return *table->boolType;
+  Span span = {
+    .start = start,
+    .length = end - start
+  };
 
-    case NODE_NIL:
-      return *table->nilType;
+  return span;
+}
 
-    case NODE_UNOP:
-      return inferUnOp(table, NODE_AS_UNOP(node));
+Span getFullSpan(Tree *tree, NodeId node) {
+  const Span span = NODE_SPAN(tree, node);
 
+  switch (NODE_TYPE(tree, node)) {
     case NODE_BINOP:
-      return inferBinOp(table, NODE_AS_BINOP(node));
+      return mergeSpans(
+        mergeSpans(getFullSpan(tree, NODE_LEFT(tree, node)), span),
+        getFullSpan(tree, NODE_RIGHT(tree, node))
+      );
+
+    case NODE_UNOP:
+      return mergeSpans(span, getFullSpan(tree, NODE_OPERAND(tree, node)));
 
     default:
-      return unknownType();
+      return span;
   }
 }
 
-bool checkType(Node *node, TypeKind kind) {
-  return node->valType.kind == kind;
-}
+static void addLine(Tree *tree, size_t start) {
+  if (tree->lineCount == tree->lineCap) {
+    const size_t oldCap = tree->lineCap;
+    tree->lineCap = GROW_CAP(oldCap);
+    tree->lineStarts = GROW_ARR(
+      uint32_t,
+      tree->lineStarts,
+      oldCap,
+      tree->lineCap
+    );
+  }
 
-bool isNum(Node *node) {
-  return checkType(node, TYPE_FLOAT) || checkType(node, TYPE_INT);
+  tree->lineStarts[tree->lineCount++] = (uint32_t)start;
 }
 
-Loc getLoc(Node *node) {
-  switch (node->type) {
-    case NODE_BINOP:
-      return NODE_AS_BINOP(node).op.loc;
-
-    case NODE_UNOP:
-      return NODE_AS_UNOP(node).op.loc;
-
-    case NODE_INT:
-      return NODE_AS_INT(node).loc;
+static void findLines(Tree *tree) {
+  const char *end = tree->src + tree->srcLength;
+  const char *line = tree->src;
 
-    case NODE_FLOAT:
-      return NODE_AS_FLOAT(node).loc;
+  addLine(tree, 0);
 
-    case NODE_BOOL:
-      return NODE_AS_BOOL(node).loc;
-
-    case NODE_NIL:
-      return NODE_AS_NIL(node);
-
-    case NODE_STR:
-      return NODE_AS_STR(node).str.loc;
+  while ((line = memchr(line, '\n', (size_t)(end - line))) != NULL) {
+    line++;
+    addLine(tree, (size_t)(line - tree->src));
+  }
+}
 
-    /*
-    case NODE_INTERPOL:
-      return NODE_AS_INTERPOL(node).str.loc;
-    */
+Loc spanLoc(Tree *tree, Span span) {
+  if (tree->lineCount == 0) {
+    findLines(tree);
   }
 
-  return newLoc();
-}
+  // the last line that starts at or before the span.
+  size_t low = 0;
+  size_t high = tree->lineCount;
 
-Loc getFullLoc(Node *node) {
-  switch (node->type) {
-    case NODE_BINOP: {
-      BinOp binOp = NODE_AS_BINOP(node);
-      return mergeLocs(
-        mergeLocs(getFullLoc(binOp.left), binOp.op.loc),
-        getFullLoc(binOp.right)
-      );
+  while (high - low > 1) {
+    const size_t mid = low + (high - low) / 2;
+
+    if (tree->lineStarts[mid] <= span.start) {
+      low = mid;
+    } else {
+      high = mid;
     }
+  }
 
-    case NODE_UNOP: {
-      UnOp unOp = NODE_AS_UNOP(node);
+  Loc loc = {
+    .line = (int)low + 1,
+    .col = (int)(span.start - tree->lineStarts[low]) + 1,
+    .length = span.length
+  };
 
-      return mergeLocs(unOp.op.loc, getFullLoc(unOp.operand));
-    }
+  return loc;
+}
 
-    /*
-    case NODE_INTERPOL: {
-      Interpol interpol = NODE_AS_INTERPOL(node);
+Loc getLoc(Tree *tree, NodeId node) {
+  return spanLoc(tree, NODE_SPAN(tree, node));
+}
 
-      return mergeLocs(
-        interpol.str.loc,
-        mergeLocs(getFullLoc(interpol.expr), getFullLoc(interpol.next))
-      );
-    }
-    */
-    
-    default:
-      return getLoc(node);
-  }
+Loc getFullLoc(Tree *tree, NodeId node) {
+  return spanLoc(tree, getFullSpan(tree, node));
 }
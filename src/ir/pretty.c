@@ -25,47 +25,41 @@ static void unindent(PrettyPrinter *printer) {
   printer->indentation -= 2;
 }
 
-static void printNode(PrettyPrinter *printer, Node *node);
-
-static void printBinOp(PrettyPrinter *printer, BinOp binOp) {
-  Tok op = binOp.op;
+static void printNode(PrettyPrinter *printer, Tree *tree, NodeId node);
 
+static void printBinOp(PrettyPrinter *printer, Tree *tree, NodeId node) {
   write("( ");
 
-  printNode(printer, binOp.left);
-  write(" %.*s ", SHOW_LEXEME(op)); 
-  printNode(printer, binOp.right);
+  printNode(printer, tree, NODE_LEFT(tree, node));
+  write(" %.*s ", SHOW_SPAN(tree, NODE_SPAN(tree, node))); 
+  printNode(printer, tree, NODE_RIGHT(tree, node));
 
   write(" )");
 }
 
-static void printUnOp(PrettyPrinter *printer, UnOp unOp) {
-  Tok op = unOp.op;
-
+static void printUnOp(PrettyPrinter *printer, Tree *tree, NodeId node) {
   write("( ");
 
-  write("%.*s ", SHOW_LEXEME(op));
-  printNode(printer, unOp.operand); 
+  write("%.*s ", SHOW_SPAN(tree, NODE_SPAN(tree, node)));
+  printNode(printer, tree, NODE_OPERAND(tree, node));
 
   write(" )");
 }
 
-static void printInt(Int i) {
-  write("Int %ld", i.value);
+static void printInt(long i) {
+  write("Int %ld", i);
 }
 
-static void printFloat(Float f) {
-  write("Float %lf", f.value); 
+static void printFloat(double f) {
+  write("Float %lf", f); 
 }
 
-static void printBool(Bool b) {
-  write("Bool %s", b.value ? "true" : "false");
+static void printBool(bool b) {
+  write("Bool %s", b ? "true" : "false");
 }
 
-static void printStr(Str s) {
-  Tok tok = s.str;
-  
-  write("Str %.*s (size %ld)", SHOW_LEXEME(tok), tok.loc.length);
+static void printStr(StrLit s) {
+  write("Str %.*s (size %ld)", (int)s.length, s.chars, s.length);
 }
 
 /*
@@ -79,26 +73,26 @@ static void printInterpol(PrettyPrinter *printer, Interpol i) {
 }
 */
 
-static void printNode(PrettyPrinter *printer, Node *node) {
-  switch (node->type) {
+static void printNode(PrettyPrinter *printer, Tree *tree, NodeId node) {
+  switch (NODE_TYPE(tree, node)) {
     case NODE_BINOP:
-      printBinOp(printer, NODE_AS_BINOP(node));
+      printBinOp(printer, tree, node);
       break;
 
     case NODE_UNOP:
-      printUnOp(printer, NODE_AS_UNOP(node));
+      printUnOp(printer, tree, node);
       break;
 
     case NODE_INT:
-      printInt(NODE_AS_INT(node));
+      printInt(NODE_AS_INT(tree, node));
       break;
 
     case NODE_FLOAT:
-      printFloat(NODE_AS_FLOAT(node));
+      printFloat(NODE_AS_FLOAT(tree, node));
       break;
     
     case NODE_BOOL:
-      printBool(NODE_AS_BOOL(node));
+      printBool(NODE_AS_BOOL(tree, node));
       break;
     
     case NODE_NIL:
@@ -106,7 +100,7 @@ static void printNode(PrettyPrinter *printer, Node *node) {
       break;
 
     case NODE_STR:
-      printStr(NODE_AS_STR(node));
+      printStr(NODE_AS_STR(tree, node));
       break;
 
     /*
@@ -120,7 +114,7 @@ static void printNode(PrettyPrinter *printer, Node *node) {
   }
 }
 
-void prettyPrint(Node *node) {
+void prettyPrint(Tree *tree, NodeId node) {
   IGNORE(newline);
   IGNORE(indent);
   IGNORE(unindent);
@@ -129,7 +123,7 @@ void prettyPrint(Node *node) {
     .indentation = 0
   };
 
-  printNode(&printer, node);
+  printNode(&printer, tree, node);
 
   newline(&printer);
 }
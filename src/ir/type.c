@@ -1,79 +1,48 @@
-#include <stdlib.h>
-
 #include "type.h"
 
-TypeTable *allocTypeTable() {
-  Type *intType = malloc(sizeof (*intType));
-  intType->kind = TYPE_INT;
-  intType->name = "Int";
-
-  Type *floatType = malloc(sizeof (*floatType));
-  floatType->kind = TYPE_FLOAT;
-  floatType->name = "Float";
-
-  Type *boolType = malloc(sizeof (*boolType));
-  boolType->kind = TYPE_BOOL;
-  boolType->name = "Bool";
-
-  Type *nilType = malloc(sizeof (*nilType));
-  nilType->kind = TYPE_NIL;
-  nilType->name = "Nil";
-
-  Type *strType = malloc(sizeof (*strType));
-  strType->kind = TYPE_STR;
-  strType->name = "Str";
+// shared by every compilation in the process.  the primitive types are all
+// there from the start, so compiling doesn’t have to set anything up.
+static Type types[MAX_TYPES] = {
+  [TYPE_UNKNOWN] = { .kind = TYPE_UNKNOWN, .name = "?" },
+  [TYPE_INT]     = { .kind = TYPE_INT,     .name = "Int" },
+  [TYPE_FLOAT]   = { .kind = TYPE_FLOAT,   .name = "Float" },
+  [TYPE_BOOL]    = { .kind = TYPE_BOOL,    .name = "Bool" },
+  [TYPE_NIL]     = { .kind = TYPE_NIL,     .name = "Nil" },
+  [TYPE_STR]     = { .kind = TYPE_STR,     .name = "Str" }
+};
+
+static size_t typeCount = TYPE_STR + 1;
+
+// for types the program defines itself.  `name` has to outlive every
+// compilation that uses the type.  the registry isn’t locked, so types
+// have to be registered before compiling on more than one thread.
+TypeId registerType(TypeKind kind, const char *name) {
+  if (typeCount == MAX_TYPES) {
+    return TYPE_UNKNOWN;
+  }
+
+  Type type = {
+    .kind = kind,
+    .name = name
+  };
 
-  TypeTable *table = malloc(sizeof (*table));
-  table->intType = intType;
-  table->floatType = floatType;
-  table->boolType = boolType;
-  table->nilType = nilType;
-  table->strType = strType;
+  types[typeCount] = type;
 
-  return table;
+  return (TypeId)typeCount++;
 }
 
-bool typesMatch(Type a, Type b) {
-  return a.kind == b.kind;
+const Type *getType(TypeId id) {
+  return &types[id];
 }
 
-bool isTypeKnown(Type t) {
-  return t.kind != TYPE_UNKNOWN;
+const char *typeName(TypeId id) {
+  return types[id].name;
 }
 
-Type unknownType() {
-  Type pending = {
-    .kind = TYPE_UNKNOWN
-  };
-
-  return pending;
+bool typesMatch(TypeId a, TypeId b) {
+  return a == b;
 }
 
-void freeTypeTable(TypeTable *table) {
-  table->intType->kind = TYPE_UNKNOWN;
-  table->floatType->kind = TYPE_UNKNOWN;
-  table->boolType->kind = TYPE_UNKNOWN;
-  table->nilType->kind = TYPE_UNKNOWN;
-  table->strType->kind = TYPE_UNKNOWN;
-
-  table->intType->name = NULL;
-  table->floatType->name = NULL;
-  table->boolType->name = NULL;
-  table->nilType->name = NULL;
-  table->strType->name = NULL;
-
-  free(table->intType);
-  free(table->floatType);
-  free(table->boolType);
-  free(table->nilType);
-  free(table->strType);
-
-  table->intType = NULL;
-  table->floatType = NULL;
-  table->boolType = NULL;
-  table->nilType = NULL;
-  table->strType = NULL;
-
-  free(table);
-  table = NULL;
+bool isTypeKnown(TypeId id) {
+  return id != TYPE_UNKNOWN;
 }
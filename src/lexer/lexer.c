@@ -1,6 +1,7 @@
 #include <string.h>
 
 #include "lexer.h"
+#include "scan.h"
 
 Lexer newLexer(const char *src) {
   Lexer lexer = {
@@ -31,6 +32,10 @@ static bool isAlpha(const char c) {
   );
 }
 
+static bool isSpace(const char c) {
+  return c == ' ' || c == '\r' || c == '\t';
+}
+
 static bool isAtEnd(Lexer *lexer) {
   return *lexer->curr == '\0';
 }
@@ -50,6 +55,12 @@ static char advance(Lexer *lexer) {
   return *lexer->curr++;
 }
 
+// skips to `end`, which is on the same line.
+static void advanceTo(Lexer *lexer, const char *end) {
+  advanceLocBy(&lexer->loc, (size_t)(end - lexer->curr));
+  lexer->curr = end;
+}
+
 static char peek(Lexer *lexer) {
   return *lexer->curr;
 } 
@@ -100,9 +111,7 @@ static Tok unexpectedChar(Lexer *lexer) {
 }
 
 static void skipComment(Lexer *lexer) {
-  while (peek(lexer) != '\n' && !isAtEnd(lexer)) {
-    advance(lexer);
-  }
+  advanceTo(lexer, skipLine(lexer->curr));
 }
 
 static void skipWs(Lexer *lexer) {
@@ -114,6 +123,12 @@ static void skipWs(Lexer *lexer) {
       case '\r':
       case '\t':
         advance(lexer);
+
+        // most runs are the one space between two tokens, which isn’t worth
+        // a trip to the scanner.
+        if (isSpace(peek(lexer))) {
+          advanceTo(lexer, skipSpaces(lexer->curr));
+        }
         break;
 
       case '#':
@@ -298,9 +313,7 @@ static TokType idType(Lexer *lexer) {
 }
 
 static Tok id(Lexer *lexer) {
-  while (isAlpha(peek(lexer)) || isDigit(peek(lexer))) {
-    advance(lexer);
-  }
+  advanceTo(lexer, skipIdChars(lexer->curr));
 
   return makeTok(lexer, idType(lexer));
 }
@@ -345,7 +358,14 @@ static Tok interpol(Lexer *lexer) {
 }
 
 static Tok str(Lexer *lexer) {
-  while (peek(lexer) != '"' && !isAtEnd(lexer)) {
+  while (true) {
+    // only these can end the string, or change where we are in the source.
+    advanceTo(lexer, skipStrChars(lexer->curr));
+
+    if (peek(lexer) == '"' || isAtEnd(lexer)) {
+      break;
+    }
+
     if (peek(lexer) == '\n') {
       newline(lexer);
     }
@@ -0,0 +1,289 @@
+#include "scan.h"
+
+#ifdef SIMD_LEXER
+#include <immintrin.h>
+#endif
+
+typedef const char *(*Skip)(const char *c);
+
+typedef struct {
+  Skip spaces;
+  Skip line;
+  Skip strChars;
+  Skip idChars;
+} Scanner;
+
+static bool isSpace(const char c) {
+  return c == ' ' || c == '\t' || c == '\r';
+}
+
+static bool isIdChar(const char c) {
+  return (
+    (c >= 'a' && c <= 'z') ||
+    (c >= 'A' && c <= 'Z') ||
+    (c >= '0' && c <= '9') ||
+    c == '_'
+  );
+}
+
+static const char *spacesScalar(const char *c) {
+  while (isSpace(*c)) {
+    c++;
+  }
+
+  return c;
+}
+
+static const char *lineScalar(const char *c) {
+  while (*c != '\n' && *c != '\0') {
+    c++;
+  }
+
+  return c;
+}
+
+static const char *strCharsScalar(const char *c) {
+  while (*c != '"' && *c != '#' && *c != '\n' && *c != '\0') {
+    c++;
+  }
+
+  return c;
+}
+
+static const char *idCharsScalar(const char *c) {
+  while (isIdChar(*c)) {
+    c++;
+  }
+
+  return c;
+}
+
+static const Scanner scalar = {
+  .spaces = spacesScalar,
+  .line = lineScalar,
+  .strChars = strCharsScalar,
+  .idChars = idCharsScalar
+};
+
+#ifdef SIMD_LEXER
+// a block is loaded from an address it’s aligned to, so it never reaches
+// into a page the string doesn’t: reading the rest of the block after the
+// '\0' can’t fault.  ASan only sees bytes past the end of an object, though,
+// so it’s told to look away.
+#define SCAN_RUN(name, isa, Block, width, load, stops)                      \
+  __attribute__ ((target(isa), no_sanitize_address))                      \
+  static const char *name(const char *c) {                                \
+    const uintptr_t skew = (uintptr_t)c & ((width) - 1);                   \
+    const Block *block = (const Block *)(c - skew);                         \
+                                                                            \
+    uint32_t found = stops(load(block)) & (UINT32_MAX << skew);             \
+                                                                            \
+    while (found == 0) {                                                    \
+      block++;                                                              \
+      found = stops(load(block));                                           \
+    }                                                                       \
+                                                                            \
+    return (const char *)block + __builtin_ctz(found);                      \
+  }
+
+// one bit per byte of `v` that’s `c`.
+#define SSE2_EQ(v, c) _mm_cmpeq_epi8((v), _mm_set1_epi8(c))
+#define AVX2_EQ(v, c) _mm256_cmpeq_epi8((v), _mm256_set1_epi8(c))
+
+#define SSE2_MASK(v) ((uint32_t)_mm_movemask_epi8(v))
+#define AVX2_MASK(v) ((uint32_t)_mm256_movemask_epi8(v))
+
+// every byte of `v` from `low` to `high`.  bytes past ASCII are negative,
+// so they’re never in range.
+__attribute__ ((target("sse2")))
+static __m128i sse2InRange(__m128i v, char low, char high) {
+  return _mm_and_si128(
+    _mm_cmpgt_epi8(v, _mm_set1_epi8((char)(low - 1))),
+    _mm_cmpgt_epi8(_mm_set1_epi8((char)(high + 1)), v)
+  );
+}
+
+__attribute__ ((target("avx2")))
+static __m256i avx2InRange(__m256i v, char low, char high) {
+  return _mm256_and_si256(
+    _mm256_cmpgt_epi8(v, _mm256_set1_epi8((char)(low - 1))),
+    _mm256_cmpgt_epi8(_mm256_set1_epi8((char)(high + 1)), v)
+  );
+}
+
+__attribute__ ((target("sse2")))
+static uint32_t spaceStopsSse2(__m128i v) {
+  const __m128i spaces = _mm_or_si128(
+    _mm_or_si128(SSE2_EQ(v, ' '), SSE2_EQ(v, '\t')),
+    SSE2_EQ(v, '\r')
+  );
+
+  return ~SSE2_MASK(spaces) & 0xFFFF;
+}
+
+__attribute__ ((target("sse2")))
+static uint32_t lineStopsSse2(__m128i v) {
+  return SSE2_MASK(_mm_or_si128(SSE2_EQ(v, '\n'), SSE2_EQ(v, '\0')));
+}
+
+__attribute__ ((target("sse2")))
+static uint32_t strStopsSse2(__m128i v) {
+  const __m128i stops = _mm_or_si128(
+    _mm_or_si128(SSE2_EQ(v, '"'), SSE2_EQ(v, '#')),
+    _mm_or_si128(SSE2_EQ(v, '\n'), SSE2_EQ(v, '\0'))
+  );
+
+  return SSE2_MASK(stops);
+}
+
+// setting the 0x20 bit folds upper case letters into lower case ones, and
+// nothing else into them.
+__attribute__ ((target("sse2")))
+static uint32_t idStopsSse2(__m128i v) {
+  const __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+  const __m128i idChars = _mm_or_si128(
+    _mm_or_si128(sse2InRange(lower, 'a', 'z'), sse2InRange(v, '0', '9')),
+    SSE2_EQ(v, '_')
+  );
+
+  return ~SSE2_MASK(idChars) & 0xFFFF;
+}
+
+__attribute__ ((target("avx2")))
+static uint32_t spaceStopsAvx2(__m256i v) {
+  const __m256i spaces = _mm256_or_si256(
+    _mm256_or_si256(AVX2_EQ(v, ' '), AVX2_EQ(v, '\t')),
+    AVX2_EQ(v, '\r')
+  );
+
+  return ~AVX2_MASK(spaces);
+}
+
+__attribute__ ((target("avx2")))
+static uint32_t lineStopsAvx2(__m256i v) {
+  return AVX2_MASK(_mm256_or_si256(AVX2_EQ(v, '\n'), AVX2_EQ(v, '\0')));
+}
+
+__attribute__ ((target("avx2")))
+static uint32_t strStopsAvx2(__m256i v) {
+  const __m256i stops = _mm256_or_si256(
+    _mm256_or_si256(AVX2_EQ(v, '"'), AVX2_EQ(v, '#')),
+    _mm256_or_si256(AVX2_EQ(v, '\n'), AVX2_EQ(v, '\0'))
+  );
+
+  return AVX2_MASK(stops);
+}
+
+__attribute__ ((target("avx2")))
+static uint32_t idStopsAvx2(__m256i v) {
+  const __m256i lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+  const __m256i idChars = _mm256_or_si256(
+    _mm256_or_si256(avx2InRange(lower, 'a', 'z'), avx2InRange(v, '0', '9')),
+    AVX2_EQ(v, '_')
+  );
+
+  return ~AVX2_MASK(idChars);
+}
+
+SCAN_RUN(spacesSse2, "sse2", __m128i, 16, _mm_load_si128, spaceStopsSse2)
+SCAN_RUN(lineSse2, "sse2", __m128i, 16, _mm_load_si128, lineStopsSse2)
+SCAN_RUN(strCharsSse2, "sse2", __m128i, 16, _mm_load_si128, strStopsSse2)
+SCAN_RUN(idCharsSse2, "sse2", __m128i, 16, _mm_load_si128, idStopsSse2)
+
+SCAN_RUN(spacesAvx2, "avx2", __m256i, 32, _mm256_load_si256, spaceStopsAvx2)
+SCAN_RUN(lineAvx2, "avx2", __m256i, 32, _mm256_load_si256, lineStopsAvx2)
+SCAN_RUN(strCharsAvx2, "avx2", __m256i, 32, _mm256_load_si256, strStopsAvx2)
+SCAN_RUN(idCharsAvx2, "avx2", __m256i, 32, _mm256_load_si256, idStopsAvx2)
+
+static const Scanner sse2 = {
+  .spaces = spacesSse2,
+  .line = lineSse2,
+  .strChars = strCharsSse2,
+  .idChars = idCharsSse2
+};
+
+static const Scanner avx2 = {
+  .spaces = spacesAvx2,
+  .line = lineAvx2,
+  .strChars = strCharsAvx2,
+  .idChars = idCharsAvx2
+};
+#endif
+
+static const Scanner *scanner = NULL;
+
+ScanLevel bestScanLevel() {
+#ifdef SIMD_LEXER
+  __builtin_cpu_init();
+
+  if (__builtin_cpu_supports("avx2")) {
+    return SCAN_AVX2;
+  }
+
+  // every x86-64 CPU has SSE2.
+  return SCAN_SSE2;
+#else
+  return SCAN_SCALAR;
+#endif
+}
+
+const char *scanLevelName(ScanLevel level) {
+  switch (level) {
+    case SCAN_SSE2:
+      return "sse2";
+
+    case SCAN_AVX2:
+      return "avx2";
+
+    default:
+      return "scalar";
+  }
+}
+
+bool setScanLevel(ScanLevel level) {
+  if (level > bestScanLevel()) {
+    return false;
+  }
+
+  switch (level) {
+#ifdef SIMD_LEXER
+    case SCAN_SSE2:
+      scanner = &sse2;
+      break;
+
+    case SCAN_AVX2:
+      scanner = &avx2;
+      break;
+#endif
+
+    default:
+      scanner = &scalar;
+      break;
+  }
+
+  return true;
+}
+
+static const Scanner *currScanner() {
+  if (scanner == NULL) {
+    setScanLevel(bestScanLevel());
+  }
+
+  return scanner;
+}
+
+const char *skipSpaces(const char *c) {
+  return currScanner()->spaces(c);
+}
+
+const char *skipLine(const char *c) {
+  return currScanner()->line(c);
+}
+
+const char *skipStrChars(const char *c) {
+  return currScanner()->strChars(c);
+}
+
+const char *skipIdChars(const char *c) {
+  return currScanner()->idChars(c);
+}
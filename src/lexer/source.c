@@ -0,0 +1,149 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "source.h"
+
+#define STDIN_PATH "-"
+
+// how much a source we can’t map starts out reading at once.
+#define READ_CHUNK 4096
+
+// maps the file into zeroed pages at least a byte longer than it is.  the
+// part of its last page past the end of the file reads as zeroes, and if the
+// file fills that page, a page of zeroes follows.  either way, the '\0' is
+// there without copying a thing, and pages are only read in once the lexer
+// gets to them.  as with any mapping, a file that’s cut short while we’re
+// still reading it takes the process down with it.
+static bool mapSource(int fd, size_t length, Source *src) {
+  const size_t page = (size_t)sysconf(_SC_PAGESIZE);
+  const size_t size = (length / page + 1) * page;
+
+  // reserves all of it as zeroes first, then puts the file over the start.
+  char *map = mmap(
+    NULL,
+    size,
+    PROT_READ,
+    MAP_PRIVATE | MAP_ANONYMOUS,
+    -1,
+    0
+  );
+
+  if (map == MAP_FAILED) {
+    return false;
+  }
+
+  if (
+    mmap(map, length, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED
+  ) {
+    munmap(map, size);
+    return false;
+  }
+
+  src->chars = map;
+  src->length = length;
+  src->map = map;
+  src->mapSize = size;
+
+  return true;
+}
+
+// pipes, terminals and anything else `mmap()` can’t handle are read the old
+// way, a chunk at a time, since there’s no telling how long they are.
+static bool readSource(int fd, Source *src) {
+  size_t cap = READ_CHUNK;
+  size_t length = 0;
+  char *buf = malloc(cap);
+
+  if (buf == NULL) {
+    return false;
+  }
+
+  while (true) {
+    // keeps room for the '\0'.
+    if (cap - length < 2) {
+      cap *= 2;
+      char *grown = realloc(buf, cap);
+
+      if (grown == NULL) {
+        free(buf);
+        return false;
+      }
+
+      buf = grown;
+    }
+
+    const ssize_t got = read(fd, buf + length, cap - length - 1);
+
+    if (got == 0) {
+      break;
+    }
+
+    if (got < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+
+      free(buf);
+      return false;
+    }
+
+    length += (size_t)got;
+  }
+
+  buf[length] = '\0';
+
+  src->chars = buf;
+  src->length = length;
+  src->map = NULL;
+  src->mapSize = 0;
+
+  return true;
+}
+
+bool openSource(const char *path, Source *src) {
+  const bool isStdin = strcmp(path, STDIN_PATH) == 0;
+  const int fd = isStdin ? STDIN_FILENO : open(path, O_RDONLY);
+
+  if (fd < 0) {
+    return false;
+  }
+
+  struct stat st;
+  bool opened = fstat(fd, &st) == 0;
+
+  // an empty file can’t be mapped, so it’s read too.
+  if (opened) {
+    opened = (
+      (S_ISREG(st.st_mode) && st.st_size > 0) &&
+      mapSource(fd, (size_t)st.st_size, src)
+    ) || readSource(fd, src);
+  }
+
+  // the mapping doesn’t need the descriptor anymore.
+  const int err = errno;
+
+  if (!isStdin) {
+    close(fd);
+  }
+
+  errno = err;
+  return opened;
+}
+
+void closeSource(Source *src) {
+  if (src->map != NULL) {
+    munmap(src->map, src->mapSize);
+  } else {
+    free((char *)src->chars);
+  }
+
+  src->chars = NULL;
+  src->length = 0;
+  src->map = NULL;
+  src->mapSize = 0;
+}
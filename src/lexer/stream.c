@@ -0,0 +1,91 @@
+#include <string.h>
+
+#include "mem.h"
+#include "stream.h"
+
+TokStream newTokStream(const char *src, bool keepNewlines) {
+  TokStream stream = {
+    .lexer = newLexer(src),
+    .keepNewlines = keepNewlines,
+    .cap = 0,
+    .toks = NULL,
+    .start = 0,
+    .end = 0,
+    .isDone = false
+  };
+
+  return stream;
+}
+
+void freeTokStream(TokStream *stream) {
+  FREE_ARR(Tok, stream->toks, stream->cap);
+
+  stream->cap = 0;
+  stream->toks = NULL;
+  stream->start = 0;
+  stream->end = 0;
+}
+
+// lexes another block after whatever hasn’t been consumed yet.  consumed
+// tokens are dropped first, so the buffer only grows as far as the parser
+// looks ahead, not with the source.
+static void fill(TokStream *stream) {
+  const size_t pending = stream->end - stream->start;
+
+  if (stream->start > 0) {
+    memmove(
+      stream->toks,
+      stream->toks + stream->start,
+      pending * sizeof (Tok)
+    );
+
+    stream->start = 0;
+    stream->end = pending;
+  }
+
+  if (stream->end + STREAM_BLOCK > stream->cap) {
+    const size_t oldCap = stream->cap;
+
+    while (stream->end + STREAM_BLOCK > stream->cap) {
+      stream->cap = GROW_CAP(stream->cap);
+    }
+
+    stream->toks = GROW_ARR(Tok, stream->toks, oldCap, stream->cap);
+  }
+
+  const size_t blockEnd = stream->end + STREAM_BLOCK;
+
+  while (stream->end < blockEnd && !stream->isDone) {
+    const Tok tok = nextTok(&stream->lexer);
+
+    if (tok.type == TOK_NEWLINE && !stream->keepNewlines) {
+      continue;
+    }
+
+    stream->toks[stream->end++] = tok;
+    stream->isDone = tok.type == TOK_EOF;
+  }
+}
+
+Tok peekTok(TokStream *stream, size_t ahead) {
+  while (stream->start + ahead >= stream->end && !stream->isDone) {
+    fill(stream);
+  }
+
+  if (stream->start + ahead >= stream->end) {
+    return stream->toks[stream->end - 1];
+  }
+
+  return stream->toks[stream->start + ahead];
+}
+
+// `TOK_EOF` is never consumed, so it keeps coming back.
+Tok nextStreamTok(TokStream *stream) {
+  const Tok tok = peekTok(stream, 0);
+
+  if (tok.type != TOK_EOF) {
+    stream->start++;
+  }
+
+  return tok;
+}
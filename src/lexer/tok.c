@@ -34,6 +34,10 @@ void advanceLoc(Loc *loc) {
   loc->length++;
 }
 
+void advanceLocBy(Loc *loc, size_t length) {
+  loc->length += length;
+}
+
 void newlineLoc(Loc *loc) {
   loc->line++;
   loc->col = 1;
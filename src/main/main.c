@@ -1,52 +1,81 @@
+#include <errno.h>
+#include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
+#include "cache.h"
 #include "common.h"
+#include "compiler.h"
 #include "err.h"
+#include "gc.h"
+#include "geada.h"
+#include "profile.h"
+#include "reg.h"
+#include "source.h"
 #include "vm.h"
 
-static const char *readFile(const char *fname) {
-  FILE *f = fopen(fname, "rb");
+#define SRC_EXT ".neve"
+#define GEADA_EXT ".geada"
+#define AOT_EXT ".out"
 
-  if (f == NULL) {
-    cliErr("%s: file not found", fname);
-    exit(1);
-  }
+// the build fills these in with where the runtime’s headers and library are.
+#ifndef NEVE_RUNTIME_INCLUDE
+#define NEVE_RUNTIME_INCLUDE "include"
+#endif
 
-  fseek(f, 0L, SEEK_END);
-  size_t size = (size_t)ftell(f);
-  rewind(f);
+#ifndef NEVE_RUNTIME_LIB
+#define NEVE_RUNTIME_LIB "libneve-runtime.a"
+#endif
 
-  char *buf = malloc(size + 1);
+// maps `fname` instead of copying it wherever it can.  tokens and string
+// literals point straight into it, so it’s only closed once the VM is gone.
+static Source readFile(const char *fname) {
+  Source src;
 
-  if (buf == NULL) {
-    cliErr("not enough memory available to read %s", fname);
+  if (!openSource(fname, &src)) {
+    if (errno == ENOENT) {
+      cliErr("%s: file not found", fname);
+    } else {
+      cliErr("%s: couldn't read the file (%s)", fname, strerror(errno));
+    }
 
     exit(1);
   }
 
-  size_t end = fread(buf, sizeof (char), size, f);
+  return src;
+}
 
-  if (end < size) {
-    cliErr("%s: couldn't read the full file", fname);
-    cliErr("this is most likely because a call to fread() failed.");
+static VM newVMWithProfile(const char *profile) {
+  VM vm = newVM();
 
+  if (profile != NULL && !loadSuperinstrs(profile, &vm.superinstrs)) {
+    cliErr("%s: couldn't read the profile", profile);
     exit(1);
   }
 
-  buf[end] = '\0';
+  return vm;
+}
 
-  fclose(f);
-  return buf;
+// profiling builds add every run to `PROFILE_PATH`, so that a whole training
+// workload ends up in one profile.
+static void writeProfile() {
+#ifdef PROFILE_OPS
+  if (!saveProfile(PROFILE_PATH)) {
+    cliErr("%s: couldn't write the profile", PROFILE_PATH);
+  }
+#endif
 }
 
-static void repl() {
+static void repl(const char *profile) {
   // TODO: once we implement variable declarations, please implement
   // a better repl
   const size_t lim = 1024;
   char line[lim];
 
-  VM vm = newVM();
+  VM vm = newVMWithProfile(profile);
   while (true) {
     resetStack(&vm);
     fputs("? ", stdout);
@@ -57,38 +86,377 @@ static void repl() {
     }
 
     interpret("repl", &vm, line);
+
+    // string literals point into `line`, which the next iteration 
+    // overwrites--they mustn’t survive it, even as interned leftovers.
+    resetStack(&vm);
+    collectGarbage(&vm);
   }
 
+  writeProfile();
   freeVM(&vm);
 }
 
-static void runFile(const char *fname) {
+// compiles `src` into `ch`, without running it.
+static bool compileSrc(VM *vm, const char *fname, Source src, Chunk *ch) {
+  return compile(vm, fname, src.chars, src.length, ch, MODE_OPTIMIZE);
+}
+
+// a source we’ve already compiled is run straight from the cache.  anything
+// else is compiled as usual, and stored there for next time.
+static void runFile(const char *fname, const char *profile) {
+  VM vm = newVMWithProfile(profile);
+  resetStack(&vm);
+
+  Source src = readFile(fname);
+  char *cached = cachePath(src.chars, src.length, vm.superinstrs);
+
+  Geada file;
+  Chunk ch = newChunk();
+  Aftermath aftermath = AFTERMATH_COMPILE_ERR;
+
+  const bool isCached = cached != NULL && loadGeada(&vm, cached, &file);
+
+  if (isCached) {
+    aftermath = runChunk(&vm, &file.ch);
+  } else if (compileSrc(&vm, fname, src, &ch)) {
+    // a cache we can’t write to only means compiling again next time.
+    if (cached != NULL) {
+      storeCache(&ch, cached);
+    }
+
+    aftermath = runChunk(&vm, &ch);
+  }
+
+  writeProfile();
+
+  // the VM’s strings may point into the cached file, so it has to go first.
+  freeVM(&vm);
+  freeChunk(&ch);
+
+  if (isCached) {
+    closeGeada(&file);
+  }
+
+  free(cached);
+  closeSource(&src);
+
+  if (aftermath != AFTERMATH_OK) {
+    exit(1);
+  }
+}
+
+static bool hasSrcExt(const char *fname) {
+  const size_t length = strlen(fname);
+  const size_t extLength = strlen(SRC_EXT);
+
+  return (
+    length >= extLength &&
+    strcmp(fname + length - extLength, SRC_EXT) == 0
+  );
+}
+
+// runs `fname` on the register VM.  nothing is cached: register code has no
+// file format.
+static void runRegsFile(const char *fname) {
   VM vm = newVM();
   resetStack(&vm);
 
-  const char *src = readFile(fname);
+  Source src = readFile(fname);
+  RegChunk rc = newRegChunk();
+  Aftermath aftermath = AFTERMATH_COMPILE_ERR;
 
-  Aftermath aftermath = interpret(fname, &vm, src); 
+  const bool compiled = compileRegs(&vm, fname, src.chars, src.length, &rc);
+
+  if (compiled) {
+    aftermath = runRegs(&vm, &rc);
+  }
 
   freeVM(&vm);
-  free((char *)src);
+  freeRegChunk(&rc);
+  closeSource(&src);
 
   if (aftermath != AFTERMATH_OK) {
     exit(1);
   }
 }
 
+// `fname` with its `.neve` swapped for `ext`, or with `ext` added if it
+// doesn’t have one.
+static char *swapExt(const char *fname, const char *ext) {
+  size_t length = strlen(fname);
+
+  if (hasSrcExt(fname)) {
+    length -= strlen(SRC_EXT);
+  }
+
+  char *path = malloc(length + strlen(ext) + 1);
+
+  if (path == NULL) {
+    cliErr("not enough memory available to name the output file");
+    exit(1);
+  }
+
+  memcpy(path, fname, length);
+  strcpy(path + length, ext);
+
+  return path;
+}
+
+// compiles `fname` to a `.geada` file, without running it.  which
+// superinstructions it uses is up to `profile`, like when running.
+static void emitFile(const char *fname, const char *out, const char *profile) {
+  VM vm = newVMWithProfile(profile);
+  resetStack(&vm);
+
+  Source src = readFile(fname);
+  char *path = out != NULL ? NULL : swapExt(fname, GEADA_EXT);
+  Chunk ch = newChunk();
+
+  bool succeeded = compileSrc(&vm, fname, src, &ch);
+
+  if (succeeded && !saveGeada(&ch, out != NULL ? out : path)) {
+    cliErr("%s: couldn't write the bytecode", out != NULL ? out : path);
+    succeeded = false;
+  }
+
+  freeChunk(&ch);
+  freeVM(&vm);
+  closeSource(&src);
+  free(path);
+
+  if (!succeeded) {
+    exit(1);
+  }
+}
+
+// feeds `code` to `$CC`, or `cc` if that isn’t set, and links what it
+// compiles against the runtime.
+static bool buildC(const char *code, size_t length, const char *out) {
+  const char *cc = getenv("CC");
+
+  if (cc == NULL || *cc == '\0') {
+    cc = "cc";
+  }
+
+  int fds[2];
+
+  if (pipe(fds) != 0) {
+    return false;
+  }
+
+  const pid_t pid = fork();
+
+  if (pid < 0) {
+    close(fds[0]);
+    close(fds[1]);
+    return false;
+  }
+
+  if (pid == 0) {
+    dup2(fds[0], STDIN_FILENO);
+    close(fds[0]);
+    close(fds[1]);
+
+    // `-x none` stops the library from being read as C too.
+    execlp(
+      cc, cc, "-O2", "-x", "c", "-", "-x", "none",
+      "-I", NEVE_RUNTIME_INCLUDE,
+      "-o", out,
+      NEVE_RUNTIME_LIB, "-lm",
+      (char *)NULL
+    );
+
+    cliErr("%s: couldn't run the C compiler (%s)", cc, strerror(errno));
+    _exit(127);
+  }
+
+  close(fds[0]);
+
+  // a compiler that gives up early closes the pipe on us, which is its
+  // failure to report, not a reason for us to die.
+  signal(SIGPIPE, SIG_IGN);
+
+  bool wrote = true;
+
+  for (size_t done = 0; done < length;) {
+    const ssize_t count = write(fds[1], code + done, length - done);
+
+    if (count < 0 && errno == EINTR) {
+      continue;
+    }
+
+    if (count < 0) {
+      wrote = false;
+      break;
+    }
+
+    done += (size_t)count;
+  }
+
+  close(fds[1]);
+
+  int status;
+
+  while (waitpid(pid, &status, 0) < 0) {
+    if (errno != EINTR) {
+      return false;
+    }
+  }
+
+  return wrote && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+// compiles `fname` to C, and that to an executable.  it’s named after the
+// source, without the `.neve`, unless there’s an `out`.
+static void aotFile(const char *fname, const char *out) {
+  Source src = readFile(fname);
+  char *path = NULL;
+
+  if (out == NULL) {
+    path = swapExt(fname, hasSrcExt(fname) ? "" : AOT_EXT);
+    out = path;
+  }
+
+  char *code = NULL;
+  size_t length = 0;
+  FILE *stream = open_memstream(&code, &length);
+
+  if (stream == NULL) {
+    cliErr("not enough memory available to compile to C");
+    exit(1);
+  }
+
+  bool succeeded = compileToC(fname, src.chars, src.length, stream);
+
+  // `code` and `length` are only up to date once the stream is closed.
+  if (fclose(stream) != 0) {
+    cliErr("not enough memory available to compile to C");
+    succeeded = false;
+  }
+
+  if (succeeded && !buildC(code, length, out)) {
+    cliErr("%s: couldn't build the executable", out);
+    succeeded = false;
+  }
+
+  free(code);
+  free(path);
+  closeSource(&src);
+
+  if (!succeeded) {
+    exit(1);
+  }
+}
+
+static void runGeada(const char *fname) {
+  VM vm = newVM();
+  resetStack(&vm);
+
+  Geada file;
+
+  if (!loadGeada(&vm, fname, &file)) {
+    cliErr("%s: not a readable version %d bytecode file", fname, GEADA_VERSION);
+    freeVM(&vm);
+    exit(1);
+  }
+
+  Aftermath aftermath = runChunk(&vm, &file.ch);
+
+  writeProfile();
+
+  // the VM’s strings point into the file, so it has to go first.
+  freeVM(&vm);
+  closeGeada(&file);
+
+  if (aftermath != AFTERMATH_OK) {
+    exit(1);
+  }
+}
+
+static void usage() {
+  cliErr("usage: `neve [--profile <profile>] [path | -]`");
+  cliErr("       `neve [--profile <profile>] --emit <path> [output]`");
+  cliErr("       `neve --aot <path> [output]`");
+  cliErr("       `neve --regs <path>`");
+  cliErr("       `neve run <path.geada>`");
+  cliErr("       `neve --show-profile [profile]`");
+  exit(1);
+}
+
 int main(const int argc, const char **argv) {
-  IGNORE(argc);
-  IGNORE(argv);
+  if (argc > 1 && strcmp(argv[1], "--show-profile") == 0) {
+    if (argc > 3) {
+      usage();
+    }
+
+    const char *profile = argc == 3 ? argv[2] : PROFILE_PATH;
+
+    if (!showProfile(profile)) {
+      cliErr("%s: couldn't read the profile", profile);
+      exit(1);
+    }
+
+    return 0;
+  }
+
+  const char *profile = NULL;
+  int arg = 1;
+
+  if (argc > 1 && strcmp(argv[1], "--profile") == 0) {
+    if (argc < 3) {
+      usage();
+    }
 
-  if (argc == 1) {
-    repl();
-  } else if (argc == 2) {
-    runFile(argv[1]);
+    profile = argv[2];
+    arg = 3;
+  }
+
+  if (argc > arg && strcmp(argv[arg], "--emit") == 0) {
+    if (argc != arg + 2 && argc != arg + 3) {
+      usage();
+    }
+
+    emitFile(argv[arg + 1], argc == arg + 3 ? argv[arg + 2] : NULL, profile);
+    return 0;
+  }
+
+  // compiled programs don’t go through the VM’s dispatch, so there’s
+  // nothing a profile could do for them.
+  if (argc > arg && strcmp(argv[arg], "--aot") == 0) {
+    if (profile != NULL || (argc != arg + 2 && argc != arg + 3)) {
+      usage();
+    }
+
+    aotFile(argv[arg + 1], argc == arg + 3 ? argv[arg + 2] : NULL);
+    return 0;
+  }
+
+  if (argc > arg && strcmp(argv[arg], "--regs") == 0) {
+    if (profile != NULL || argc != arg + 2) {
+      usage();
+    }
+
+    runRegsFile(argv[arg + 1]);
+    return 0;
+  }
+
+  // a lone `run` is still a file called “run”.
+  if (argc == arg + 2 && strcmp(argv[arg], "run") == 0) {
+    if (profile != NULL) {
+      usage();
+    }
+
+    runGeada(argv[arg + 1]);
+    return 0;
+  }
+
+  if (argc == arg) {
+    repl(profile);
+  } else if (argc == arg + 1) {
+    runFile(argv[arg], profile);
   } else {
-    cliErr("usage: `neve [path]`");
-    exit(1);
+    usage();
   }
 
   return 0;
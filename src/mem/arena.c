@@ -0,0 +1,68 @@
+#include <stdalign.h>
+#include <stdlib.h>
+
+#include "arena.h"
+
+// big enough that a typical expression fits in the first block.
+#define BLOCK_SIZE (16 * 1024)
+
+struct ArenaBlock {
+  ArenaBlock *prev;
+  max_align_t data[];
+};
+
+Arena newArena() {
+  Arena arena = {
+    .blocks = NULL,
+    .next = NULL,
+    .end = NULL
+  };
+
+  return arena;
+}
+
+void freeArena(Arena *arena) {
+  ArenaBlock *block = arena->blocks;
+
+  while (block != NULL) {
+    ArenaBlock *prev = block->prev;
+
+    free(block);
+    block = prev;
+  }
+
+  arena->blocks = NULL;
+  arena->next = NULL;
+  arena->end = NULL;
+}
+
+static void addBlock(Arena *arena, size_t size) {
+  ArenaBlock *block = malloc(sizeof (ArenaBlock) + size);
+
+  if (block == NULL) {
+    exit(1);
+  }
+
+  block->prev = arena->blocks;
+  arena->blocks = block;
+
+  arena->next = (char *)block->data;
+  arena->end = arena->next + size;
+}
+
+// everything comes back aligned for any type, like with `malloc()`.
+void *arenaAlloc(Arena *arena, size_t size) {
+  const size_t align = alignof (max_align_t);
+  size = (size + align - 1) & ~(align - 1);
+
+  if (arena->next == NULL || size > (size_t)(arena->end - arena->next)) {
+    // anything too big for a block gets one of its own.  the rest of the
+    // current block goes to waste, but that’s rare enough not to matter.
+    addBlock(arena, size > BLOCK_SIZE ? size : BLOCK_SIZE);
+  }
+
+  void *ptr = arena->next;
+  arena->next += size;
+
+  return ptr;
+}
@@ -0,0 +1,247 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "gc.h"
+#include "mem.h"
+#include "obj.h"
+#include "vm.h"
+
+#define GC_MIN_HEAP (1024 * 1024)
+#define GC_INITIAL_GROW 2.0
+#define GC_MIN_GROW 1.5
+#define GC_MAX_GROW 4.0
+
+GC newGC() {
+  GC gc = {
+    .bytesAllocated = 0,
+    .nextGC = GC_MIN_HEAP,
+    .growFactor = GC_INITIAL_GROW,
+    .grayCount = 0,
+    .grayCap = 0,
+    .grayStack = NULL,
+    .collections = 0,
+    .bytesFreed = 0,
+    .totalPause = 0,
+    .maxPause = 0
+  };
+
+  return gc;
+}
+
+void freeGC(GC *gc) {
+  // the gray stack never goes through `reallocate()`--growing it in the 
+  // middle of a collection mustn’t start another one.
+  free(gc->grayStack);
+
+  gc->grayStack = NULL;
+  gc->grayCount = 0;
+  gc->grayCap = 0;
+}
+
+void rootChunk(VM *vm, Chunk *ch) {
+  if (ch->vm == vm) {
+    return;
+  }
+
+  unrootChunk(ch);
+
+  ch->vm = vm;
+  ch->nextRooted = vm->chunks;
+  vm->chunks = ch;
+}
+
+void unrootChunk(Chunk *ch) {
+  if (ch->vm == NULL) {
+    return;
+  }
+
+  Chunk **link = &ch->vm->chunks;
+
+  while (*link != ch) {
+    link = &(*link)->nextRooted;
+  }
+
+  *link = ch->nextRooted;
+
+  ch->vm = NULL;
+  ch->nextRooted = NULL;
+}
+
+// chunks may outlive their VM, and mustn’t point back into it once it’s gone.
+void unrootChunks(VM *vm) {
+  while (vm->chunks != NULL) {
+    unrootChunk(vm->chunks);
+  }
+}
+
+void trackAlloc(VM *vm, size_t oldSize, size_t newSize) {
+  GC *gc = &vm->gc;
+
+  if (newSize <= oldSize) {
+    gc->bytesAllocated -= oldSize - newSize;
+    return;
+  }
+
+  gc->bytesAllocated += newSize - oldSize;
+
+#ifdef DEBUG_STRESS_GC
+  collectGarbage(vm);
+#else
+  if (gc->bytesAllocated > gc->nextGC) {
+    collectGarbage(vm);
+  }
+#endif
+}
+
+void markObj(GC *gc, Obj *obj) {
+  if (obj == NULL || obj->isMarked) {
+    return;
+  }
+
+  obj->isMarked = true;
+
+  if (gc->grayCount == gc->grayCap) {
+    gc->grayCap = GROW_CAP(gc->grayCap);
+    gc->grayStack = realloc(gc->grayStack, sizeof (Obj *) * gc->grayCap);
+
+    if (gc->grayStack == NULL) {
+      exit(1);
+    }
+  }
+
+  gc->grayStack[gc->grayCount++] = obj;
+}
+
+void markVal(GC *gc, Val val) {
+  if (IS_VAL_OBJ(val)) {
+    markObj(gc, VAL_AS_OBJ(val));
+  }
+}
+
+static void markRoots(VM *vm) {
+  GC *gc = &vm->gc;
+
+  for (Val *slot = vm->stack; slot < vm->stackTop; slot++) {
+    markVal(gc, *slot);
+  }
+
+  // the chunk being run is one of these, and so is any being compiled.
+  for (Chunk *ch = vm->chunks; ch != NULL; ch = ch->nextRooted) {
+    for (size_t i = 0; i < ch->consts.next; i++) {
+      markVal(gc, ch->consts.consts[i]);
+    }
+  }
+}
+
+static void blackenObj(GC *gc, Obj *obj) {
+  switch (obj->type) {
+    case OBJ_STR:
+      // strings don’t reference anything.
+      break;
+
+    case OBJ_ROPE: {
+      ObjRope *rope = (ObjRope *)obj;
+
+      markObj(gc, rope->left);
+      markObj(gc, rope->right);
+      markObj(gc, (Obj *)rope->flat);
+      break;
+    }
+  }
+}
+
+static void traceRefs(GC *gc) {
+  while (gc->grayCount > 0) {
+    Obj *obj = gc->grayStack[--gc->grayCount];
+    blackenObj(gc, obj);
+  }
+}
+
+static void sweep(VM *vm) {
+  Obj *prev = NULL;
+  Obj *obj = vm->objs;
+
+  while (obj != NULL) {
+    if (obj->isMarked) {
+      obj->isMarked = false;
+
+      prev = obj;
+      obj = obj->next;
+      continue;
+    }
+
+    Obj *unreached = obj;
+    obj = obj->next;
+
+    if (prev != NULL) {
+      prev->next = obj;
+    } else {
+      vm->objs = obj;
+    }
+
+    freeObj(vm, unreached);
+  }
+}
+
+static void adaptGrowth(GC *gc, size_t before) {
+  const double survival = (
+    before == 0 ? 0 : (double)gc->bytesAllocated / (double)before
+  );
+
+  // if most of the heap survived, collecting again soon would be a waste of
+  // time; if most of it was garbage, we can afford to collect more often.
+  const double highSurvival = 0.5;
+  const double lowSurvival = 0.25;
+  const double step = 1.5;
+
+  if (survival > highSurvival) {
+    gc->growFactor *= step;
+  } else if (survival < lowSurvival) {
+    gc->growFactor /= step;
+  }
+
+  if (gc->growFactor > GC_MAX_GROW) {
+    gc->growFactor = GC_MAX_GROW;
+  } else if (gc->growFactor < GC_MIN_GROW) {
+    gc->growFactor = GC_MIN_GROW;
+  }
+
+  const size_t next = (size_t)((double)gc->bytesAllocated * gc->growFactor);
+  gc->nextGC = next < GC_MIN_HEAP ? GC_MIN_HEAP : next;
+}
+
+void collectGarbage(VM *vm) {
+  GC *gc = &vm->gc;
+
+  const clock_t start = clock();
+  const size_t before = gc->bytesAllocated;
+
+  markRoots(vm);
+  traceRefs(gc);
+  tableRemoveUnmarked(&vm->strs);
+  sweep(vm);
+
+  adaptGrowth(gc, before);
+
+  const double pause = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+  gc->collections++;
+  gc->bytesFreed += before - gc->bytesAllocated;
+  gc->totalPause += pause;
+
+  if (pause > gc->maxPause) {
+    gc->maxPause = pause;
+  }
+
+#ifdef DEBUG_LOG_GC
+  fprintf(
+    stderr,
+    "gc: collected %zu bytes (from %zu to %zu), next at %zu\n",
+    before - gc->bytesAllocated,
+    before,
+    gc->bytesAllocated,
+    gc->nextGC
+  );
+#endif
+}
@@ -19,13 +19,13 @@ void *reallocate(void *ptr, size_t oldSize, size_t newSize) {
   return allocated;
 }
 
-void freeObjs(Obj *objs) {
+void freeObjs(VM *vm, Obj *objs) {
   Obj *obj = objs;
 
   while (obj != NULL) {
     Obj *next = obj->next;
 
-    freeObj(obj);    
+    freeObj(vm, obj);
     obj = next;
   }
 }
@@ -1,50 +1,267 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
+#include "gc.h"
 #include "mem.h"
 #include "obj.h"
+#include "table.h"
 
 #define ALLOC_OBJ(vm, type, objType) (type *)allocObj(vm, sizeof (type), objType)
 
-static Obj *allocObj(VM *vm, size_t size, ObjType type) {
+// the object isn’t known to the GC until it’s linked.  a collection can only
+// happen before it exists, so it doesn’t need to be rooted yet.
+static Obj *newObj(VM *vm, size_t size, ObjType type) {
+  trackAlloc(vm, 0, size);
+
   Obj *obj = (Obj *)reallocate(NULL, 0, size);
   obj->type = type;
+  obj->isMarked = false;
+  obj->next = NULL;
+
+  return obj;
+}
 
+static void linkObj(VM *vm, Obj *obj) {
   obj->next = vm->objs;
   vm->objs = obj;
+}
+
+static Obj *allocObj(VM *vm, size_t size, ObjType type) {
+  Obj *obj = newObj(vm, size, type);
+  linkObj(vm, obj);
 
   return obj;
 }
 
-ObjStr *allocStr(VM *vm, bool ownsStr, const char *chars, size_t length) {
-  ObjStr *str = ALLOC_OBJ(vm, ObjStr, OBJ_STR);
-  str->ownsStr = ownsStr;
+// FNV-1a.
+static uint32_t hashStr(const char *chars, size_t length) {
+  const uint32_t offsetBasis = 2166136261U;
+  const uint32_t prime = 16777619U;
+
+  uint32_t hash = offsetBasis;
+
+  for (size_t i = 0; i < length; i++) {
+    hash ^= (uint8_t)chars[i];
+    hash *= prime;
+  }
+
+  return hash;
+}
+
+static bool isBorrowed(ObjStr *str) {
+  return str->chars != str->inlineChars;
+}
+
+static size_t strSize(ObjStr *str) {
+  return sizeof (ObjStr) + (isBorrowed(str) ? 0 : str->length + 1);
+}
+
+static ObjStr *linkStr(VM *vm, ObjStr *str, uint32_t hash) {
+  str->hash = hash;
+  linkObj(vm, (Obj *)str);
+
+  // the table isn’t on the GC’s heap, so growing it can’t collect `str`.
+  tableSet(&vm->strs, str, NIL_VAL);
+
+  return str;
+}
+
+// every string is interned, so two strings with the same contents are always
+// the same object.  the characters are copied into the string itself.
+ObjStr *allocStr(VM *vm, const char *chars, size_t length) {
+  const uint32_t hash = hashStr(chars, length);
+  ObjStr *interned = tableFindStr(&vm->strs, chars, length, hash);
+
+  if (interned != NULL) {
+    return interned;
+  }
+
+  ObjStr *str = reserveStr(vm, length);
+  memcpy(str->inlineChars, chars, length);
+
+  return linkStr(vm, str, hash);
+}
+
+// like `allocStr()`, but `chars` isn’t copied, so it has to outlive the
+// string.
+ObjStr *borrowStr(VM *vm, const char *chars, size_t length) {
+  const uint32_t hash = hashStr(chars, length);
+  ObjStr *interned = tableFindStr(&vm->strs, chars, length, hash);
+
+  if (interned != NULL) {
+    return interned;
+  }
+
+  ObjStr *str = (ObjStr *)newObj(vm, sizeof (ObjStr), OBJ_STR);
   str->length = length;
   str->chars = chars;
 
+  return linkStr(vm, str, hash);
+}
+
+// a string with room for `length` characters, for building a string in place.
+// it has to go through `internStr()` before anything else can allocate.
+ObjStr *reserveStr(VM *vm, size_t length) {
+  ObjStr *str = (ObjStr *)newObj(vm, sizeof (ObjStr) + length + 1, OBJ_STR);
+  str->length = length;
+  str->chars = str->inlineChars;
+  str->inlineChars[length] = '\0';
+
   return str;
 }
 
+// returns the interned string with the same contents as `str`, which is
+// freed if there already is one.
+ObjStr *internStr(VM *vm, ObjStr *str) {
+  const uint32_t hash = hashStr(str->chars, str->length);
+  ObjStr *interned = tableFindStr(&vm->strs, str->chars, str->length, hash);
+
+  if (interned != NULL) {
+    freeObj(vm, (Obj *)str);
+    return interned;
+  }
+
+  return linkStr(vm, str, hash);
+}
+
+// the caller has to keep both halves reachable, since allocating the rope may
+// trigger a collection.
+ObjRope *allocRope(VM *vm, Obj *left, Obj *right) {
+  ObjRope *rope = ALLOC_OBJ(vm, ObjRope, OBJ_ROPE);
+  rope->length = strLength(left) + strLength(right);
+  rope->left = left;
+  rope->right = right;
+  rope->flat = NULL;
+
+  return rope;
+}
+
+size_t strLength(Obj *obj) {
+  if (obj->type == OBJ_ROPE) {
+    return ((ObjRope *)obj)->length;
+  }
+
+  return ((ObjStr *)obj)->length;
+}
+
+typedef void (*LeafFn)(ObjStr *leaf, void *data);
+
+// calls `fn` on every string in `rope`, from left to right.  concatenation
+// chains nest as deep as they are long, so we keep our own stack instead of
+// recursing.
+static void walkRope(ObjRope *rope, LeafFn fn, void *data) {
+  size_t cap = GROW_CAP(0);
+  size_t count = 0;
+  Obj **stack = malloc(sizeof (Obj *) * cap);
+
+  if (stack == NULL) {
+    exit(1);
+  }
+
+  stack[count++] = (Obj *)rope;
+
+  while (count > 0) {
+    Obj *obj = stack[--count];
+
+    if (obj->type == OBJ_STR) {
+      fn((ObjStr *)obj, data);
+      continue;
+    }
+
+    ObjRope *node = (ObjRope *)obj;
+
+    if (node->flat != NULL) {
+      fn(node->flat, data);
+      continue;
+    }
+
+    if (count + 2 > cap) {
+      cap = GROW_CAP(cap);
+      stack = realloc(stack, sizeof (Obj *) * cap);
+
+      if (stack == NULL) {
+        exit(1);
+      }
+    }
+
+    // the right half goes first, so that the left one comes out first.
+    stack[count++] = node->right;
+    stack[count++] = node->left;
+  }
+
+  free(stack);
+}
+
+static void copyLeaf(ObjStr *leaf, void *data) {
+  char **cursor = (char **)data;
+
+  memcpy(*cursor, leaf->chars, leaf->length);
+  *cursor += leaf->length;
+}
+
+static void printLeaf(ObjStr *leaf, void *data) {
+  IGNORE(data);
+
+  printf("%.*s", (int)leaf->length, leaf->chars);
+}
+
+// copies the characters of a string or a rope to `dest`, and returns where
+// they end.
+char *copyChars(char *dest, Obj *obj) {
+  if (obj->type == OBJ_STR) {
+    ObjStr *str = (ObjStr *)obj;
+
+    memcpy(dest, str->chars, str->length);
+    return dest + str->length;
+  }
+
+  walkRope((ObjRope *)obj, copyLeaf, &dest);
+  return dest;
+}
+
+// the caller has to keep `rope` reachable.  the result is interned like any
+// other string.
+ObjStr *flattenRope(VM *vm, ObjRope *rope) {
+  if (rope->flat != NULL) {
+    return rope->flat;
+  }
+
+  ObjStr *flat = reserveStr(vm, rope->length);
+  copyChars(flat->inlineChars, (Obj *)rope);
+
+  rope->flat = internStr(vm, flat);
+  rope->left = NULL;
+  rope->right = NULL;
+
+  return rope->flat;
+}
+
 void printObj(Val val) {
   switch (OBJ_TYPE(val)) {
     case OBJ_STR:
       printf("%.*s", (int)(VAL_AS_STR(val)->length), VAL_AS_CSTR(val));
       break;
+
+    // printing doesn’t need the characters in one place, so there’s no need
+    // to flatten.
+    case OBJ_ROPE:
+      walkRope(VAL_AS_ROPE(val), printLeaf, NULL);
+      break;
   }
 }
 
-void freeObj(Obj *obj) {
+void freeObj(VM *vm, Obj *obj) {
   switch (obj->type) {
-    case OBJ_STR: {
-      ObjStr *str = (ObjStr *)obj;
-
-      if (str->ownsStr) {
-        FREE_ARR(char, (char *)str->chars, str->length);
-      }
+    case OBJ_STR:
+      trackAlloc(vm, strSize((ObjStr *)obj), 0);
+      reallocate(obj, strSize((ObjStr *)obj), 0);
+      break;
 
-      FREE(ObjStr, obj);
+    case OBJ_ROPE:
+      trackAlloc(vm, sizeof (ObjRope), 0);
+      FREE(ObjRope, obj);
       break;
-    }
   }
 }
 
@@ -59,6 +276,10 @@ size_t objAsStr(const char *buffer, Obj *obj) {
     return str->length;
   }
 
+  if (obj->type == OBJ_ROPE) {
+    return ((ObjRope *)obj)->length;
+  }
+
   /*
   switch (obj->type) {
     ...
@@ -0,0 +1,120 @@
+#include <string.h>
+
+#include "mem.h"
+#include "obj.h"
+#include "vm.h"
+
+// everything about a VM but the loop that runs its code.  compiled programs
+// link this without the rest.
+
+VM newVM() {
+  VM vm = {
+    .ch = NULL,
+    .objs = NULL,
+    .strs = newTable(),
+    .gc = newGC(),
+    .chunks = NULL,
+    .superinstrs = 0,
+    .useJit = true
+  };
+
+  return vm;
+}
+
+void freeVM(VM *vm) {
+  unrootChunks(vm);
+
+  freeTable(&vm->strs);
+
+  freeObjs(vm, vm->objs);
+  vm->objs = NULL;
+
+  freeGC(&vm->gc);
+}
+
+void resetStack(VM *vm) {
+  vm->stackTop = vm->stack;
+}
+
+// results shorter than this are still copied right away: a rope node costs
+// about as much as the copy, and short strings are the ones most likely to be
+// compared, which would flatten them anyway.
+#define MIN_ROPE_LENGTH 64
+
+void concat(VM *vm) {
+  // both operands stay on the stack until the result is allocated, so that
+  // a collection can’t sweep them from under us.
+  Obj *b = VAL_AS_OBJ(vm->stackTop[-1]);
+  Obj *a = VAL_AS_OBJ(vm->stackTop[-2]);
+
+  size_t length = strLength(a) + strLength(b);
+
+  if (length >= MIN_ROPE_LENGTH) {
+    ObjRope *result = allocRope(vm, a, b);
+
+    vm->stackTop -= 2;
+    push(vm, OBJ_VAL(result));
+    return;
+  }
+
+  // every rope is at least `MIN_ROPE_LENGTH` long, so both halves of
+  // anything shorter are plain strings.
+  ObjStr *left = (ObjStr *)a;
+  ObjStr *right = (ObjStr *)b;
+
+  ObjStr *result = reserveStr(vm, length);
+
+  memcpy(result->inlineChars, left->chars, left->length);
+  memcpy(result->inlineChars + left->length, right->chars, right->length);
+
+  result = internStr(vm, result);
+
+  vm->stackTop -= 2;
+  push(vm, OBJ_VAL(result));
+}
+
+// joins the top `count` strings on the stack.  the result’s length is known
+// upfront, so it takes a single allocation however many pieces there are.
+void concatN(VM *vm, uint8_t count) {
+  Val *pieces = vm->stackTop - count;
+  size_t length = 0;
+
+  for (uint8_t i = 0; i < count; i++) {
+    length += strLength(VAL_AS_OBJ(pieces[i]));
+  }
+
+  // the pieces stay on the stack while we allocate, like in `concat()`.
+  ObjStr *result = reserveStr(vm, length);
+  char *cursor = result->inlineChars;
+
+  for (uint8_t i = 0; i < count; i++) {
+    cursor = copyChars(cursor, VAL_AS_OBJ(pieces[i]));
+  }
+
+  result = internStr(vm, result);
+
+  vm->stackTop -= count;
+  push(vm, OBJ_VAL(result));
+}
+
+// equality compares interned strings by address, so ropes have to be turned
+// into strings first.  they stay on the stack while that happens.
+void flattenOperands(VM *vm) {
+  for (Val *slot = vm->stackTop - 2; slot < vm->stackTop; slot++) {
+    if (IS_VAL_ROPE(*slot)) {
+      *slot = OBJ_VAL(flattenRope(vm, VAL_AS_ROPE(*slot)));
+    }
+  }
+}
+
+void push(VM *vm, Val val) {
+  *vm->stackTop = val;
+
+  vm->stackTop++;
+}
+
+Val pop(VM *vm) {
+  vm->stackTop--;
+
+  return *vm->stackTop;
+}
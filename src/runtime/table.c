@@ -0,0 +1,183 @@
+#include <string.h>
+
+#include "mem.h"
+#include "obj.h"
+#include "table.h"
+
+// we grow the table once it’s three quarters full.
+#define TABLE_MAX_LOAD 0.75
+
+Table newTable() {
+  Table table = {
+    .count = 0,
+    .cap = 0,
+    .entries = NULL
+  };
+
+  return table;
+}
+
+void freeTable(Table *table) {
+  FREE_ARR(Entry, table->entries, table->cap);
+
+  table->count = 0;
+  table->cap = 0;
+  table->entries = NULL;
+}
+
+// a tombstone is an entry without a key but with a non-nil value.  probing
+// has to keep going past them, but insertions can reuse them.
+static bool isTombstone(Entry *entry) {
+  return entry->key == NULL && !IS_VAL_NIL(entry->val);
+}
+
+// `cap` is always a power of two, so we can mask instead of dividing.
+static Entry *findEntry(Entry *entries, size_t cap, ObjStr *key) {
+  size_t index = key->hash & (cap - 1);
+  Entry *tombstone = NULL;
+
+  while (true) {
+    Entry *entry = &entries[index];
+
+    if (entry->key == key) {
+      return entry;
+    }
+
+    if (entry->key == NULL) {
+      if (!isTombstone(entry)) {
+        return tombstone != NULL ? tombstone : entry;
+      }
+
+      if (tombstone == NULL) {
+        tombstone = entry;
+      }
+    }
+
+    index = (index + 1) & (cap - 1);
+  }
+}
+
+static void adjustCap(Table *table, size_t cap) {
+  Entry *entries = ALLOC(Entry, cap);
+
+  for (size_t i = 0; i < cap; i++) {
+    entries[i].key = NULL;
+    entries[i].val = NIL_VAL;
+  }
+
+  // tombstones aren’t carried over, so we recount.
+  table->count = 0;
+
+  for (size_t i = 0; i < table->cap; i++) {
+    Entry *entry = &table->entries[i];
+
+    if (entry->key == NULL) {
+      continue;
+    }
+
+    Entry *dest = findEntry(entries, cap, entry->key);
+    dest->key = entry->key;
+    dest->val = entry->val;
+
+    table->count++;
+  }
+
+  FREE_ARR(Entry, table->entries, table->cap);
+
+  table->entries = entries;
+  table->cap = cap;
+}
+
+bool tableGet(Table *table, ObjStr *key, Val *val) {
+  if (table->count == 0) {
+    return false;
+  }
+
+  Entry *entry = findEntry(table->entries, table->cap, key);
+
+  if (entry->key == NULL) {
+    return false;
+  }
+
+  *val = entry->val;
+  return true;
+}
+
+bool tableSet(Table *table, ObjStr *key, Val val) {
+  if ((double)(table->count + 1) > (double)table->cap * TABLE_MAX_LOAD) {
+    adjustCap(table, GROW_CAP(table->cap));
+  }
+
+  Entry *entry = findEntry(table->entries, table->cap, key);
+  const bool isNewKey = entry->key == NULL;
+
+  if (isNewKey && !isTombstone(entry)) {
+    table->count++;
+  }
+
+  entry->key = key;
+  entry->val = val;
+
+  return isNewKey;
+}
+
+bool tableDelete(Table *table, ObjStr *key) {
+  if (table->count == 0) {
+    return false;
+  }
+
+  Entry *entry = findEntry(table->entries, table->cap, key);
+
+  if (entry->key == NULL) {
+    return false;
+  }
+
+  entry->key = NULL;
+  entry->val = BOOL_VAL(true);
+
+  return true;
+}
+
+ObjStr *tableFindStr(
+  Table *table, 
+  const char *chars, 
+  size_t length, 
+  uint32_t hash
+) {
+  if (table->count == 0) {
+    return NULL;
+  }
+
+  size_t index = hash & (table->cap - 1);
+
+  while (true) {
+    Entry *entry = &table->entries[index];
+    ObjStr *key = entry->key;
+
+    if (key == NULL) {
+      if (!isTombstone(entry)) {
+        return NULL;
+      }
+    } else if (
+      key->hash == hash && 
+      key->length == length &&
+      memcmp(key->chars, chars, length) == 0
+    ) {
+      return key;
+    }
+
+    index = (index + 1) & (table->cap - 1);
+  }
+}
+
+// the intern table holds weak references: a string that nothing else 
+// reaches gets dropped from it right before it’s swept.
+void tableRemoveUnmarked(Table *table) {
+  for (size_t i = 0; i < table->cap; i++) {
+    Entry *entry = &table->entries[i];
+
+    if (entry->key != NULL && !entry->key->obj.isMarked) {
+      tableDelete(table, entry->key);
+    }
+  }
+}
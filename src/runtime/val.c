@@ -1,3 +1,4 @@
+#include <inttypes.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -41,7 +42,7 @@ void freeValArr(ValArr *arr) {
 }
 
 void printVal(Val val) {
-  switch (val.type) {
+  switch (VAL_TYPE(val)) {
     case VAL_BOOL:
       printf(VAL_AS_BOOL(val) ? "true" : "false");
       break;
@@ -50,6 +51,10 @@ void printVal(Val val) {
       printf("nil");
       break;
     
+    case VAL_INT:
+      printf("%" PRId64, VAL_AS_INT(val));
+      break;
+
     case VAL_NUM:
       printf("%g", VAL_AS_NUM(val));
       break;
@@ -61,43 +66,40 @@ void printVal(Val val) {
 }
 
 bool valsEq(Val a, Val b) {
-  if (a.type != b.type) {
+  if (VAL_TYPE(a) != VAL_TYPE(b)) {
     return false;
   }
 
-  switch (a.type) {
+  switch (VAL_TYPE(a)) {
     case VAL_NIL:
       return true;
 
     case VAL_BOOL:
-      return VAL_AS_BOOL(a) && VAL_AS_BOOL(b);
+      return VAL_AS_BOOL(a) == VAL_AS_BOOL(b);
+
+    case VAL_INT:
+      return VAL_AS_INT(a) == VAL_AS_INT(b);
 
     case VAL_NUM:
       return VAL_AS_NUM(a) == VAL_AS_NUM(b);
 
-    case VAL_OBJ: {
-      ObjStr *aStr = VAL_AS_STR(a);
-      ObjStr *bStr = VAL_AS_STR(b);
-
-      return (
-        aStr->length == bStr->length &&
-        memcmp(aStr->chars, bStr->chars, aStr->length) == 0
-      );
-    }
+    case VAL_OBJ:
+      // strings are interned, so equal strings are the same object.
+      return VAL_AS_OBJ(a) == VAL_AS_OBJ(b);
   }
 
   return false;
 }
 
 size_t valAsStr(char *buffer, Val val) {
-  switch (val.type) {
+  switch (VAL_TYPE(val)) {
     case VAL_OBJ:
       return objAsStr(buffer, VAL_AS_OBJ(val));
 
     case VAL_NIL: {
       const size_t length = 3;
 
-      strncpy(buffer, "nil", length);
+      memcpy(buffer, "nil", length);
       return length;
     }
 
@@ -113,7 +115,20 @@ size_t valAsStr(char *buffer, Val val) {
 
       const size_t length = isTrue ? trueLength : falseLength;
       
-      strncpy(buffer, isTrue ? "true" : "false", length);
+      memcpy(buffer, isTrue ? "true" : "false", length);
+
+      return length;
+    }
+
+    case VAL_INT: {
+      const size_t bufferSize = 32;
+
+      const size_t length = (size_t)snprintf(
+        buffer, 
+        bufferSize, 
+        "%" PRId64, 
+        VAL_AS_INT(val)
+      ); 
 
       return length;
     }
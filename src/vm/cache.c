@@ -0,0 +1,162 @@
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "cache.h"
+#include "compiler.h"
+#include "geada.h"
+
+// long enough for a cached chunk’s name, or for what’s added to it to name
+// the file it’s written to first.
+#define MAX_NAME 64
+
+// FNV-1a, 64 bits wide this time: every chunk in the cache is told apart
+// only by its key.
+#define FNV_OFFSET_BASIS 14695981039346656037ULL
+#define FNV_PRIME 1099511628211ULL
+
+static uint64_t hashBytes(uint64_t hash, const void *bytes, size_t length) {
+  const uint8_t *byte = bytes;
+
+  for (size_t i = 0; i < length; i++) {
+    hash ^= byte[i];
+    hash *= FNV_PRIME;
+  }
+
+  return hash;
+}
+
+static char *joinPath(const char *dir, const char *name) {
+  const size_t dirLength = strlen(dir);
+  const size_t nameLength = strlen(name);
+
+  char *path = malloc(dirLength + nameLength + 2);
+
+  if (path == NULL) {
+    return NULL;
+  }
+
+  memcpy(path, dir, dirLength);
+  path[dirLength] = '/';
+  memcpy(path + dirLength + 1, name, nameLength + 1);
+
+  return path;
+}
+
+static bool makeDir(const char *path) {
+  return mkdir(path, 0755) == 0 || errno == EEXIST;
+}
+
+static bool isSet(const char *var) {
+  return var != NULL && *var != '\0';
+}
+
+// creates the directory if it isn’t there yet.  returns NULL when there’s
+// nowhere to put it.
+static char *cacheDir() {
+  const char *dir = getenv("NEVE_CACHE_DIR");
+
+  if (isSet(dir)) {
+    return makeDir(dir) ? strdup(dir) : NULL;
+  }
+
+  const char *base = getenv("XDG_CACHE_HOME");
+  char *homeCache = NULL;
+
+  if (!isSet(base)) {
+    const char *home = getenv("HOME");
+
+    if (!isSet(home)) {
+      return NULL;
+    }
+
+    homeCache = joinPath(home, ".cache");
+    base = homeCache;
+  }
+
+  char *path = (
+    base != NULL && makeDir(base) ? joinPath(base, CACHE_DIR_NAME) : NULL
+  );
+
+  free(homeCache);
+
+  if (path != NULL && !makeDir(path)) {
+    free(path);
+    return NULL;
+  }
+
+  return path;
+}
+
+static bool isCacheOff() {
+#ifdef DEBUG_COMPILE
+  return true;
+#else
+  return isSet(getenv("NEVE_NO_CACHE"));
+#endif
+}
+
+// where the chunk `src` compiles to is kept, or NULL if there isn’t a cache
+// to use.  the key covers everything that decides what the chunk looks like:
+// the compiler, the file format, the superinstructions the VM was told to
+// use and the source itself.  setting `NEVE_NO_CACHE` turns the cache off,
+// and so does tracing the compiler: a cached chunk would skip it.
+char *cachePath(const char *src, size_t length, uint32_t superinstrs) {
+  if (isCacheOff()) {
+    return NULL;
+  }
+
+  char *dir = cacheDir();
+
+  if (dir == NULL) {
+    return NULL;
+  }
+
+  const uint32_t version = GEADA_VERSION;
+
+  // whoever forgets to bump a version when adding an opcode or changing how
+  // values are laid out is covered by these.
+  const uint32_t layout[] = { OP_RET + 1, sizeof (Val) };
+
+  uint64_t hash = FNV_OFFSET_BASIS;
+  hash = hashBytes(hash, COMPILER_VERSION, strlen(COMPILER_VERSION));
+  hash = hashBytes(hash, &version, sizeof (version));
+  hash = hashBytes(hash, layout, sizeof (layout));
+  hash = hashBytes(hash, &superinstrs, sizeof (superinstrs));
+  hash = hashBytes(hash, src, length);
+
+  char name[MAX_NAME];
+  snprintf(name, sizeof (name), "%016" PRIx64 "-%zx.geada", hash, length);
+
+  char *path = joinPath(dir, name);
+  free(dir);
+
+  return path;
+}
+
+// the chunk is written to a file of its own and then renamed into place.
+// `rename()` is atomic, so other processes either find a whole chunk or
+// none at all, and two of them storing the same one at once is harmless.
+bool storeCache(Chunk *ch, const char *path) {
+  const size_t length = strlen(path) + MAX_NAME;
+  char *tmp = malloc(length);
+
+  if (tmp == NULL) {
+    return false;
+  }
+
+  snprintf(tmp, length, "%s.%ld.tmp", path, (long)getpid());
+
+  const bool stored = saveGeada(ch, tmp) && rename(tmp, path) == 0;
+
+  if (!stored) {
+    remove(tmp);
+  }
+
+  free(tmp);
+  return stored;
+}
@@ -1,5 +1,13 @@
+#include <string.h>
+
 #include "chunk.h"
+#include "gc.h"
+#include "jit.h"
 #include "mem.h"
+#include "obj.h"
+
+// we grow the map once it’s three quarters full.
+#define CONST_MAP_MAX_LOAD 0.75
 
 Chunk newChunk() {
   Chunk ch = {
@@ -7,7 +15,12 @@ Chunk newChunk() {
     .next = 0,
     .code = NULL,
     .consts = newValArr(),
-    .lines = newLineArr()
+    .constMap = newConstMap(),
+    .lines = newLineArr(),
+    .runs = 0,
+    .jit = NULL,
+    .vm = NULL,
+    .nextRooted = NULL
   };
 
   return ch;
@@ -32,13 +45,19 @@ void writeChunk(Chunk *ch, uint8_t byte, int line) {
 }
 
 void freeChunk(Chunk *ch) {
+  unrootChunk(ch);
+
   freeValArr(&ch->consts);
+  freeConstMap(&ch->constMap);
   freeLineArr(&ch->lines);
   FREE_ARR(uint8_t, ch->code, ch->cap);
+  freeJit(ch->jit);
 
   ch->code = NULL;
   ch->cap = 0;
   ch->next = 0;  
+  ch->runs = 0;
+  ch->jit = NULL;
 }
 
 void writeConst(Chunk *ch, Val val, int line) {
@@ -57,8 +76,256 @@ void writeConst(Chunk *ch, Val val, int line) {
   }
 }
 
+// how many bytes the instruction starting with `op` takes, operands included.
+size_t instrLength(uint8_t op) {
+  switch (op) {
+    case OP_CONST:
+    case OP_INT_ADD_CONST:
+    case OP_INT_SUB_CONST:
+    case OP_INT_MUL_CONST:
+    case OP_FLOAT_ADD_CONST:
+    case OP_FLOAT_SUB_CONST:
+    case OP_FLOAT_MUL_CONST:
+    case OP_CONCAT_N:
+      return 2;
+
+    case OP_CONST_LONG:
+      return 4;
+
+    default:
+      return 1;
+  }
+}
+
+void stackEffect(
+  uint8_t op,
+  const uint8_t *operands,
+  int *pops,
+  int *pushes
+) {
+  *pops = 0;
+  *pushes = 1;
+
+  switch (op) {
+    case OP_CONST:
+    case OP_CONST_LONG:
+    case OP_TRUE:
+    case OP_FALSE:
+    case OP_NIL:
+    case OP_ZERO:
+    case OP_ONE:
+    case OP_MINUS_ONE:
+    case OP_FLOAT_ZERO:
+    case OP_FLOAT_ONE:
+    case OP_FLOAT_MINUS_ONE:
+      break;
+
+    // it converts the value under the top one, so it needs both.
+    case OP_INT_TO_FLOAT_UNDER:
+      *pops = 2;
+      *pushes = 2;
+      break;
+
+    case OP_INT_TO_FLOAT:
+    case OP_NOT:
+    case OP_IS_NIL:
+    case OP_IS_ZERO:
+    case OP_IS_MINUS_ONE:
+    case OP_INT_NEG:
+    case OP_FLOAT_NEG:
+    case OP_INT_ADD_CONST:
+    case OP_INT_SUB_CONST:
+    case OP_INT_MUL_CONST:
+    case OP_FLOAT_ADD_CONST:
+    case OP_FLOAT_SUB_CONST:
+    case OP_FLOAT_MUL_CONST:
+      *pops = 1;
+      break;
+
+    case OP_CONCAT_N:
+      *pops = operands[0];
+      break;
+
+    case OP_RET:
+      *pops = 1;
+      *pushes = 0;
+      break;
+
+    default:
+      *pops = 2;
+      break;
+  }
+}
+
+int chunkDepth(const Chunk *ch) {
+  int depth = 0;
+  int deepest = 0;
+
+  for (size_t offset = 0; offset < ch->next;) {
+    const uint8_t op = ch->code[offset];
+
+    int pops;
+    int pushes;
+    stackEffect(op, ch->code + offset + 1, &pops, &pushes);
+
+    depth += pushes - pops;
+
+    if (depth > deepest) {
+      deepest = depth;
+    }
+
+    offset += instrLength(op);
+  }
+
+  return deepest;
+}
+
+ConstMap newConstMap() {
+  ConstMap map = {
+    .cap = 0,
+    .count = 0,
+    .slots = NULL
+  };
+
+  return map;
+}
+
+void freeConstMap(ConstMap *map) {
+  FREE_ARR(uint32_t, map->slots, map->cap);
+
+  map->cap = 0;
+  map->count = 0;
+  map->slots = NULL;
+}
+
+static uint32_t hashBits(uint64_t bits) {
+  // the finalizer from MurmurHash3: every input bit affects every output bit,
+  // so neighboring numbers don’t end up in neighboring slots.
+  const uint64_t mul = 0xff51afd7ed558ccdULL;
+  const int shift = 33;
+
+  bits ^= bits >> shift;
+  bits *= mul;
+  bits ^= bits >> shift;
+
+  return (uint32_t)bits;
+}
+
+static uint32_t hashConst(Val val) {
+  const ValType type = VAL_TYPE(val);
+
+  switch (type) {
+    case VAL_INT:
+      return hashBits((uint64_t)VAL_AS_INT(val)) ^ type;
+
+    case VAL_NUM: {
+      const double num = VAL_AS_NUM(val);
+
+      uint64_t bits;
+      memcpy(&bits, &num, sizeof (bits));
+
+      return hashBits(bits) ^ type;
+    }
+
+    case VAL_BOOL:
+      return hashBits(VAL_AS_BOOL(val)) ^ type;
+
+    case VAL_NIL:
+      return type;
+
+    case VAL_OBJ:
+      return VAL_AS_STR(val)->hash;
+  }
+
+  return 0;
+}
+
+// this is identity rather than `valsEq()`: Floats match by bit pattern, so
+// `0.0` and `-0.0` stay apart while NaNs get shared.
+static bool isSameConst(Val a, Val b) {
+  if (VAL_TYPE(a) != VAL_TYPE(b)) {
+    return false;
+  }
+
+  switch (VAL_TYPE(a)) {
+    case VAL_INT:
+      return VAL_AS_INT(a) == VAL_AS_INT(b);
+
+    case VAL_NUM: {
+      const double x = VAL_AS_NUM(a);
+      const double y = VAL_AS_NUM(b);
+
+      return memcmp(&x, &y, sizeof (x)) == 0;
+    }
+
+    case VAL_BOOL:
+      return VAL_AS_BOOL(a) == VAL_AS_BOOL(b);
+
+    case VAL_NIL:
+      return true;
+
+    case VAL_OBJ: {
+      ObjStr *x = VAL_AS_STR(a);
+      ObjStr *y = VAL_AS_STR(b);
+
+      return (
+        x == y ||
+        (x->length == y->length && memcmp(x->chars, y->chars, x->length) == 0)
+      );
+    }
+  }
+
+  return false;
+}
+
+// returns the slot holding `val`, or the empty slot where it would go.
+static uint32_t *findSlot(ConstMap *map, ValArr *consts, Val val) {
+  size_t index = hashConst(val) & (map->cap - 1);
+
+  while (true) {
+    uint32_t *slot = &map->slots[index];
+
+    if (*slot == 0 || isSameConst(consts->consts[*slot - 1], val)) {
+      return slot;
+    }
+
+    index = (index + 1) & (map->cap - 1);
+  }
+}
+
+static void growConstMap(ConstMap *map, ValArr *consts) {
+  FREE_ARR(uint32_t, map->slots, map->cap);
+
+  map->cap = GROW_CAP(map->cap);
+  map->slots = ALLOC(uint32_t, map->cap);
+
+  memset(map->slots, 0, sizeof (uint32_t) * map->cap);
+
+  // every constant is in the pool exactly once, so we can rebuild the map
+  // straight from it.
+  for (size_t i = 0; i < consts->next; i++) {
+    *findSlot(map, consts, consts->consts[i]) = (uint32_t)(i + 1);
+  }
+}
+
 int addConst(Chunk *ch, Val val) {
+  ConstMap *map = &ch->constMap;
+
+  if ((double)(map->count + 1) > (double)map->cap * CONST_MAP_MAX_LOAD) {
+    growConstMap(map, &ch->consts);
+  }
+
+  uint32_t *slot = findSlot(map, &ch->consts, val);
+
+  if (*slot != 0) {
+    return (int)(*slot - 1);
+  }
+
   writeValArr(&ch->consts, val);
+
+  *slot = (uint32_t)ch->consts.next;
+  map->count++;
+
   return (int)(ch->consts.next - 1);
 }
 
@@ -106,6 +373,7 @@ void freeLineArr(LineArr *arr) {
 
   arr->cap = 0;
   arr->next = 0;
+  arr->lines = NULL;
 }
 
 int getLine(Chunk *ch, size_t offset) {
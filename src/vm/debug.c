@@ -52,121 +52,388 @@ void disasmChunk(Chunk *ch, const char *name) {
   }
 }
 
-size_t disasmInstr(Chunk *ch, size_t offset) {
-  IGNORE(byteInstr);
-
-  printf("%4zu  ", offset);
-
-  const uint8_t instr = ch->code[offset];
-  const int line = getLine(ch, offset);
-  const int prevLine = offset > 0 ? getLine(ch, offset - 1) : -1;
-
-  if (line == prevLine) {
-    printf("   |  ");
-  } else {
-    printf("%4d  ", line);
-  }
-
-  switch (instr) {
-    case OP_RET:
-      return simpleInstr("ret", offset);
+// the mnemonic `disasmInstr()` shows for `op`, or `NULL` if there’s no such
+// opcode.
+const char *opName(uint8_t op) {
+  switch (op) {
+    case OP_CONST:
+      return "push";
 
     case OP_CONST_LONG:
-      return longConstInstr("pushl", ch, offset);
-    
-    case OP_CONST:
-      return constInstr("push", ch, offset);
+      return "pushl";
 
     case OP_TRUE:
-      return simpleInstr("true", offset);
+      return "true";
 
     case OP_FALSE:
-      return simpleInstr("false", offset);
+      return "false";
 
     case OP_NIL:
-      return simpleInstr("nil", offset);
+      return "nil";
 
     case OP_ZERO:
-      return simpleInstr("pushz", offset);
+      return "pushz";
+
+    case OP_ONE:
+      return "push1";
 
     case OP_MINUS_ONE:
-      return simpleInstr("pushm1", offset);
+      return "pushm1";
 
-    case OP_ONE:
-      return simpleInstr("push1", offset);
-    
-    case OP_NEG:
-      return simpleInstr("neg", offset);
+    case OP_FLOAT_ZERO:
+      return "fpushz";
+
+    case OP_FLOAT_ONE:
+      return "fpush1";
+
+    case OP_FLOAT_MINUS_ONE:
+      return "fpushm1";
+
+    case OP_INT_TO_FLOAT:
+      return "itof";
+
+    case OP_INT_TO_FLOAT_UNDER:
+      return "itofu";
 
     case OP_NOT:
-      return simpleInstr("not", offset);
+      return "not";
 
     case OP_IS_NIL:
-      return simpleInstr("isnil", offset);
+      return "isnil";
 
     case OP_IS_ZERO:
-      return simpleInstr("isz", offset);
-    
+      return "isz";
+
     case OP_IS_MINUS_ONE:
-      return simpleInstr("ism1", offset);
+      return "ism1";
+
+    case OP_INT_NEG:
+      return "ineg";
+
+    case OP_INT_ADD:
+      return "iadd";
+
+    case OP_INT_SUB:
+      return "isub";
+
+    case OP_INT_MUL:
+      return "imul";
+
+    case OP_INT_SHL:
+      return "ishl";
+
+    case OP_INT_SHR:
+      return "ishr";
+
+    case OP_INT_BIT_AND:
+      return "iband";
+
+    case OP_INT_BIT_XOR:
+      return "ixor";
 
-    case OP_ADD:
-      return simpleInstr("add", offset);
+    case OP_INT_BIT_OR:
+      return "ibor";
 
-    case OP_SUB:
-      return simpleInstr("sub", offset);
+    case OP_INT_GREATER:
+      return "igt";
 
-    case OP_MUL:
-      return simpleInstr("mul", offset);
+    case OP_INT_LESS:
+      return "ilt";
 
-    case OP_DIV:
-      return simpleInstr("div", offset);
+    case OP_INT_GREATER_EQ:
+      return "igte";
+
+    case OP_INT_LESS_EQ:
+      return "ilte";
+
+    case OP_FLOAT_NEG:
+      return "fneg";
+
+    case OP_FLOAT_ADD:
+      return "fadd";
+
+    case OP_FLOAT_SUB:
+      return "fsub";
+
+    case OP_FLOAT_MUL:
+      return "fmul";
+
+    case OP_FLOAT_DIV:
+      return "fdiv";
+
+    case OP_FLOAT_GREATER:
+      return "fgt";
+
+    case OP_FLOAT_LESS:
+      return "flt";
+
+    case OP_FLOAT_GREATER_EQ:
+      return "fgte";
+
+    case OP_FLOAT_LESS_EQ:
+      return "flte";
 
     case OP_CONCAT:
-      return simpleInstr("concat", offset);
+      return "concat";
+
+    case OP_CONCAT_N:
+      return "concatn";
+
+    case OP_EQ:
+      return "eq";
+
+    case OP_NEQ:
+      return "neq";
+
+    case OP_INT_ADD_CONST:
+      return "iaddk";
+
+    case OP_INT_SUB_CONST:
+      return "isubk";
+
+    case OP_INT_MUL_CONST:
+      return "imulk";
+
+    case OP_FLOAT_ADD_CONST:
+      return "faddk";
+
+    case OP_FLOAT_SUB_CONST:
+      return "fsubk";
+
+    case OP_FLOAT_MUL_CONST:
+      return "fmulk";
+
+    case OP_FLOAT_NOT_GREATER:
+      return "fngt";
+
+    case OP_FLOAT_NOT_LESS:
+      return "fnlt";
+
+    case OP_FLOAT_NOT_GREATER_EQ:
+      return "fngte";
+
+    case OP_FLOAT_NOT_LESS_EQ:
+      return "fnlte";
+
+    case OP_RET:
+      return "ret";
+
+    default:
+      return NULL;
+  }
+}
+
+size_t disasmInstr(Chunk *ch, size_t offset) {
+  printf("%4zu  ", offset);
+
+  const uint8_t instr = ch->code[offset];
+  const int line = getLine(ch, offset);
+  const int prevLine = offset > 0 ? getLine(ch, offset - 1) : -1;
+
+  if (line == prevLine) {
+    printf("   |  ");
+  } else {
+    printf("%4d  ", line);
+  }
+
+  const char *name = opName(instr);
+
+  switch (instr) {
+    case OP_CONST_LONG:
+      return longConstInstr(name, ch, offset);
+
+    case OP_CONST:
+    case OP_INT_ADD_CONST:
+    case OP_INT_SUB_CONST:
+    case OP_INT_MUL_CONST:
+    case OP_FLOAT_ADD_CONST:
+    case OP_FLOAT_SUB_CONST:
+    case OP_FLOAT_MUL_CONST:
+      return constInstr(name, ch, offset);
+
+    case OP_CONCAT_N:
+      return byteInstr(name, ch, offset);
 
     /*
     case OP_INTERPOL:
       return byteInstr("interpol", ch, offset);
     */
 
-    case OP_SHL:
-      return simpleInstr("shl", offset);
+    default:
+      if (name == NULL) {
+        printf("unknown instr %u\n", instr);
+        return offset + 1;
+      }
 
-    case OP_SHR:
-      return simpleInstr("shr", offset);
-    
-    case OP_BIT_AND:
-      return simpleInstr("band", offset);
+      return simpleInstr(name, offset);
+  }
+}
 
-    case OP_BIT_XOR:
-      return simpleInstr("xor", offset);
+const char *regOpName(uint8_t op) {
+  switch (op) {
+    case REG_MOVE:
+      return "move";
 
-    case OP_BIT_OR:
-      return simpleInstr("bor", offset);
+    case REG_INT_TO_FLOAT:
+      return "itof";
 
-    case OP_EQ:
-      return simpleInstr("eq", offset);
+    case REG_NOT:
+      return "not";
 
-    case OP_NEQ:
-      return simpleInstr("neq", offset);
-    
-    case OP_GREATER:
-      return simpleInstr("gt", offset);
+    case REG_IS_NIL:
+      return "isnil";
+
+    case REG_IS_ZERO:
+      return "isz";
+
+    case REG_IS_MINUS_ONE:
+      return "ism1";
+
+    case REG_INT_NEG:
+      return "ineg";
+
+    case REG_INT_ADD:
+      return "iadd";
+
+    case REG_INT_SUB:
+      return "isub";
+
+    case REG_INT_MUL:
+      return "imul";
+
+    case REG_INT_SHL:
+      return "ishl";
+
+    case REG_INT_SHR:
+      return "ishr";
+
+    case REG_INT_BIT_AND:
+      return "iband";
+
+    case REG_INT_BIT_XOR:
+      return "ixor";
+
+    case REG_INT_BIT_OR:
+      return "ibor";
+
+    case REG_INT_GREATER:
+      return "igt";
 
-    case OP_LESS:
-      return simpleInstr("lt", offset);
+    case REG_INT_LESS:
+      return "ilt";
 
-    case OP_GREATER_EQ:
-      return simpleInstr("gte", offset);
+    case REG_INT_GREATER_EQ:
+      return "igte";
+
+    case REG_INT_LESS_EQ:
+      return "ilte";
+
+    case REG_FLOAT_NEG:
+      return "fneg";
+
+    case REG_FLOAT_ADD:
+      return "fadd";
+
+    case REG_FLOAT_SUB:
+      return "fsub";
+
+    case REG_FLOAT_MUL:
+      return "fmul";
+
+    case REG_FLOAT_DIV:
+      return "fdiv";
+
+    case REG_FLOAT_GREATER:
+      return "fgt";
+
+    case REG_FLOAT_LESS:
+      return "flt";
+
+    case REG_FLOAT_GREATER_EQ:
+      return "fgte";
+
+    case REG_FLOAT_LESS_EQ:
+      return "flte";
+
+    case REG_CONCAT:
+      return "concat";
+
+    case REG_CONCAT_N:
+      return "concatn";
+
+    case REG_EQ:
+      return "eq";
+
+    case REG_NEQ:
+      return "neq";
+
+    case REG_RET:
+      return "ret";
+
+    default:
+      return NULL;
+  }
+}
+
+// registers are shown by number, constants by value.
+static void regOperand(RegChunk *rc, uint8_t slot) {
+  if (slot < rc->regCount) {
+    printf("r%u", slot);
+    return;
+  }
+
+  printVal(rc->pool.consts.consts[slot - rc->regCount]);
+}
+
+void disasmRegChunk(RegChunk *rc, const char *name) {
+  printf("%s (%u registers):\n", name, rc->regCount);
+
+  for (size_t i = 0; i < rc->count; i++) {
+    disasmRegInstr(rc, i);
+  }
+}
+
+void disasmRegInstr(RegChunk *rc, size_t index) {
+  const RegInstr instr = rc->code[index];
+  const char *name = regOpName(instr.op);
+
+  printf("%4zu  ", index);
+
+  if (name == NULL) {
+    printf("unknown instr %u\n", instr.op);
+    return;
+  }
+
+  printf("%-8s ", name);
 
-    case OP_LESS_EQ:
-      return simpleInstr("lte", offset);
+  switch (instr.op) {
+    case REG_RET:
+      regOperand(rc, instr.a);
+      break;
+
+    case REG_CONCAT_N:
+      printf("r%u, r%u..r%u", instr.dst, instr.a, instr.a + instr.b - 1);
+      break;
+
+    case REG_MOVE:
+    case REG_INT_TO_FLOAT:
+    case REG_NOT:
+    case REG_IS_NIL:
+    case REG_IS_ZERO:
+    case REG_IS_MINUS_ONE:
+    case REG_INT_NEG:
+    case REG_FLOAT_NEG:
+      printf("r%u, ", instr.dst);
+      regOperand(rc, instr.a);
+      break;
 
     default:
-      printf("unknown instr %u\n", instr);
-      return offset + 1;
+      printf("r%u, ", instr.dst);
+      regOperand(rc, instr.a);
+      printf(", ");
+      regOperand(rc, instr.b);
+      break;
   }
 
-  return offset;
+  printf("\n");
 }
@@ -0,0 +1,489 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "gc.h"
+#include "geada.h"
+#include "obj.h"
+
+// a file is laid out as the header, the code, the constants, the line table
+// and the characters of every string constant, in that order.  each section
+// starts 8-byte aligned, so that the loader can read it in place.  numbers
+// are stored the way the machine that wrote them stores them.
+#define MAGIC "GEAD"
+#define MAGIC_LENGTH 4
+
+// the header’s flags say how the writer stored numbers and values, and a
+// file is only loaded by a build that stores them the same way.
+#define FLAG_BIG_ENDIAN 0x1
+#define FLAG_NAN_BOXING 0x2
+
+#define ALIGNMENT 8
+#define ALIGN(size) (((size) + ALIGNMENT - 1) & ~(size_t)(ALIGNMENT - 1))
+
+typedef struct {
+  char magic[MAGIC_LENGTH];
+  uint16_t version;
+  uint16_t flags;
+
+  uint32_t codeLength;
+  uint32_t constCount;
+  uint32_t lineCount;
+  uint32_t blobLength;
+} Header;
+
+typedef struct {
+  // a `ValType`.
+  uint32_t type;
+
+  // only used by strings, like `offset` below.
+  uint32_t length;
+
+  union {
+    int64_t integer;
+    double num;
+    uint64_t boolean;
+
+    // where the string starts in the blob.
+    uint64_t offset;
+  } as;
+} Const;
+
+typedef struct {
+  uint32_t offset;
+  int32_t line;
+} LineEntry;
+
+typedef struct {
+  size_t code;
+  size_t consts;
+  size_t lines;
+  size_t blob;
+  size_t end;
+} Layout;
+
+static Layout layOut(Header header) {
+  Layout layout;
+
+  layout.code = ALIGN(sizeof (Header));
+  layout.consts = ALIGN(layout.code + header.codeLength);
+  layout.lines = layout.consts + sizeof (Const) * header.constCount;
+  layout.blob = layout.lines + sizeof (LineEntry) * header.lineCount;
+  layout.end = layout.blob + header.blobLength;
+
+  return layout;
+}
+
+static bool writePadding(FILE *f, size_t from, size_t to) {
+  const char zeros[ALIGNMENT] = { 0 };
+
+  return fwrite(zeros, 1, to - from, f) == to - from;
+}
+
+// only strings are allowed to be objects in a constant pool.
+static bool writeConsts(FILE *f, ValArr *consts) {
+  uint64_t offset = 0;
+
+  for (size_t i = 0; i < consts->next; i++) {
+    const Val val = consts->consts[i];
+
+    Const c;
+    memset(&c, 0, sizeof (c));
+    c.type = (uint32_t)VAL_TYPE(val);
+
+    switch (VAL_TYPE(val)) {
+      case VAL_INT:
+        c.as.integer = VAL_AS_INT(val);
+        break;
+
+      case VAL_NUM:
+        c.as.num = VAL_AS_NUM(val);
+        break;
+
+      case VAL_BOOL:
+        c.as.boolean = VAL_AS_BOOL(val);
+        break;
+
+      case VAL_NIL:
+        break;
+
+      case VAL_OBJ:
+        if (!IS_VAL_STR(val)) {
+          return false;
+        }
+
+        c.length = (uint32_t)VAL_AS_STR(val)->length;
+        c.as.offset = offset;
+
+        // every string is followed by a '\0', like the ones we allocate.
+        offset += c.length + 1;
+        break;
+    }
+
+    if (fwrite(&c, sizeof (c), 1, f) != 1) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+static bool writeLines(FILE *f, LineArr *lines) {
+  for (size_t i = 0; i < lines->next; i++) {
+    LineEntry entry = {
+      .offset = (uint32_t)lines->lines[i].offset,
+      .line = lines->lines[i].line
+    };
+
+    if (fwrite(&entry, sizeof (entry), 1, f) != 1) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+static bool writeBlob(FILE *f, ValArr *consts) {
+  for (size_t i = 0; i < consts->next; i++) {
+    const Val val = consts->consts[i];
+
+    if (!IS_VAL_STR(val)) {
+      continue;
+    }
+
+    ObjStr *str = VAL_AS_STR(val);
+
+    if (
+      fwrite(str->chars, 1, str->length, f) != str->length ||
+      fputc('\0', f) == EOF
+    ) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+static uint32_t blobLength(ValArr *consts) {
+  size_t length = 0;
+
+  for (size_t i = 0; i < consts->next; i++) {
+    const Val val = consts->consts[i];
+
+    if (IS_VAL_STR(val)) {
+      length += VAL_AS_STR(val)->length + 1;
+    }
+  }
+
+  return (uint32_t)length;
+}
+
+static uint16_t ourFlags() {
+  const uint16_t one = 1;
+  uint8_t firstByte;
+  memcpy(&firstByte, &one, 1);
+
+  uint16_t flags = firstByte == 1 ? 0 : FLAG_BIG_ENDIAN;
+
+#ifdef NAN_BOXING
+  flags |= FLAG_NAN_BOXING;
+#endif
+
+  return flags;
+}
+
+bool saveGeada(Chunk *ch, const char *path) {
+  Header header = {
+    .magic = { 'G', 'E', 'A', 'D' },
+    .version = GEADA_VERSION,
+    .flags = ourFlags(),
+    .codeLength = (uint32_t)ch->next,
+    .constCount = (uint32_t)ch->consts.next,
+    .lineCount = (uint32_t)ch->lines.next,
+    .blobLength = blobLength(&ch->consts)
+  };
+
+  const Layout layout = layOut(header);
+
+  FILE *f = fopen(path, "wb");
+
+  if (f == NULL) {
+    return false;
+  }
+
+  const bool wrote = (
+    fwrite(&header, sizeof (header), 1, f) == 1 &&
+    writePadding(f, sizeof (header), layout.code) &&
+    fwrite(ch->code, 1, ch->next, f) == ch->next &&
+    writePadding(f, layout.code + ch->next, layout.consts) &&
+    writeConsts(f, &ch->consts) &&
+    writeLines(f, &ch->lines) &&
+    writeBlob(f, &ch->consts)
+  );
+
+  return fclose(f) == 0 && wrote;
+}
+
+// makes sure every instruction is one the VM knows, that its operands are all
+// there, that it only refers to constants that exist, and that it never
+// takes more values off the stack than there are or puts more on it than
+// fit.  the code has to end in its only `OP_RET`, with exactly one value
+// left to return.  the types of the values aren’t checked, so a file that
+// wasn’t written by `--emit` can still make the VM misread one.
+static bool checkCode(const uint8_t *code, size_t length, size_t constCount) {
+  size_t offset = 0;
+  uint8_t op = OP_RET;
+  int depth = 0;
+
+  while (offset < length) {
+    op = code[offset];
+
+    // the VM stops at the first `OP_RET`, so anything after it would never
+    // be checked against what it leaves on the stack.
+    if (op > OP_RET || (op == OP_RET && offset + 1 != length)) {
+      return false;
+    }
+
+    const size_t next = offset + instrLength(op);
+
+    if (next > length) {
+      return false;
+    }
+
+    int pops;
+    int pushes;
+    stackEffect(op, code + offset + 1, &pops, &pushes);
+
+    if (
+      (op == OP_CONCAT_N && pops < 2) ||
+      (op == OP_RET && depth != 1) ||
+      depth < pops ||
+      depth - pops + pushes > MAX_DEPTH
+    ) {
+      return false;
+    }
+
+    depth += pushes - pops;
+
+    size_t index = 0;
+
+    switch (op) {
+      case OP_CONST:
+      case OP_INT_ADD_CONST:
+      case OP_INT_SUB_CONST:
+      case OP_INT_MUL_CONST:
+      case OP_FLOAT_ADD_CONST:
+      case OP_FLOAT_SUB_CONST:
+      case OP_FLOAT_MUL_CONST:
+        index = code[offset + 1];
+        break;
+
+      case OP_CONST_LONG:
+        index = (
+          (size_t)code[offset + 1] |
+          (size_t)code[offset + 2] << 8 |
+          (size_t)code[offset + 3] << 16
+        );
+        break;
+
+      default:
+        offset = next;
+        continue;
+    }
+
+    if (index >= constCount) {
+      return false;
+    }
+
+    offset = next;
+  }
+
+  return length > 0 && op == OP_RET;
+}
+
+// `getLine()` searches the table, which only works if it starts at the first
+// instruction and never goes backwards.
+static bool checkLines(const LineEntry *lines, uint32_t lineCount) {
+  if (lineCount == 0 || lines[0].offset != 0) {
+    return false;
+  }
+
+  for (uint32_t i = 1; i < lineCount; i++) {
+    if (lines[i].offset < lines[i - 1].offset) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+// strings are interned as soon as they’re read, and the table would be left
+// pointing into a mapping that’s gone.  so everything has to be checked
+// before the first one is made.
+static bool checkConsts(const Const *consts, Header header) {
+  for (uint32_t i = 0; i < header.constCount; i++) {
+    const Const c = consts[i];
+
+    switch ((ValType)c.type) {
+      // a file written with 64-bit Ints may not load with NaN-boxed ones.
+      case VAL_INT:
+        if (!fitsInt(c.as.integer)) {
+          return false;
+        }
+        break;
+
+      case VAL_NUM:
+      case VAL_BOOL:
+      case VAL_NIL:
+        break;
+
+      case VAL_OBJ:
+        if (
+          c.as.offset > header.blobLength ||
+          c.length >= header.blobLength - c.as.offset
+        ) {
+          return false;
+        }
+        break;
+
+      default:
+        return false;
+    }
+  }
+
+  return true;
+}
+
+static void readConsts(VM *vm, Geada *file, Header header, Layout layout) {
+  const char *map = file->map;
+  const Const *consts = (const Const *)(map + layout.consts);
+  const char *blob = map + layout.blob;
+
+  for (uint32_t i = 0; i < header.constCount; i++) {
+    const Const c = consts[i];
+    Val val = NIL_VAL;
+
+    switch ((ValType)c.type) {
+      case VAL_INT:
+        val = INT_VAL(c.as.integer);
+        break;
+
+      case VAL_NUM:
+        val = NUM_VAL(c.as.num);
+        break;
+
+      case VAL_BOOL:
+        val = BOOL_VAL(c.as.boolean != 0);
+        break;
+
+      case VAL_NIL:
+        break;
+
+      case VAL_OBJ:
+        // no copy: the string borrows its characters from the mapping.
+        val = OBJ_VAL(borrowStr(vm, blob + c.as.offset, c.length));
+        break;
+    }
+
+    writeValArr(&file->ch.consts, val);
+  }
+}
+
+static void readLines(Geada *file, Header header, Layout layout) {
+  const LineEntry *lines = (const LineEntry *)(
+    (const char *)file->map + layout.lines
+  );
+
+  for (uint32_t i = 0; i < header.lineCount; i++) {
+    writeLineArr(&file->ch.lines, lines[i].line, lines[i].offset);
+  }
+}
+
+static bool mapFile(const char *path, Geada *file) {
+  const int fd = open(path, O_RDONLY);
+
+  if (fd < 0) {
+    return false;
+  }
+
+  struct stat st;
+
+  if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof (Header)) {
+    close(fd);
+    return false;
+  }
+
+  file->size = (size_t)st.st_size;
+  file->map = mmap(NULL, file->size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+  // the mapping stays valid after the descriptor is gone.
+  close(fd);
+
+  if (file->map == MAP_FAILED) {
+    file->map = NULL;
+    return false;
+  }
+
+  return true;
+}
+
+// on failure, `file` is left closed.
+bool loadGeada(VM *vm, const char *path, Geada *file) {
+  file->map = NULL;
+  file->size = 0;
+  file->ch = newChunk();
+
+  if (!mapFile(path, file)) {
+    return false;
+  }
+
+  Header header;
+  memcpy(&header, file->map, sizeof (header));
+
+  const Layout layout = layOut(header);
+  const uint8_t *code = (const uint8_t *)file->map + layout.code;
+
+  if (
+    memcmp(header.magic, MAGIC, MAGIC_LENGTH) != 0 ||
+    header.version != GEADA_VERSION ||
+    header.flags != ourFlags() ||
+    layout.end > file->size ||
+    !checkCode(code, header.codeLength, header.constCount) ||
+    !checkLines(
+      (const LineEntry *)((char *)file->map + layout.lines),
+      header.lineCount
+    ) ||
+    !checkConsts((const Const *)((char *)file->map + layout.consts), header)
+  ) {
+    closeGeada(file);
+    return false;
+  }
+
+  // the code is only ever read, so the chunk can use it where it is.
+  file->ch.code = (uint8_t *)code;
+  file->ch.next = header.codeLength;
+
+  readLines(file, header, layout);
+
+  rootChunk(vm, &file->ch);
+  readConsts(vm, file, header, layout);
+
+  return true;
+}
+
+// frees everything but the code, which was never ours to begin with.
+void closeGeada(Geada *file) {
+  file->ch.code = NULL;
+  file->ch.next = 0;
+  freeChunk(&file->ch);
+
+  if (file->map != NULL) {
+    munmap(file->map, file->size);
+  }
+
+  file->map = NULL;
+  file->size = 0;
+}
@@ -0,0 +1,696 @@
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "jit.h"
+#include "mem.h"
+
+#ifdef JIT
+// the generated code keeps the VM in r12 and the stack top it was called
+// with in rbx.  both are callee-saved, so they survive calls back into C.
+// how deep the stack is at every instruction is known while translating, so
+// values are addressed off rbx directly and rbx itself never moves.
+
+typedef struct {
+  size_t cap;
+  size_t next;
+
+  uint8_t *bytes;
+} Asm;
+
+typedef enum {
+  RAX = 0,
+  RCX = 1,
+  RDX = 2,
+  RBX = 3,
+  RSI = 6,
+  RDI = 7
+} Reg;
+
+typedef enum {
+  XMM0 = 0,
+  XMM1 = 1
+} XmmReg;
+
+// the low nibble of `setcc`.
+typedef enum {
+  COND_B = 0x2,
+  COND_AE = 0x3,
+  COND_E = 0x4,
+  COND_NE = 0x5,
+  COND_BE = 0x6,
+  COND_A = 0x7,
+  COND_L = 0xC,
+  COND_GE = 0xD,
+  COND_LE = 0xE,
+  COND_G = 0xF
+} Cond;
+
+#define REX_W 0x48
+
+#define MODRM(mod, reg, rm)                                                 \
+  (uint8_t)(((mod) << 6) | (((reg) & 7) << 3) | ((rm) & 7))
+
+#define EMIT(as, ...)                                                       \
+  emitBytes(                                                                \
+    (as),                                                                   \
+    (const uint8_t[]){ __VA_ARGS__ },                                       \
+    sizeof ((const uint8_t[]){ __VA_ARGS__ })                               \
+  )
+
+#ifdef NAN_BOXING
+#define PAYLOAD_OFFSET 0
+#else
+#define PAYLOAD_OFFSET offsetof(Val, as)
+
+// tags are written with a 32-bit store.
+_Static_assert(sizeof (ValType) == 4, "tags must be 32 bits wide");
+#endif
+
+static Asm newAsm() {
+  Asm as = {
+    .cap = 0,
+    .next = 0,
+    .bytes = NULL
+  };
+
+  return as;
+}
+
+static void freeAsm(Asm *as) {
+  FREE_ARR(uint8_t, as->bytes, as->cap);
+
+  as->cap = 0;
+  as->next = 0;
+  as->bytes = NULL;
+}
+
+static void emitBytes(Asm *as, const uint8_t *bytes, size_t count) {
+  if (as->next + count > as->cap) {
+    const size_t oldCap = as->cap;
+
+    while (as->next + count > as->cap) {
+      as->cap = GROW_CAP(as->cap);
+    }
+
+    as->bytes = GROW_ARR(uint8_t, as->bytes, oldCap, as->cap);
+  }
+
+  memcpy(as->bytes + as->next, bytes, count);
+  as->next += count;
+}
+
+// x86 immediates are little-endian, and so is every CPU this runs on.
+static void emitU32(Asm *as, uint32_t u32) {
+  emitBytes(as, (const uint8_t *)&u32, sizeof (u32));
+}
+
+static void emitU64(Asm *as, uint64_t u64) {
+  emitBytes(as, (const uint8_t *)&u64, sizeof (u64));
+}
+
+// the operand `[rbx + disp]`, with `reg` as the other operand (or as part
+// of the opcode.)
+static void emitRbxOperand(Asm *as, int reg, int32_t disp) {
+  if (disp >= INT8_MIN && disp <= INT8_MAX) {
+    EMIT(as, MODRM(1, reg, RBX), (uint8_t)disp);
+  } else {
+    EMIT(as, MODRM(2, reg, RBX));
+    emitU32(as, (uint32_t)disp);
+  }
+}
+
+// where the `slot`th value from the stack top we were called with is, or
+// where its payload or tag is.
+static int32_t slotAt(int slot) {
+  return (int32_t)((size_t)slot * sizeof (Val));
+}
+
+static int32_t payloadAt(int slot) {
+  return slotAt(slot) + (int32_t)PAYLOAD_OFFSET;
+}
+
+static void movImm(Asm *as, Reg reg, uint64_t imm) {
+  EMIT(as, REX_W, (uint8_t)(0xB8 + reg));
+  emitU64(as, imm);
+}
+
+static void setTag(Asm *as, int slot, ValType type) {
+#ifdef NAN_BOXING
+  IGNORE(as);
+  IGNORE(slot);
+  IGNORE(type);
+#else
+  EMIT(as, 0xC7);
+  emitRbxOperand(as, 0, slotAt(slot) + (int32_t)offsetof(Val, type));
+  emitU32(as, (uint32_t)type);
+#endif
+}
+
+static void loadInt(Asm *as, Reg reg, int slot) {
+  EMIT(as, REX_W, 0x8B);
+  emitRbxOperand(as, reg, payloadAt(slot));
+
+#ifdef NAN_BOXING
+  // sign-extends the 48 bits of the payload: `shl reg, 16; sar reg, 16`.
+  EMIT(as, REX_W, 0xC1, MODRM(3, 4, reg), INT_SHIFT);
+  EMIT(as, REX_W, 0xC1, MODRM(3, 7, reg), INT_SHIFT);
+#endif
+}
+
+// the tag is left alone: an Int can only be stored where an Int was.
+static void storeInt(Asm *as, int slot, Reg reg) {
+#ifdef NAN_BOXING
+  // `shl reg, 16; shr reg, 16`, which keeps the lower 48 bits, and then the
+  // tag on top.
+  EMIT(as, REX_W, 0xC1, MODRM(3, 4, reg), INT_SHIFT);
+  EMIT(as, REX_W, 0xC1, MODRM(3, 5, reg), INT_SHIFT);
+  movImm(as, RDX, QNAN | INT_BIT);
+  EMIT(as, REX_W, 0x09, MODRM(3, RDX, reg));
+#else
+  // `shl reg, 16; sar reg, 16`, which wraps it around at 48 bits like
+  // `INT_VAL()` does.
+  EMIT(as, REX_W, 0xC1, MODRM(3, 4, reg), INT_SHIFT);
+  EMIT(as, REX_W, 0xC1, MODRM(3, 7, reg), INT_SHIFT);
+#endif
+
+  EMIT(as, REX_W, 0x89);
+  emitRbxOperand(as, reg, payloadAt(slot));
+}
+
+static void loadFloat(Asm *as, XmmReg reg, int slot) {
+  EMIT(as, 0xF2, 0x0F, 0x10);
+  emitRbxOperand(as, reg, payloadAt(slot));
+}
+
+static void storeFloat(Asm *as, int slot, XmmReg reg) {
+  EMIT(as, 0xF2, 0x0F, 0x11);
+  emitRbxOperand(as, reg, payloadAt(slot));
+}
+
+// one of the scalar double instructions, `xmm0 = xmm0 op [slot]`.
+static void floatOp(Asm *as, uint8_t op, int slot) {
+  EMIT(as, 0xF2, 0x0F, op);
+  emitRbxOperand(as, XMM0, payloadAt(slot));
+}
+
+// stores whether `cond` holds after a comparison.
+static void storeCond(Asm *as, int slot, Cond cond) {
+  // `setcc al; movzx eax, al`.
+  EMIT(as, 0x0F, (uint8_t)(0x90 | cond), 0xC0);
+  EMIT(as, 0x0F, 0xB6, 0xC0);
+
+#ifdef NAN_BOXING
+  // `true` is `false` with the lowest bit set.
+  movImm(as, RDX, FALSE_VAL);
+  EMIT(as, REX_W, 0x09, MODRM(3, RDX, RAX));
+#endif
+
+  EMIT(as, REX_W, 0x89);
+  emitRbxOperand(as, RAX, payloadAt(slot));
+  setTag(as, slot, VAL_BOOL);
+}
+
+static void storeVal(Asm *as, int slot, Val val) {
+#ifdef NAN_BOXING
+  movImm(as, RAX, val);
+#else
+  uint64_t payload;
+  memcpy(&payload, &val.as, sizeof (payload));
+
+  movImm(as, RAX, payload);
+#endif
+
+  EMIT(as, REX_W, 0x89);
+  emitRbxOperand(as, RAX, payloadAt(slot));
+  setTag(as, slot, VAL_TYPE(val));
+}
+
+// calls `fn(vm, stackTop)`, where `stackTop` is past the `slot`th value.
+// `arg`, if there’s one, goes in as a third argument.
+static void emitCall(Asm *as, uint64_t fn, int slot, uint32_t arg) {
+  // `mov rdi, r12; lea rsi, [rbx + disp]; mov edx, arg`.
+  EMIT(as, 0x4C, 0x89, MODRM(3, 4, RDI));
+  EMIT(as, REX_W, 0x8D);
+  emitRbxOperand(as, RSI, slotAt(slot));
+  EMIT(as, 0xBA);
+  emitU32(as, arg);
+
+  // `mov rax, fn; call rax`.
+  movImm(as, RAX, fn);
+  EMIT(as, 0xFF, 0xD0);
+}
+
+#define FN(fn) ((uint64_t)(uintptr_t)(fn))
+
+// these get the stack top as the generated code sees it, which is the
+// only time the VM needs to know.
+
+static void callConcat(VM *vm, Val *stackTop) {
+  vm->stackTop = stackTop;
+  concat(vm);
+}
+
+static void callConcatN(VM *vm, Val *stackTop, uint32_t count) {
+  vm->stackTop = stackTop;
+  concatN(vm, (uint8_t)count);
+}
+
+static void callEq(VM *vm, Val *stackTop, uint32_t isNeg) {
+  vm->stackTop = stackTop;
+  flattenOperands(vm);
+
+  Val b = pop(vm);
+  Val a = pop(vm);
+
+  const bool isEq = valsEq(a, b);
+
+  push(vm, BOOL_VAL(isNeg ? !isEq : isEq));
+}
+
+static Aftermath callRet(VM *vm, Val *stackTop) {
+  vm->stackTop = stackTop;
+
+  printVal(pop(vm));
+  printf("\n");
+
+  return AFTERMATH_OK;
+}
+
+// false if the chunk has no such constant.
+static bool readConst(const Chunk *ch, uint32_t index, Val *val) {
+  if (index >= ch->consts.next) {
+    return false;
+  }
+
+  *val = ch->consts.consts[index];
+
+  return true;
+}
+
+// `maxDepth` is the most values the code ever has on the stack at once.
+static bool translate(Asm *as, const Chunk *ch, int *maxDepth) {
+  // `push rbp; mov rbp, rsp; push rbx; push r12`, which leaves the native
+  // stack aligned to 16 bytes for calls.  then `mov r12, rdi; mov rbx, rsi`.
+  EMIT(as, 0x55, REX_W, 0x89, 0xE5, 0x53, 0x41, 0x54);
+  EMIT(as, 0x49, 0x89, 0xFC, REX_W, 0x89, 0xF3);
+
+  // how many values the code so far leaves on the stack.
+  int depth = 0;
+  *maxDepth = 0;
+
+  for (size_t offset = 0; offset < ch->next; ) {
+    const uint8_t op = ch->code[offset];
+    const size_t length = instrLength(op);
+
+    if (offset + length > ch->next) {
+      return false;
+    }
+
+    const uint8_t *operands = ch->code + offset + 1;
+    offset += length;
+
+    Val val;
+
+#define NEEDS(count)                                            \
+  do {                                                          \
+    if (depth < (count)) {                                      \
+      return false;                                             \
+    }                                                           \
+  } while (false)
+#define PUSH_VAL(v)                                             \
+  do {                                                          \
+    if (depth == MAX_DEPTH) {                                   \
+      return false;                                             \
+    }                                                           \
+                                                                \
+    storeVal(as, depth++, (v));                                 \
+                                                                \
+    if (depth > *maxDepth) {                                    \
+      *maxDepth = depth;                                        \
+    }                                                           \
+  } while (false)
+#define READ_CONST(index)                                       \
+  do {                                                          \
+    if (!readConst(ch, (index), &val)) {                        \
+      return false;                                             \
+    }                                                           \
+  } while (false)
+// `op rax, rcx`, with the opcode bytes given.
+#define INT_OP(...)                                             \
+  do {                                                          \
+    NEEDS(2);                                                   \
+    loadInt(as, RAX, depth - 2);                                \
+    loadInt(as, RCX, depth - 1);                                \
+    EMIT(as, __VA_ARGS__);                                      \
+    storeInt(as, depth - 2, RAX);                               \
+    depth--;                                                    \
+  } while (false)
+// `cmp rax, rcx`.
+#define INT_CMP(cond)                                           \
+  do {                                                          \
+    NEEDS(2);                                                   \
+    loadInt(as, RAX, depth - 2);                                \
+    loadInt(as, RCX, depth - 1);                                \
+    EMIT(as, REX_W, 0x39, 0xC8);                                \
+    storeCond(as, depth - 2, (cond));                           \
+    depth--;                                                    \
+  } while (false)
+#define INT_CONST_OP(...)                                       \
+  do {                                                          \
+    NEEDS(1);                                                   \
+    READ_CONST(operands[0]);                                    \
+    loadInt(as, RAX, depth - 1);                                \
+    movImm(as, RCX, (uint64_t)VAL_AS_INT(val));                 \
+    EMIT(as, __VA_ARGS__);                                      \
+    storeInt(as, depth - 1, RAX);                               \
+  } while (false)
+#define FLOAT_OP(op)                                            \
+  do {                                                          \
+    NEEDS(2);                                                   \
+    loadFloat(as, XMM0, depth - 2);                             \
+    floatOp(as, (op), depth - 1);                               \
+    storeFloat(as, depth - 2, XMM0);                            \
+    depth--;                                                    \
+  } while (false)
+// `movq xmm1, rax` and then `op xmm0, xmm1`.
+#define FLOAT_CONST_OP(op)                                      \
+  do {                                                          \
+    NEEDS(1);                                                   \
+    READ_CONST(operands[0]);                                    \
+                                                                \
+    const double num = VAL_AS_NUM(val);                         \
+    uint64_t bits;                                              \
+    memcpy(&bits, &num, sizeof (bits));                         \
+                                                                \
+    loadFloat(as, XMM0, depth - 1);                             \
+    movImm(as, RAX, bits);                                      \
+    EMIT(as, 0x66, REX_W, 0x0F, 0x6E, 0xC8);                    \
+    EMIT(as, 0xF2, 0x0F, (op), 0xC1);                           \
+    storeFloat(as, depth - 1, XMM0);                            \
+  } while (false)
+// `ucomisd xmm0, [slot]`, with `left` in xmm0.  the conditions that hold
+// when the operands are unordered are the ones that make NaNs compare
+// false--or true for the negated comparisons.
+#define FLOAT_CMP(left, right, cond)                            \
+  do {                                                          \
+    NEEDS(2);                                                   \
+    loadFloat(as, XMM0, (left));                                \
+    EMIT(as, 0x66, 0x0F, 0x2E);                                 \
+    emitRbxOperand(as, XMM0, payloadAt(right));                 \
+    storeCond(as, depth - 2, (cond));                           \
+    depth--;                                                    \
+  } while (false)
+// `a > b` and `a >= b` compare `a` to `b`; `a < b` and `a <= b` compare
+// `b` to `a` instead, so that all of them use the "above" conditions.
+#define FLOAT_CMP_LEFT(cond) FLOAT_CMP(depth - 2, depth - 1, cond)
+#define FLOAT_CMP_RIGHT(cond) FLOAT_CMP(depth - 1, depth - 2, cond)
+
+    switch (op) {
+      case OP_CONST:
+        READ_CONST(operands[0]);
+        PUSH_VAL(val);
+        break;
+
+      case OP_CONST_LONG: {
+        const uint32_t index = (uint32_t)(
+          operands[0] |
+          (operands[1] << 8) |
+          (operands[2] << 16)
+        );
+
+        READ_CONST(index);
+        PUSH_VAL(val);
+        break;
+      }
+
+      case OP_TRUE:
+        PUSH_VAL(BOOL_VAL(true));
+        break;
+
+      case OP_FALSE:
+        PUSH_VAL(BOOL_VAL(false));
+        break;
+
+      case OP_NIL:
+        PUSH_VAL(NIL_VAL);
+        break;
+
+      case OP_ZERO:
+        PUSH_VAL(INT_VAL(0));
+        break;
+
+      case OP_ONE:
+        PUSH_VAL(INT_VAL(1));
+        break;
+
+      case OP_MINUS_ONE:
+        PUSH_VAL(INT_VAL(-1));
+        break;
+
+      case OP_FLOAT_ZERO:
+        PUSH_VAL(NUM_VAL(0));
+        break;
+
+      case OP_FLOAT_ONE:
+        PUSH_VAL(NUM_VAL(1));
+        break;
+
+      case OP_FLOAT_MINUS_ONE:
+        PUSH_VAL(NUM_VAL(-1));
+        break;
+
+      // `cvtsi2sd xmm0, rax`.
+      case OP_INT_TO_FLOAT:
+      case OP_INT_TO_FLOAT_UNDER: {
+        const int under = op == OP_INT_TO_FLOAT_UNDER;
+        const int slot = depth - 1 - under;
+
+        NEEDS(under + 1);
+        loadInt(as, RAX, slot);
+        EMIT(as, 0xF2, REX_W, 0x0F, 0x2A, 0xC0);
+        storeFloat(as, slot, XMM0);
+        setTag(as, slot, VAL_NUM);
+        break;
+      }
+
+      // `xor byte [slot], 1`, which flips a Bool in either representation.
+      case OP_NOT:
+        NEEDS(1);
+        EMIT(as, 0x80);
+        emitRbxOperand(as, 6, payloadAt(depth - 1));
+        EMIT(as, 0x01);
+        break;
+
+      case OP_IS_NIL:
+        NEEDS(1);
+
+#ifdef NAN_BOXING
+        // `mov rax, [slot]; mov rcx, nil; cmp rax, rcx`.
+        EMIT(as, REX_W, 0x8B);
+        emitRbxOperand(as, RAX, payloadAt(depth - 1));
+        movImm(as, RCX, NIL_VAL);
+        EMIT(as, REX_W, 0x39, 0xC8);
+#else
+        // `cmp dword [tag], VAL_NIL`.
+        EMIT(as, 0x81);
+        emitRbxOperand(
+          as,
+          7,
+          slotAt(depth - 1) + (int32_t)offsetof(Val, type)
+        );
+        emitU32(as, VAL_NIL);
+#endif
+
+        storeCond(as, depth - 1, COND_NE);
+        break;
+
+      // `test rax, rax`.
+      case OP_IS_ZERO:
+        NEEDS(1);
+        loadInt(as, RAX, depth - 1);
+        EMIT(as, REX_W, 0x85, 0xC0);
+        storeCond(as, depth - 1, COND_E);
+        break;
+
+      // `cmp rax, -1`.
+      case OP_IS_MINUS_ONE:
+        NEEDS(1);
+        loadInt(as, RAX, depth - 1);
+        EMIT(as, REX_W, 0x83, 0xF8, 0xFF);
+        storeCond(as, depth - 1, COND_E);
+        break;
+
+      // `neg rax`.
+      case OP_INT_NEG:
+        NEEDS(1);
+        loadInt(as, RAX, depth - 1);
+        EMIT(as, REX_W, 0xF7, 0xD8);
+        storeInt(as, depth - 1, RAX);
+        break;
+
+      // the CPU wraps around, and only looks at the lower six bits of a
+      // shift count, just like `run()`.
+      case OP_INT_ADD: INT_OP(REX_W, 0x01, 0xC8); break;
+      case OP_INT_SUB: INT_OP(REX_W, 0x29, 0xC8); break;
+      case OP_INT_MUL: INT_OP(REX_W, 0x0F, 0xAF, 0xC1); break;
+      case OP_INT_SHL: INT_OP(REX_W, 0xD3, 0xE0); break;
+      case OP_INT_SHR: INT_OP(REX_W, 0xD3, 0xF8); break;
+      case OP_INT_BIT_AND: INT_OP(REX_W, 0x21, 0xC8); break;
+      case OP_INT_BIT_XOR: INT_OP(REX_W, 0x31, 0xC8); break;
+      case OP_INT_BIT_OR: INT_OP(REX_W, 0x09, 0xC8); break;
+
+      case OP_INT_GREATER: INT_CMP(COND_G); break;
+      case OP_INT_LESS: INT_CMP(COND_L); break;
+      case OP_INT_GREATER_EQ: INT_CMP(COND_GE); break;
+      case OP_INT_LESS_EQ: INT_CMP(COND_LE); break;
+
+      // `btc qword [slot], 63` flips the sign bit.
+      case OP_FLOAT_NEG:
+        NEEDS(1);
+        EMIT(as, REX_W, 0x0F, 0xBA);
+        emitRbxOperand(as, 7, payloadAt(depth - 1));
+        EMIT(as, 63);
+        break;
+
+      case OP_FLOAT_ADD: FLOAT_OP(0x58); break;
+      case OP_FLOAT_SUB: FLOAT_OP(0x5C); break;
+      case OP_FLOAT_MUL: FLOAT_OP(0x59); break;
+      case OP_FLOAT_DIV: FLOAT_OP(0x5E); break;
+
+      case OP_FLOAT_GREATER: FLOAT_CMP_LEFT(COND_A); break;
+      case OP_FLOAT_GREATER_EQ: FLOAT_CMP_LEFT(COND_AE); break;
+      case OP_FLOAT_LESS: FLOAT_CMP_RIGHT(COND_A); break;
+      case OP_FLOAT_LESS_EQ: FLOAT_CMP_RIGHT(COND_AE); break;
+
+      case OP_FLOAT_NOT_GREATER: FLOAT_CMP_LEFT(COND_BE); break;
+      case OP_FLOAT_NOT_GREATER_EQ: FLOAT_CMP_LEFT(COND_B); break;
+      case OP_FLOAT_NOT_LESS: FLOAT_CMP_RIGHT(COND_BE); break;
+      case OP_FLOAT_NOT_LESS_EQ: FLOAT_CMP_RIGHT(COND_B); break;
+
+      case OP_CONCAT:
+        NEEDS(2);
+        emitCall(as, FN(callConcat), depth, 0);
+        depth--;
+        break;
+
+      case OP_CONCAT_N:
+        NEEDS(operands[0]);
+        emitCall(as, FN(callConcatN), depth, operands[0]);
+        depth -= operands[0] - 1;
+        break;
+
+      case OP_EQ:
+      case OP_NEQ:
+        NEEDS(2);
+        emitCall(as, FN(callEq), depth, (uint32_t)(op == OP_NEQ));
+        depth--;
+        break;
+
+      case OP_INT_ADD_CONST: INT_CONST_OP(REX_W, 0x01, 0xC8); break;
+      case OP_INT_SUB_CONST: INT_CONST_OP(REX_W, 0x29, 0xC8); break;
+      case OP_INT_MUL_CONST: INT_CONST_OP(REX_W, 0x0F, 0xAF, 0xC1); break;
+
+      case OP_FLOAT_ADD_CONST: FLOAT_CONST_OP(0x58); break;
+      case OP_FLOAT_SUB_CONST: FLOAT_CONST_OP(0x5C); break;
+      case OP_FLOAT_MUL_CONST: FLOAT_CONST_OP(0x59); break;
+
+      // whatever `callRet()` returns is ours to return, once the registers
+      // we saved are back: `pop r12; pop rbx; pop rbp; ret`.
+      case OP_RET:
+        NEEDS(1);
+        emitCall(as, FN(callRet), depth, 0);
+        EMIT(as, 0x41, 0x5C, 0x5B, 0x5D, 0xC3);
+        return true;
+
+      default:
+        return false;
+    }
+
+#undef NEEDS
+#undef PUSH_VAL
+#undef READ_CONST
+#undef INT_OP
+#undef INT_CMP
+#undef INT_CONST_OP
+#undef FLOAT_OP
+#undef FLOAT_CONST_OP
+#undef FLOAT_CMP
+#undef FLOAT_CMP_LEFT
+#undef FLOAT_CMP_RIGHT
+  }
+
+  // the code ran off the end without returning.
+  return false;
+}
+
+// copies the code into pages of its own, which are made executable once
+// they’re no longer writable.
+static Jit *install(const Asm *as, int maxDepth) {
+  const size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+  const size_t mapSize = (as->next + pageSize - 1) / pageSize * pageSize;
+
+  void *map = mmap(
+    NULL,
+    mapSize,
+    PROT_READ | PROT_WRITE,
+    MAP_PRIVATE | MAP_ANONYMOUS,
+    -1,
+    0
+  );
+
+  if (map == MAP_FAILED) {
+    return NULL;
+  }
+
+  memcpy(map, as->bytes, as->next);
+
+  if (mprotect(map, mapSize, PROT_READ | PROT_EXEC) != 0) {
+    munmap(map, mapSize);
+    return NULL;
+  }
+
+  Jit *jit = ALLOC(Jit, 1);
+
+  jit->native = (Native)(uintptr_t)map;
+  jit->map = map;
+  jit->mapSize = mapSize;
+  jit->maxDepth = maxDepth;
+
+  return jit;
+}
+#endif
+
+Jit *newJit(const Chunk *ch) {
+#ifdef JIT
+  Asm as = newAsm();
+  int maxDepth;
+  Jit *jit = translate(&as, ch, &maxDepth) ? install(&as, maxDepth) : NULL;
+
+  freeAsm(&as);
+
+  return jit;
+#else
+  IGNORE(ch);
+
+  return NULL;
+#endif
+}
+
+void freeJit(Jit *jit) {
+  if (jit == NULL) {
+    return;
+  }
+
+  munmap(jit->map, jit->mapSize);
+  FREE(Jit, jit);
+}
+
+bool jitFits(VM *vm, const Jit *jit) {
+  return vm->stackTop + jit->maxDepth <= vm->stack + STACK_MAX;
+}
+
+Aftermath runJit(VM *vm, Jit *jit) {
+  return jit->native(vm, vm->stackTop);
+}
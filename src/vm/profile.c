@@ -0,0 +1,283 @@
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "chunk.h"
+#include "debug.h"
+#include "profile.h"
+
+// a superinstruction is worth using once its pair makes up at least this
+// much of everything the training runs executed.
+#define MIN_SHARE 0.01
+
+// long enough for any mnemonic `opName()` returns.
+#define MAX_NAME 16
+
+// how many of the hottest pairs `showProfile()` lists.
+#define SHOWN_PAIRS 40
+
+typedef uint64_t PairCounts[UINT8_MAX + 1][UINT8_MAX + 1];
+
+typedef struct {
+  uint8_t first;
+  uint8_t second;
+  uint8_t fused;
+} Superinstr;
+
+// every superinstruction the VM knows about.  which of them actually get
+// used is up to the profile, one bit per entry.
+static const Superinstr superinstrs[] = {
+  { OP_CONST, OP_INT_ADD, OP_INT_ADD_CONST },
+  { OP_CONST, OP_INT_SUB, OP_INT_SUB_CONST },
+  { OP_CONST, OP_INT_MUL, OP_INT_MUL_CONST },
+  { OP_CONST, OP_FLOAT_ADD, OP_FLOAT_ADD_CONST },
+  { OP_CONST, OP_FLOAT_SUB, OP_FLOAT_SUB_CONST },
+  { OP_CONST, OP_FLOAT_MUL, OP_FLOAT_MUL_CONST },
+  { OP_FLOAT_GREATER, OP_NOT, OP_FLOAT_NOT_GREATER },
+  { OP_FLOAT_LESS, OP_NOT, OP_FLOAT_NOT_LESS },
+  { OP_FLOAT_GREATER_EQ, OP_NOT, OP_FLOAT_NOT_GREATER_EQ },
+  { OP_FLOAT_LESS_EQ, OP_NOT, OP_FLOAT_NOT_LESS_EQ }
+};
+
+#define SUPERINSTR_COUNT (sizeof (superinstrs) / sizeof (superinstrs[0]))
+
+// what this process has executed so far.
+static PairCounts pairCounts;
+
+void recordPair(uint8_t first, uint8_t second) {
+  pairCounts[first][second]++;
+}
+
+static int opByName(const char *name) {
+  for (int op = 0; op <= UINT8_MAX; op++) {
+    const char *opname = opName((uint8_t)op);
+
+    if (opname != NULL && strcmp(opname, name) == 0) {
+      return op;
+    }
+  }
+
+  return -1;
+}
+
+// profiles name opcodes by their mnemonics rather than their numbers, so
+// that they survive adding or reordering opcodes.  pairs we don’t know
+// anymore are skipped.
+static bool readCounts(const char *path, PairCounts counts) {
+  FILE *f = fopen(path, "r");
+
+  if (f == NULL) {
+    return false;
+  }
+
+  char line[64];
+
+  while (fgets(line, sizeof (line), f) != NULL) {
+    if (line[0] == '#') {
+      continue;
+    }
+
+    uint64_t count = 0;
+    char first[MAX_NAME];
+    char second[MAX_NAME];
+
+    if (sscanf(line, "%" SCNu64 " %15s %15s", &count, first, second) != 3) {
+      continue;
+    }
+
+    const int a = opByName(first);
+    const int b = opByName(second);
+
+    if (a >= 0 && b >= 0) {
+      counts[a][b] += count;
+    }
+  }
+
+  fclose(f);
+  return true;
+}
+
+// adds what this process executed to whatever `path` already holds, so that
+// many training runs can go into a single profile.
+bool saveProfile(const char *path) {
+  PairCounts *counts = calloc(1, sizeof (PairCounts));
+
+  if (counts == NULL) {
+    return false;
+  }
+
+  readCounts(path, *counts);
+
+  FILE *f = fopen(path, "w");
+
+  if (f == NULL) {
+    free(counts);
+    return false;
+  }
+
+  fprintf(f, "# neve opcode pair profile: <count> <first> <second>\n");
+
+  for (int a = 0; a <= UINT8_MAX; a++) {
+    for (int b = 0; b <= UINT8_MAX; b++) {
+      const uint64_t count = (*counts)[a][b] + pairCounts[a][b];
+
+      if (count > 0) {
+        fprintf(
+          f,
+          "%" PRIu64 " %s %s\n",
+          count,
+          opName((uint8_t)a),
+          opName((uint8_t)b)
+        );
+      }
+    }
+  }
+
+  memset(pairCounts, 0, sizeof (pairCounts));
+
+  free(counts);
+  return fclose(f) == 0;
+}
+
+static uint64_t totalCount(PairCounts counts) {
+  uint64_t total = 0;
+
+  for (int a = 0; a <= UINT8_MAX; a++) {
+    for (int b = 0; b <= UINT8_MAX; b++) {
+      total += counts[a][b];
+    }
+  }
+
+  return total;
+}
+
+static uint32_t chooseSuperinstrs(PairCounts counts) {
+  const uint64_t total = totalCount(counts);
+  uint32_t enabled = 0;
+
+  for (size_t i = 0; i < SUPERINSTR_COUNT; i++) {
+    const Superinstr s = superinstrs[i];
+    const uint64_t count = counts[s.first][s.second];
+
+    if (total > 0 && (double)count >= (double)total * MIN_SHARE) {
+      enabled |= 1U << i;
+    }
+  }
+
+  return enabled;
+}
+
+bool loadSuperinstrs(const char *path, uint32_t *enabled) {
+  PairCounts *counts = calloc(1, sizeof (PairCounts));
+
+  if (counts == NULL) {
+    return false;
+  }
+
+  const bool found = readCounts(path, *counts);
+
+  if (found) {
+    *enabled = chooseSuperinstrs(*counts);
+  }
+
+  free(counts);
+  return found;
+}
+
+bool fusePair(uint32_t enabled, uint8_t first, uint8_t second, uint8_t *fused) {
+  for (size_t i = 0; i < SUPERINSTR_COUNT; i++) {
+    const Superinstr s = superinstrs[i];
+
+    if (s.first == first && s.second == second && (enabled & (1U << i))) {
+      *fused = s.fused;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+typedef struct {
+  uint64_t count;
+  uint8_t first;
+  uint8_t second;
+} Pair;
+
+static int byCountDesc(const void *a, const void *b) {
+  const uint64_t x = ((const Pair *)a)->count;
+  const uint64_t y = ((const Pair *)b)->count;
+
+  return (x < y) - (x > y);
+}
+
+// prints the hottest pairs in `path`, along with the superinstruction each
+// of them would turn into.  a `*` marks the ones the profile enables.
+bool showProfile(const char *path) {
+  PairCounts *counts = calloc(1, sizeof (PairCounts));
+  Pair *pairs = malloc(sizeof (Pair) * (UINT8_MAX + 1) * (UINT8_MAX + 1));
+
+  if (counts == NULL || pairs == NULL || !readCounts(path, *counts)) {
+    free(counts);
+    free(pairs);
+    return false;
+  }
+
+  size_t pairCount = 0;
+
+  for (int a = 0; a <= UINT8_MAX; a++) {
+    for (int b = 0; b <= UINT8_MAX; b++) {
+      if ((*counts)[a][b] > 0) {
+        Pair pair = {
+          .count = (*counts)[a][b],
+          .first = (uint8_t)a,
+          .second = (uint8_t)b
+        };
+
+        pairs[pairCount++] = pair;
+      }
+    }
+  }
+
+  qsort(pairs, pairCount, sizeof (Pair), byCountDesc);
+
+  const uint64_t total = totalCount(*counts);
+  const uint32_t enabled = chooseSuperinstrs(*counts);
+
+  printf("%" PRIu64 " pairs executed, %zu distinct\n\n", total, pairCount);
+  printf("%14s  %6s  %-16s  %s\n", "count", "share", "pair", "fused");
+
+  for (size_t i = 0; i < pairCount && i < SHOWN_PAIRS; i++) {
+    const Pair pair = pairs[i];
+
+    char name[MAX_NAME * 2];
+    snprintf(
+      name,
+      sizeof (name),
+      "%s %s",
+      opName(pair.first),
+      opName(pair.second)
+    );
+
+    printf(
+      "%14" PRIu64 "  %5.1f%%  %-16s",
+      pair.count,
+      (double)pair.count * 100 / (double)total,
+      name
+    );
+
+    uint8_t fused;
+
+    if (fusePair(UINT32_MAX, pair.first, pair.second, &fused)) {
+      const bool isEnabled = fusePair(enabled, pair.first, pair.second, &fused);
+
+      printf("  %s%s", opName(fused), isEnabled ? " *" : "");
+    }
+
+    printf("\n");
+  }
+
+  free(counts);
+  free(pairs);
+  return true;
+}
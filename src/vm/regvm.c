@@ -0,0 +1,428 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "common.h"
+#include "mem.h"
+#include "obj.h"
+#include "reg.h"
+
+#ifdef DEBUG_EXEC
+#include "debug.h"
+#endif
+
+RegChunk newRegChunk() {
+  RegChunk rc = {
+    .cap = 0,
+    .count = 0,
+    .code = NULL,
+    .pool = newChunk(),
+    .regCount = 0
+  };
+
+  return rc;
+}
+
+void freeRegChunk(RegChunk *rc) {
+  FREE_ARR(RegInstr, rc->code, rc->cap);
+  freeChunk(&rc->pool);
+
+  rc->code = NULL;
+  rc->cap = 0;
+  rc->count = 0;
+  rc->regCount = 0;
+}
+
+void writeRegInstr(RegChunk *rc, RegInstr instr) {
+  if (rc->count == rc->cap) {
+    const size_t oldCap = rc->cap;
+
+    rc->cap = GROW_CAP(oldCap);
+    rc->code = GROW_ARR(RegInstr, rc->code, oldCap, rc->cap);
+  }
+
+  rc->code[rc->count++] = instr;
+}
+
+#ifdef DEBUG_EXEC
+static void printRegs(const Val *frame, uint8_t regCount) {
+  printf("    ");
+
+  for (uint8_t r = 0; r < regCount; r++) {
+    printf("r%u[", r);
+    printVal(frame[r]);
+    printf("] ");
+  }
+
+  printf("\n");
+}
+#endif
+
+// the strings the string instructions work on go on the stack above the
+// frame, where `concat()` and friends expect them.
+static Val regsConcat(VM *vm, Val a, Val b) {
+  push(vm, a);
+  push(vm, b);
+  concat(vm);
+
+  return pop(vm);
+}
+
+static Val regsConcatN(VM *vm, const Val *pieces, uint8_t count) {
+  memcpy(vm->stackTop, pieces, sizeof (Val) * count);
+  vm->stackTop += count;
+  concatN(vm, count);
+
+  return pop(vm);
+}
+
+static bool regsEq(VM *vm, Val a, Val b) {
+  if (IS_VAL_ROPE(a) || IS_VAL_ROPE(b)) {
+    push(vm, a);
+    push(vm, b);
+    flattenOperands(vm);
+
+    b = pop(vm);
+    a = pop(vm);
+  }
+
+  return valsEq(a, b);
+}
+
+#ifdef COMPUTED_GOTO
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+#pragma GCC diagnostic ignored "-Woverride-init"
+#endif
+
+static Aftermath run(VM *vm, RegChunk *rc, Val *frame) {
+  const RegInstr *ip = rc->code;
+  RegInstr instr;
+
+  const uint64_t shiftMask = 63;
+
+#define DST() (frame[instr.dst])
+#define A() (frame[instr.a])
+#define B() (frame[instr.b])
+#define INT_OP(valType, op)                                     \
+  (DST() = valType(VAL_AS_INT(A()) op VAL_AS_INT(B())))
+// signed overflow is undefined behavior in C, so integer arithmetic is done
+// on the unsigned bit patterns, which wrap around.
+#define WRAPPING_OP(op)                                         \
+  do {                                                          \
+    const uint64_t a = (uint64_t)VAL_AS_INT(A());               \
+    const uint64_t b = (uint64_t)VAL_AS_INT(B());               \
+                                                                \
+    DST() = INT_VAL((int64_t)(a op b));                         \
+  } while (false)
+#define FLOAT_OP(valType, op)                                   \
+  (DST() = valType(VAL_AS_NUM(A()) op VAL_AS_NUM(B())))
+
+#ifdef DEBUG_EXEC
+#define TRACE()                                                 \
+  do {                                                          \
+    printRegs(frame, rc->regCount);                             \
+    disasmRegInstr(rc, (size_t)(ip - rc->code));                \
+  } while (false)
+#else
+#define TRACE() do { } while (false)
+#endif
+
+#ifdef COMPUTED_GOTO
+  static void *dispatchTable[UINT8_MAX + 1] = {
+    [0 ... UINT8_MAX] = &&do_UNKNOWN,
+
+    [REG_MOVE] = &&do_REG_MOVE,
+    [REG_INT_TO_FLOAT] = &&do_REG_INT_TO_FLOAT,
+    [REG_NOT] = &&do_REG_NOT,
+    [REG_IS_NIL] = &&do_REG_IS_NIL,
+    [REG_IS_ZERO] = &&do_REG_IS_ZERO,
+    [REG_IS_MINUS_ONE] = &&do_REG_IS_MINUS_ONE,
+    [REG_INT_NEG] = &&do_REG_INT_NEG,
+    [REG_INT_ADD] = &&do_REG_INT_ADD,
+    [REG_INT_SUB] = &&do_REG_INT_SUB,
+    [REG_INT_MUL] = &&do_REG_INT_MUL,
+    [REG_INT_SHL] = &&do_REG_INT_SHL,
+    [REG_INT_SHR] = &&do_REG_INT_SHR,
+    [REG_INT_BIT_AND] = &&do_REG_INT_BIT_AND,
+    [REG_INT_BIT_XOR] = &&do_REG_INT_BIT_XOR,
+    [REG_INT_BIT_OR] = &&do_REG_INT_BIT_OR,
+    [REG_INT_GREATER] = &&do_REG_INT_GREATER,
+    [REG_INT_LESS] = &&do_REG_INT_LESS,
+    [REG_INT_GREATER_EQ] = &&do_REG_INT_GREATER_EQ,
+    [REG_INT_LESS_EQ] = &&do_REG_INT_LESS_EQ,
+    [REG_FLOAT_NEG] = &&do_REG_FLOAT_NEG,
+    [REG_FLOAT_ADD] = &&do_REG_FLOAT_ADD,
+    [REG_FLOAT_SUB] = &&do_REG_FLOAT_SUB,
+    [REG_FLOAT_MUL] = &&do_REG_FLOAT_MUL,
+    [REG_FLOAT_DIV] = &&do_REG_FLOAT_DIV,
+    [REG_FLOAT_GREATER] = &&do_REG_FLOAT_GREATER,
+    [REG_FLOAT_LESS] = &&do_REG_FLOAT_LESS,
+    [REG_FLOAT_GREATER_EQ] = &&do_REG_FLOAT_GREATER_EQ,
+    [REG_FLOAT_LESS_EQ] = &&do_REG_FLOAT_LESS_EQ,
+    [REG_CONCAT] = &&do_REG_CONCAT,
+    [REG_CONCAT_N] = &&do_REG_CONCAT_N,
+    [REG_EQ] = &&do_REG_EQ,
+    [REG_NEQ] = &&do_REG_NEQ,
+    [REG_RET] = &&do_REG_RET
+  };
+
+#define DISPATCH()                                              \
+  do {                                                          \
+    TRACE();                                                    \
+    instr = *ip++;                                              \
+    goto *dispatchTable[instr.op];                              \
+  } while (false)
+#define CASE(op) do_##op:
+#define DEFAULT do_UNKNOWN:
+
+  DISPATCH();
+#else
+#define DISPATCH() continue
+#define CASE(op) case op:
+#define DEFAULT default:
+
+  while (true) {
+    TRACE();
+    instr = *ip++;
+
+    switch (instr.op) {
+#endif
+
+      CASE(REG_MOVE) {
+        DST() = A();
+        DISPATCH();
+      }
+
+      CASE(REG_INT_TO_FLOAT) {
+        DST() = NUM_VAL((double)VAL_AS_INT(A()));
+        DISPATCH();
+      }
+
+      CASE(REG_NOT) {
+        DST() = BOOL_VAL(!VAL_AS_BOOL(A()));
+        DISPATCH();
+      }
+
+      CASE(REG_IS_NIL) {
+        DST() = BOOL_VAL(!IS_VAL_NIL(A()));
+        DISPATCH();
+      }
+
+      CASE(REG_IS_ZERO) {
+        DST() = BOOL_VAL(VAL_AS_INT(A()) == 0);
+        DISPATCH();
+      }
+
+      CASE(REG_IS_MINUS_ONE) {
+        DST() = BOOL_VAL(VAL_AS_INT(A()) == -1);
+        DISPATCH();
+      }
+
+      CASE(REG_INT_NEG) {
+        DST() = INT_VAL((int64_t)(0 - (uint64_t)VAL_AS_INT(A())));
+        DISPATCH();
+      }
+
+      CASE(REG_INT_ADD) {
+        WRAPPING_OP(+);
+        DISPATCH();
+      }
+
+      CASE(REG_INT_SUB) {
+        WRAPPING_OP(-);
+        DISPATCH();
+      }
+
+      CASE(REG_INT_MUL) {
+        WRAPPING_OP(*);
+        DISPATCH();
+      }
+
+      // only the lower six bits of the shift count are used, like in the
+      // stack VM.
+      CASE(REG_INT_SHL) {
+        const uint64_t a = (uint64_t)VAL_AS_INT(A());
+        const uint64_t b = (uint64_t)VAL_AS_INT(B()) & shiftMask;
+
+        DST() = INT_VAL((int64_t)(a << b));
+        DISPATCH();
+      }
+
+      CASE(REG_INT_SHR) {
+        const int64_t a = VAL_AS_INT(A());
+        const uint64_t b = (uint64_t)VAL_AS_INT(B()) & shiftMask;
+
+        DST() = INT_VAL(a >> b);
+        DISPATCH();
+      }
+
+      CASE(REG_INT_BIT_AND) {
+        INT_OP(INT_VAL, &);
+        DISPATCH();
+      }
+
+      CASE(REG_INT_BIT_XOR) {
+        INT_OP(INT_VAL, ^);
+        DISPATCH();
+      }
+
+      CASE(REG_INT_BIT_OR) {
+        INT_OP(INT_VAL, |);
+        DISPATCH();
+      }
+
+      CASE(REG_INT_GREATER) {
+        INT_OP(BOOL_VAL, >);
+        DISPATCH();
+      }
+
+      CASE(REG_INT_LESS) {
+        INT_OP(BOOL_VAL, <);
+        DISPATCH();
+      }
+
+      CASE(REG_INT_GREATER_EQ) {
+        INT_OP(BOOL_VAL, >=);
+        DISPATCH();
+      }
+
+      CASE(REG_INT_LESS_EQ) {
+        INT_OP(BOOL_VAL, <=);
+        DISPATCH();
+      }
+
+      CASE(REG_FLOAT_NEG) {
+        DST() = NUM_VAL(-VAL_AS_NUM(A()));
+        DISPATCH();
+      }
+
+      CASE(REG_FLOAT_ADD) {
+        FLOAT_OP(NUM_VAL, +);
+        DISPATCH();
+      }
+
+      CASE(REG_FLOAT_SUB) {
+        FLOAT_OP(NUM_VAL, -);
+        DISPATCH();
+      }
+
+      CASE(REG_FLOAT_MUL) {
+        FLOAT_OP(NUM_VAL, *);
+        DISPATCH();
+      }
+
+      CASE(REG_FLOAT_DIV) {
+        FLOAT_OP(NUM_VAL, /);
+        DISPATCH();
+      }
+
+      CASE(REG_FLOAT_GREATER) {
+        FLOAT_OP(BOOL_VAL, >);
+        DISPATCH();
+      }
+
+      CASE(REG_FLOAT_LESS) {
+        FLOAT_OP(BOOL_VAL, <);
+        DISPATCH();
+      }
+
+      CASE(REG_FLOAT_GREATER_EQ) {
+        FLOAT_OP(BOOL_VAL, >=);
+        DISPATCH();
+      }
+
+      CASE(REG_FLOAT_LESS_EQ) {
+        FLOAT_OP(BOOL_VAL, <=);
+        DISPATCH();
+      }
+
+      CASE(REG_CONCAT) {
+        DST() = regsConcat(vm, A(), B());
+        DISPATCH();
+      }
+
+      CASE(REG_CONCAT_N) {
+        DST() = regsConcatN(vm, &A(), instr.b);
+        DISPATCH();
+      }
+
+      CASE(REG_EQ) {
+        DST() = BOOL_VAL(regsEq(vm, A(), B()));
+        DISPATCH();
+      }
+
+      CASE(REG_NEQ) {
+        DST() = BOOL_VAL(!regsEq(vm, A(), B()));
+        DISPATCH();
+      }
+
+      CASE(REG_RET) {
+        printVal(A());
+        printf("\n");
+
+        return AFTERMATH_OK;
+      }
+
+      DEFAULT {
+        return AFTERMATH_RUNTIME_ERR;
+      }
+#ifndef COMPUTED_GOTO
+    }
+  }
+#endif
+
+#undef DST
+#undef A
+#undef B
+#undef INT_OP
+#undef WRAPPING_OP
+#undef FLOAT_OP
+#undef TRACE
+#undef DISPATCH
+#undef CASE
+#undef DEFAULT
+}
+
+#ifdef COMPUTED_GOTO
+#pragma GCC diagnostic pop
+#endif
+
+// the frame goes on top of the stack, so the collector sees the registers
+// and the constants like any other stack slot.  registers start out as Nil:
+// whatever was there before may not be a value anymore.
+Aftermath runRegs(VM *vm, RegChunk *rc) {
+  const size_t constCount = rc->pool.consts.next;
+  const size_t frameSize = rc->regCount + constCount;
+
+  // a concatenation copies its pieces above the frame.
+  if (
+    frameSize > REG_FRAME_MAX ||
+    vm->stackTop + frameSize + MAX_CONCAT_PIECES > vm->stack + STACK_MAX
+  ) {
+    return AFTERMATH_RUNTIME_ERR;
+  }
+
+  rootChunk(vm, &rc->pool);
+
+  Val *frame = vm->stackTop;
+
+  for (uint8_t r = 0; r < rc->regCount; r++) {
+    frame[r] = NIL_VAL;
+  }
+
+  if (constCount > 0) {
+    memcpy(
+      frame + rc->regCount,
+      rc->pool.consts.consts,
+      sizeof (Val) * constCount
+    );
+  }
+
+  vm->stackTop = frame + frameSize;
+
+  const Aftermath aftermath = run(vm, rc, frame);
+
+  vm->stackTop = frame;
+
+  return aftermath;
+}
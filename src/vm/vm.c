@@ -3,6 +3,7 @@
 
 #include "common.h"
 #include "compiler.h"
+#include "jit.h"
 #include "mem.h"
 #include "obj.h"
 #include "vm.h"
@@ -11,11 +12,21 @@
 #include "debug.h"
 #endif
 
+#ifdef PROFILE_OPS
+#include "profile.h"
+#endif
+
 #ifdef DEBUG_EXEC
-static void printStack(VM *vm) {
+// `skip` is the slot `run()` keeps for itself, which isn’t part of the
+// program’s stack.
+static void printStack(VM *vm, const Val *skip) {
   printf("    ");
 
   for (Val *v = vm->stack; v < vm->stackTop; v++) {
+    if (v == skip) {
+      continue;
+    }
+
     printf("[");
     printVal(*v);
     printf("] ");
@@ -25,155 +36,444 @@ static void printStack(VM *vm) {
 }
 #endif
 
-VM newVM() {
-  VM vm = {
-    .objs = NULL
-  };
-
-  return vm;
-}
-
-void freeVM(VM *vm) {
-  freeObjs(vm->objs);
-  vm->objs = NULL;
-}
-
-void resetStack(VM *vm) {
-  vm->stackTop = vm->stack;
-}
-
-static void concat(VM *vm) {
-  ObjStr *b = VAL_AS_STR(pop(vm));
-  ObjStr *a = VAL_AS_STR(pop(vm));
-
-  size_t length = a->length + b->length;
-
-  char *chars = ALLOC(char, length + 1);
-
-  memcpy(chars, a->chars, a->length);
-  memcpy(chars + a->length, b->chars, b->length);
-
-  chars[length] = '\0';
-
-  ObjStr *result = allocStr(vm, true, chars, length);
-  push(vm, OBJ_VAL(result));
-}
+#ifdef COMPUTED_GOTO
+// taking the address of a label, as well as the `[a ... b]` range designator,
+// are GNU extensions--and `-pedantic` will complain about them.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+#pragma GCC diagnostic ignored "-Woverride-init"
+#endif
 
 static Aftermath run(VM *vm) {
-#define READ_BYTE() (*vm->ip++)
+  // we keep the instruction pointer and the stack top in locals so that the 
+  // compiler can keep them in registers.  they’re only written back to the VM
+  // when something outside of this function needs to see them.
+  uint8_t *ip = vm->ip;
+  Val *stackTop = vm->stackTop;
+
+  // the topmost value never makes it to memory: it lives in `tos`, and
+  // `stackTop` is one past the value under it.  an operation loads at most
+  // its left operand, and stores nothing.  we start off with a Nil of our
+  // own on top, so that the first push has something to spill, and take it
+  // off again when we return.  that’s the slot `MAX_DEPTH` leaves over.
+  Val tos = NIL_VAL;
+  Val *const ownSlot = stackTop;
+
+  const uint64_t shiftMask = 63;
+
+#define READ_BYTE() (*ip++)
 #define READ_CONST() (vm->ch->consts.consts[READ_BYTE()])
-#define BIN_OP(valType, op)                                     \
+#define PUSH(val)                                               \
+  do {                                                          \
+    *stackTop++ = tos;                                          \
+    tos = (val);                                                \
+  } while (false)
+// the value under the top, which an operation consumes, leaving its result
+// in `tos`.
+#define POP_UNDER() (*--stackTop)
+#define PEEK() (tos)
+// anything outside of this function expects the whole stack in memory.
+#define SAVE_STATE()                                            \
+  do {                                                          \
+    *stackTop = tos;                                            \
+    vm->ip = ip;                                                \
+    vm->stackTop = stackTop + 1;                                \
+  } while (false)
+#define LOAD_STATE()                                            \
   do {                                                          \
-    double b = VAL_AS_NUM(pop(vm));                             \
-    double a = VAL_AS_NUM(pop(vm));                             \
+    ip = vm->ip;                                                \
+    stackTop = vm->stackTop - 1;                                \
+    tos = *stackTop;                                            \
+  } while (false)
+#define INT_OP(valType, op)                                     \
+  do {                                                          \
+    int64_t b = VAL_AS_INT(PEEK());                             \
+    int64_t a = VAL_AS_INT(POP_UNDER());                        \
+                                                                \
+    PEEK() = valType(a op b);                                   \
+  } while (false)
+// signed overflow is undefined behavior in C, so integer arithmetic is done
+// on the unsigned bit patterns, which wrap around.
+#define WRAPPING_OP(op)                                         \
+  do {                                                          \
+    uint64_t b = (uint64_t)VAL_AS_INT(PEEK());                  \
+    uint64_t a = (uint64_t)VAL_AS_INT(POP_UNDER());             \
+                                                                \
+    PEEK() = INT_VAL((int64_t)(a op b));                        \
+  } while (false)
+#define FLOAT_OP(valType, op)                                   \
+  do {                                                          \
+    double b = VAL_AS_NUM(PEEK());                              \
+    double a = VAL_AS_NUM(POP_UNDER());                         \
+                                                                \
+    PEEK() = valType(a op b);                                   \
+  } while (false)
+// the right operand of these comes from the constant pool instead of the
+// stack.
+#define WRAPPING_CONST_OP(op)                                   \
+  do {                                                          \
+    uint64_t b = (uint64_t)VAL_AS_INT(READ_CONST());            \
+    uint64_t a = (uint64_t)VAL_AS_INT(PEEK());                  \
                                                                 \
-    push(vm, valType(a op b));                                  \
+    PEEK() = INT_VAL((int64_t)(a op b));                        \
   } while (false)
-#define BIT_OP(op)                                              \
+#define FLOAT_CONST_OP(op)                                      \
   do {                                                          \
-    int b = (int)VAL_AS_NUM(pop(vm));                           \
-    int a = (int)VAL_AS_NUM(pop(vm));                           \
+    double b = VAL_AS_NUM(READ_CONST());                        \
+    double a = VAL_AS_NUM(PEEK());                              \
                                                                 \
-    push(vm, NUM_VAL(a op b));                                  \
+    PEEK() = NUM_VAL(a op b);                                   \
+  } while (false)
+// `not (a < b)` isn’t `a >= b` once NaNs are involved, so negated Float
+// comparisons need opcodes of their own.
+#define FLOAT_NOT_OP(op)                                        \
+  do {                                                          \
+    double b = VAL_AS_NUM(PEEK());                              \
+    double a = VAL_AS_NUM(POP_UNDER());                         \
+                                                                \
+    PEEK() = BOOL_VAL(!(a op b));                               \
   } while (false)
 
-  while (true) {
 #ifdef DEBUG_EXEC
-    printStack(vm);
+#define TRACE()                                                 \
+  do {                                                          \
+    SAVE_STATE();                                               \
+    printStack(vm, ownSlot);                                    \
+    disasmInstr(vm->ch, (size_t)(ip - vm->ch->code));           \
+  } while (false)
+#else
+#define TRACE() do { } while (false)
+#endif
+
+#ifdef PROFILE_OPS
+  int prevOp = -1;
 
-    const size_t offset = (size_t)(vm->ip - vm->ch->code);
-    disasmInstr(vm->ch, offset);
+#define PROFILE()                                               \
+  do {                                                          \
+    if (prevOp >= 0) {                                          \
+      recordPair((uint8_t)prevOp, *ip);                         \
+    }                                                           \
+                                                                \
+    prevOp = *ip;                                               \
+  } while (false)
+#else
+#define PROFILE() do { } while (false)
 #endif
 
-    const uint8_t instr = READ_BYTE();
+#ifdef COMPUTED_GOTO
+  static void *dispatchTable[UINT8_MAX + 1] = {
+    [0 ... UINT8_MAX] = &&do_UNKNOWN,
+
+    [OP_CONST] = &&do_OP_CONST,
+    [OP_CONST_LONG] = &&do_OP_CONST_LONG,
+    [OP_TRUE] = &&do_OP_TRUE,
+    [OP_FALSE] = &&do_OP_FALSE,
+    [OP_NIL] = &&do_OP_NIL,
+    [OP_ZERO] = &&do_OP_ZERO,
+    [OP_ONE] = &&do_OP_ONE,
+    [OP_MINUS_ONE] = &&do_OP_MINUS_ONE,
+    [OP_FLOAT_ZERO] = &&do_OP_FLOAT_ZERO,
+    [OP_FLOAT_ONE] = &&do_OP_FLOAT_ONE,
+    [OP_FLOAT_MINUS_ONE] = &&do_OP_FLOAT_MINUS_ONE,
+    [OP_INT_TO_FLOAT] = &&do_OP_INT_TO_FLOAT,
+    [OP_INT_TO_FLOAT_UNDER] = &&do_OP_INT_TO_FLOAT_UNDER,
+    [OP_NOT] = &&do_OP_NOT,
+    [OP_IS_NIL] = &&do_OP_IS_NIL,
+    [OP_IS_ZERO] = &&do_OP_IS_ZERO,
+    [OP_IS_MINUS_ONE] = &&do_OP_IS_MINUS_ONE,
+    [OP_INT_NEG] = &&do_OP_INT_NEG,
+    [OP_INT_ADD] = &&do_OP_INT_ADD,
+    [OP_INT_SUB] = &&do_OP_INT_SUB,
+    [OP_INT_MUL] = &&do_OP_INT_MUL,
+    [OP_INT_SHL] = &&do_OP_INT_SHL,
+    [OP_INT_SHR] = &&do_OP_INT_SHR,
+    [OP_INT_BIT_AND] = &&do_OP_INT_BIT_AND,
+    [OP_INT_BIT_XOR] = &&do_OP_INT_BIT_XOR,
+    [OP_INT_BIT_OR] = &&do_OP_INT_BIT_OR,
+    [OP_INT_GREATER] = &&do_OP_INT_GREATER,
+    [OP_INT_LESS] = &&do_OP_INT_LESS,
+    [OP_INT_GREATER_EQ] = &&do_OP_INT_GREATER_EQ,
+    [OP_INT_LESS_EQ] = &&do_OP_INT_LESS_EQ,
+    [OP_FLOAT_NEG] = &&do_OP_FLOAT_NEG,
+    [OP_FLOAT_ADD] = &&do_OP_FLOAT_ADD,
+    [OP_FLOAT_SUB] = &&do_OP_FLOAT_SUB,
+    [OP_FLOAT_MUL] = &&do_OP_FLOAT_MUL,
+    [OP_FLOAT_DIV] = &&do_OP_FLOAT_DIV,
+    [OP_FLOAT_GREATER] = &&do_OP_FLOAT_GREATER,
+    [OP_FLOAT_LESS] = &&do_OP_FLOAT_LESS,
+    [OP_FLOAT_GREATER_EQ] = &&do_OP_FLOAT_GREATER_EQ,
+    [OP_FLOAT_LESS_EQ] = &&do_OP_FLOAT_LESS_EQ,
+    [OP_CONCAT] = &&do_OP_CONCAT,
+    [OP_CONCAT_N] = &&do_OP_CONCAT_N,
+    [OP_EQ] = &&do_OP_EQ,
+    [OP_NEQ] = &&do_OP_NEQ,
+    [OP_INT_ADD_CONST] = &&do_OP_INT_ADD_CONST,
+    [OP_INT_SUB_CONST] = &&do_OP_INT_SUB_CONST,
+    [OP_INT_MUL_CONST] = &&do_OP_INT_MUL_CONST,
+    [OP_FLOAT_ADD_CONST] = &&do_OP_FLOAT_ADD_CONST,
+    [OP_FLOAT_SUB_CONST] = &&do_OP_FLOAT_SUB_CONST,
+    [OP_FLOAT_MUL_CONST] = &&do_OP_FLOAT_MUL_CONST,
+    [OP_FLOAT_NOT_GREATER] = &&do_OP_FLOAT_NOT_GREATER,
+    [OP_FLOAT_NOT_LESS] = &&do_OP_FLOAT_NOT_LESS,
+    [OP_FLOAT_NOT_GREATER_EQ] = &&do_OP_FLOAT_NOT_GREATER_EQ,
+    [OP_FLOAT_NOT_LESS_EQ] = &&do_OP_FLOAT_NOT_LESS_EQ,
+    [OP_RET] = &&do_OP_RET
+  };
+
+// every handler ends with its own indirect jump, which gives the branch
+// predictor one slot per opcode instead of a single shared one.
+#define DISPATCH()                                              \
+  do {                                                          \
+    TRACE();                                                    \
+    PROFILE();                                                  \
+    goto *dispatchTable[READ_BYTE()];                           \
+  } while (false)
+#define CASE(op) do_##op:
+#define DEFAULT do_UNKNOWN:
 
-    switch (instr) {
-      case OP_CONST: {
-        const Val val = READ_CONST();
+  DISPATCH();
+#else
+#define DISPATCH() continue
+#define CASE(op) case op:
+#define DEFAULT default:
 
-        push(vm, val);
-        break;
+  while (true) {
+    TRACE();
+    PROFILE();
+
+    switch (READ_BYTE()) {
+#endif
+
+      CASE(OP_CONST) {
+        PUSH(READ_CONST());
+        DISPATCH();
       }
       
-      case OP_CONST_LONG: {
-        Chunk *ch = vm->ch;
-
+      CASE(OP_CONST_LONG) {
         const uint8_t byteLength = 8;
         const uint32_t constOffset = (uint32_t)(
-          ch->code[offset + 1] |
-          (ch->code[offset + 2] << byteLength) |
-          (ch->code[offset + 3] << byteLength * 2)
+          ip[0] |
+          (ip[1] << byteLength) |
+          (ip[2] << byteLength * 2)
         );
 
-        const Val val = ch->consts.consts[constOffset]; 
+        ip += 3;
 
-        push(vm, val);
-        break;
+        PUSH(vm->ch->consts.consts[constOffset]);
+        DISPATCH();
       }
 
-      case OP_TRUE:
-        push(vm, BOOL_VAL(true));
-        break;
+      CASE(OP_TRUE) {
+        PUSH(BOOL_VAL(true));
+        DISPATCH();
+      }
 
-      case OP_FALSE:
-        push(vm, BOOL_VAL(false));
-        break;
+      CASE(OP_FALSE) {
+        PUSH(BOOL_VAL(false));
+        DISPATCH();
+      }
 
-      case OP_NIL:
-        push(vm, NIL_VAL);
-        break;
+      CASE(OP_NIL) {
+        PUSH(NIL_VAL);
+        DISPATCH();
+      }
 
-      case OP_ZERO:
-        push(vm, NUM_VAL(0));
-        break;
+      CASE(OP_ZERO) {
+        PUSH(INT_VAL(0));
+        DISPATCH();
+      }
 
-      case OP_ONE:
-        push(vm, NUM_VAL(1));
-        break;
+      CASE(OP_ONE) {
+        PUSH(INT_VAL(1));
+        DISPATCH();
+      }
 
-      case OP_MINUS_ONE:
-        push(vm, NUM_VAL(-1));
-        break;
+      CASE(OP_MINUS_ONE) {
+        PUSH(INT_VAL(-1));
+        DISPATCH();
+      }
 
-      case OP_NEG:
-        vm->stackTop[-1] = NUM_VAL(-VAL_AS_NUM(vm->stackTop[-1]));
-        break;
+      CASE(OP_FLOAT_ZERO) {
+        PUSH(NUM_VAL(0));
+        DISPATCH();
+      }
 
-      case OP_NOT:
-        vm->stackTop[-1] = BOOL_VAL(!VAL_AS_BOOL(vm->stackTop[-1]));
-        break;
+      CASE(OP_FLOAT_ONE) {
+        PUSH(NUM_VAL(1));
+        DISPATCH();
+      }
 
-      case OP_IS_NIL:
-        vm->stackTop[-1] = BOOL_VAL(!IS_VAL_NIL(vm->stackTop[-1]));
-        break;
+      CASE(OP_FLOAT_MINUS_ONE) {
+        PUSH(NUM_VAL(-1));
+        DISPATCH();
+      }
 
-      case OP_IS_ZERO:
-        vm->stackTop[-1] = BOOL_VAL(VAL_AS_NUM(vm->stackTop[-1]) == 0);
-        break;
+      CASE(OP_INT_TO_FLOAT) {
+        PEEK() = NUM_VAL((double)VAL_AS_INT(PEEK()));
+        DISPATCH();
+      }
 
-      case OP_IS_MINUS_ONE:
-        vm->stackTop[-1] = BOOL_VAL(VAL_AS_NUM(vm->stackTop[-1]) == -1);
-        break;
+      // converts the left operand of an operation whose right one is already
+      // on the stack.
+      CASE(OP_INT_TO_FLOAT_UNDER) {
+        stackTop[-1] = NUM_VAL((double)VAL_AS_INT(stackTop[-1]));
+        DISPATCH();
+      }
 
-      case OP_ADD:
-        BIN_OP(NUM_VAL, +);
-        break;
+      CASE(OP_NOT) {
+        PEEK() = BOOL_VAL(!VAL_AS_BOOL(PEEK()));
+        DISPATCH();
+      }
 
-      case OP_SUB:
-        BIN_OP(NUM_VAL, -);
-        break;
+      CASE(OP_IS_NIL) {
+        PEEK() = BOOL_VAL(!IS_VAL_NIL(PEEK()));
+        DISPATCH();
+      }
 
-      case OP_MUL:
-        BIN_OP(NUM_VAL, *);
-        break;
+      CASE(OP_IS_ZERO) {
+        PEEK() = BOOL_VAL(VAL_AS_INT(PEEK()) == 0);
+        DISPATCH();
+      }
 
-      case OP_DIV:
-        BIN_OP(NUM_VAL, /);
-        break;
+      CASE(OP_IS_MINUS_ONE) {
+        PEEK() = BOOL_VAL(VAL_AS_INT(PEEK()) == -1);
+        DISPATCH();
+      }
+
+      CASE(OP_INT_NEG) {
+        PEEK() = INT_VAL((int64_t)(0 - (uint64_t)VAL_AS_INT(PEEK())));
+        DISPATCH();
+      }
+
+      CASE(OP_INT_ADD) {
+        WRAPPING_OP(+);
+        DISPATCH();
+      }
+
+      CASE(OP_INT_SUB) {
+        WRAPPING_OP(-);
+        DISPATCH();
+      }
+
+      CASE(OP_INT_MUL) {
+        WRAPPING_OP(*);
+        DISPATCH();
+      }
+
+      // shifting by the width of the type or more is undefined, so only the 
+      // lower six bits of the shift count are used.
+      CASE(OP_INT_SHL) {
+        const uint64_t b = (uint64_t)VAL_AS_INT(PEEK()) & shiftMask;
+        const uint64_t a = (uint64_t)VAL_AS_INT(POP_UNDER());
+
+        PEEK() = INT_VAL((int64_t)(a << b));
+        DISPATCH();
+      }
+
+      CASE(OP_INT_SHR) {
+        const uint64_t b = (uint64_t)VAL_AS_INT(PEEK()) & shiftMask;
+        const int64_t a = VAL_AS_INT(POP_UNDER());
+
+        PEEK() = INT_VAL(a >> b);
+        DISPATCH();
+      }
+
+      CASE(OP_INT_BIT_AND) {
+        INT_OP(INT_VAL, &);
+        DISPATCH();
+      }
+
+      CASE(OP_INT_BIT_XOR) {
+        INT_OP(INT_VAL, ^);
+        DISPATCH();
+      }
+
+      CASE(OP_INT_BIT_OR) {
+        INT_OP(INT_VAL, |);
+        DISPATCH();
+      }
+
+      CASE(OP_INT_GREATER) {
+        INT_OP(BOOL_VAL, >);
+        DISPATCH();
+      }
+
+      CASE(OP_INT_LESS) {
+        INT_OP(BOOL_VAL, <);
+        DISPATCH();
+      }
+
+      CASE(OP_INT_GREATER_EQ) {
+        INT_OP(BOOL_VAL, >=);
+        DISPATCH();
+      }
 
-      case OP_CONCAT: {
+      CASE(OP_INT_LESS_EQ) {
+        INT_OP(BOOL_VAL, <=);
+        DISPATCH();
+      }
+
+      CASE(OP_FLOAT_NEG) {
+        PEEK() = NUM_VAL(-VAL_AS_NUM(PEEK()));
+        DISPATCH();
+      }
+
+      CASE(OP_FLOAT_ADD) {
+        FLOAT_OP(NUM_VAL, +);
+        DISPATCH();
+      }
+
+      CASE(OP_FLOAT_SUB) {
+        FLOAT_OP(NUM_VAL, -);
+        DISPATCH();
+      }
+
+      CASE(OP_FLOAT_MUL) {
+        FLOAT_OP(NUM_VAL, *);
+        DISPATCH();
+      }
+
+      CASE(OP_FLOAT_DIV) {
+        FLOAT_OP(NUM_VAL, /);
+        DISPATCH();
+      }
+
+      CASE(OP_FLOAT_GREATER) {
+        FLOAT_OP(BOOL_VAL, >);
+        DISPATCH();
+      }
+
+      CASE(OP_FLOAT_LESS) {
+        FLOAT_OP(BOOL_VAL, <);
+        DISPATCH();
+      }
+
+      CASE(OP_FLOAT_GREATER_EQ) {
+        FLOAT_OP(BOOL_VAL, >=);
+        DISPATCH();
+      }
+
+      CASE(OP_FLOAT_LESS_EQ) {
+        FLOAT_OP(BOOL_VAL, <=);
+        DISPATCH();
+      }
+
+      CASE(OP_CONCAT) {
+        SAVE_STATE();
         concat(vm);
-        break;
+        LOAD_STATE();
+
+        DISPATCH();
+      }
+
+      CASE(OP_CONCAT_N) {
+        const uint8_t count = READ_BYTE();
+
+        SAVE_STATE();
+        concatN(vm, count);
+        LOAD_STATE();
+
+        DISPATCH();
       }
 
       /*
@@ -225,102 +525,173 @@ static Aftermath run(VM *vm) {
       }
       */
 
-      case OP_SHL:
-        BIT_OP(<<);
-        break;
+      CASE(OP_EQ) {
+        if (IS_VAL_ROPE(tos) || IS_VAL_ROPE(stackTop[-1])) {
+          SAVE_STATE();
+          flattenOperands(vm);
+          LOAD_STATE();
+        }
 
-      case OP_SHR:
-        BIT_OP(>>);
-        break;
+        Val b = PEEK();
+        Val a = POP_UNDER();
 
-      case OP_BIT_AND:
-        BIT_OP(&);
-        break;
+        PEEK() = BOOL_VAL(valsEq(a, b));
+        DISPATCH();
+      }
 
-      case OP_BIT_XOR:
-        BIT_OP(^);
-        break;
+      CASE(OP_NEQ) {
+        if (IS_VAL_ROPE(tos) || IS_VAL_ROPE(stackTop[-1])) {
+          SAVE_STATE();
+          flattenOperands(vm);
+          LOAD_STATE();
+        }
 
-      case OP_BIT_OR:
-        BIT_OP(|);
-        break;
+        Val b = PEEK();
+        Val a = POP_UNDER();
 
-      case OP_EQ: {
-        Val b = pop(vm);
-        Val a = pop(vm);
+        PEEK() = BOOL_VAL(!valsEq(a, b));
+        DISPATCH();
+      }
 
-        push(vm, BOOL_VAL(valsEq(a, b)));
-        break;
+      CASE(OP_INT_ADD_CONST) {
+        WRAPPING_CONST_OP(+);
+        DISPATCH();
       }
 
-      case OP_NEQ: {
-        Val b = pop(vm);
-        Val a = pop(vm);
+      CASE(OP_INT_SUB_CONST) {
+        WRAPPING_CONST_OP(-);
+        DISPATCH();
+      }
 
-        push(vm, BOOL_VAL(!valsEq(a, b)));
-        break;
+      CASE(OP_INT_MUL_CONST) {
+        WRAPPING_CONST_OP(*);
+        DISPATCH();
       }
 
-      case OP_GREATER:
-        BIN_OP(BOOL_VAL, >);
-        break;
+      CASE(OP_FLOAT_ADD_CONST) {
+        FLOAT_CONST_OP(+);
+        DISPATCH();
+      }
 
-      case OP_LESS:
-        BIN_OP(BOOL_VAL, <);
-        break;
+      CASE(OP_FLOAT_SUB_CONST) {
+        FLOAT_CONST_OP(-);
+        DISPATCH();
+      }
 
-      case OP_GREATER_EQ:
-        BIN_OP(BOOL_VAL, >=);
-        break;
+      CASE(OP_FLOAT_MUL_CONST) {
+        FLOAT_CONST_OP(*);
+        DISPATCH();
+      }
 
-      case OP_LESS_EQ:
-        BIN_OP(BOOL_VAL, <=);
-        break;
+      CASE(OP_FLOAT_NOT_GREATER) {
+        FLOAT_NOT_OP(>);
+        DISPATCH();
+      }
+
+      CASE(OP_FLOAT_NOT_LESS) {
+        FLOAT_NOT_OP(<);
+        DISPATCH();
+      }
+
+      CASE(OP_FLOAT_NOT_GREATER_EQ) {
+        FLOAT_NOT_OP(>=);
+        DISPATCH();
+      }
 
-      case OP_RET:
-        printVal(pop(vm));
+      CASE(OP_FLOAT_NOT_LESS_EQ) {
+        FLOAT_NOT_OP(<=);
+        DISPATCH();
+      }
+
+      // our own Nil is what’s under the result now, and it goes with it.
+      CASE(OP_RET) {
+        printVal(tos);
         printf("\n");
+
+        vm->ip = ip;
+        vm->stackTop = ownSlot;
         return AFTERMATH_OK;
+      }
       
-      default:
+      DEFAULT {
         // TODO: add an error message
+        SAVE_STATE();
         return AFTERMATH_RUNTIME_ERR;
+      }
+#ifndef COMPUTED_GOTO
     }
   }
+#endif
 
 #undef READ_BYTE
 #undef READ_CONST
-#undef BIN_OP
-#undef BIT_OP
+#undef PUSH
+#undef POP_UNDER
+#undef PEEK
+#undef SAVE_STATE
+#undef LOAD_STATE
+#undef INT_OP
+#undef WRAPPING_OP
+#undef FLOAT_OP
+#undef WRAPPING_CONST_OP
+#undef FLOAT_CONST_OP
+#undef FLOAT_NOT_OP
+#undef TRACE
+#undef PROFILE
+#undef DISPATCH
+#undef CASE
+#undef DEFAULT
 }
 
+#ifdef COMPUTED_GOTO
+#pragma GCC diagnostic pop
+#endif
+
+// compiles `src` the quickest way there is and runs it straight away, which
+// is what the REPL wants.
 Aftermath interpret(const char *fname, VM *vm, const char *src) {
   Chunk ch = newChunk();
 
-  if (!compile(vm, fname, src, &ch)) {
+  if (!compile(vm, fname, src, strlen(src), &ch, MODE_DIRECT)) {
     freeChunk(&ch); 
 
     return AFTERMATH_COMPILE_ERR;
   }
 
-  vm->ch = &ch;
-  vm->ip = ch.code;
-
-  Aftermath aftermath = run(vm);
+  Aftermath aftermath = runChunk(vm, &ch);
 
   freeChunk(&ch);
 
   return aftermath;
 }
 
-void push(VM *vm, Val val) {
-  *vm->stackTop = val;
+// the machine code to run `ch` with, if there is any by now.  a chunk is
+// only worth translating once it runs a second time: most never do.
+static Jit *jitFor(VM *vm, Chunk *ch) {
+  if (!vm->useJit) {
+    return NULL;
+  }
 
-  vm->stackTop++;
+  if (ch->jit == NULL && ++ch->runs == JIT_THRESHOLD) {
+    ch->jit = newJit(ch);
+  }
+
+  return ch->jit;
 }
 
-Val pop(VM *vm) {
-  vm->stackTop--;
+Aftermath runChunk(VM *vm, Chunk *ch) {
+  rootChunk(vm, ch);
+
+  vm->ch = ch;
+  vm->ip = ch->code;
+
+  Jit *jit = jitFor(vm, ch);
+  Aftermath aftermath = (
+    jit != NULL && jitFits(vm, jit) ? runJit(vm, jit) : run(vm)
+  );
 
-  return *vm->stackTop;
+  // once we return, nothing guarantees the chunk outlives the VM.
+  vm->ch = NULL;
+
+  return aftermath;
 }
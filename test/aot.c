@@ -0,0 +1,363 @@
+// checks that programs compiled with `--aot` print what `run()` does: every
+// tree is emitted as bytecode and run, and lowered to C, built and run, and
+// both have to print the same thing.
+//
+// the trees are built by hand rather than parsed, since the compiler would
+// fold them into a single constant, and the C would never do any arithmetic
+// of its own.  without a C compiler (`$CC`, or `cc` if that isn’t set),
+// there’s nothing to check.
+//
+// usage: neve-check-aot
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "aot.h"
+#include "ctx.h"
+#include "emit.h"
+#include "peephole.h"
+#include "vm.h"
+
+#define MAX_OUTPUT 512
+#define MAX_PATH 64
+#define MAX_COMMAND 1024
+
+typedef NodeId (*Build)(Tree *tree);
+
+static const Span noSpan = {0, 0};
+
+static char dir[] = "/tmp/neve-check-XXXXXX";
+static char src[MAX_PATH];
+static char exe[MAX_PATH];
+
+static const char *cc;
+
+static NodeId intNode(Tree *tree, long value) {
+  return newInt(tree, value, noSpan);
+}
+
+static NodeId floatNode(Tree *tree, double value) {
+  return newFloat(tree, value, noSpan);
+}
+
+static NodeId strNode(Tree *tree, const char *chars) {
+  return newStr(tree, chars, strlen(chars), false, noSpan);
+}
+
+static NodeId binOp(Tree *tree, NodeId left, TokType op, NodeId right) {
+  return newBinOp(tree, left, op, right, noSpan);
+}
+
+// `(7 + 3) * 6 - 10`.
+static NodeId arith(Tree *tree) {
+  const NodeId seven = intNode(tree, 7);
+  const NodeId sum = binOp(tree, seven, TOK_PLUS, intNode(tree, 3));
+  const NodeId product = binOp(tree, sum, TOK_STAR, intNode(tree, 6));
+
+  return binOp(tree, product, TOK_MINUS, intNode(tree, 10));
+}
+
+// `140737488355327 + 1`, the largest Int plus one.
+static NodeId wrapAdd(Tree *tree) {
+  return binOp(
+    tree,
+    intNode(tree, 140737488355327),
+    TOK_PLUS,
+    intNode(tree, 1)
+  );
+}
+
+// `70368744177664 * 4`.
+static NodeId wrapMul(Tree *tree) {
+  return binOp(
+    tree,
+    intNode(tree, 70368744177664),
+    TOK_STAR,
+    intNode(tree, 4)
+  );
+}
+
+// `-(-140737488355327 - 1)`, the negation of the smallest Int.
+static NodeId wrapNeg(Tree *tree) {
+  const NodeId smallest = binOp(
+    tree,
+    intNode(tree, -140737488355327),
+    TOK_MINUS,
+    intNode(tree, 1)
+  );
+
+  return newUnOp(tree, UNOP_NEG, smallest, noSpan);
+}
+
+// `1 << 64`: shift counts only keep their lowest 6 bits.
+static NodeId shlRange(Tree *tree) {
+  return binOp(tree, intNode(tree, 1), TOK_SHL, intNode(tree, 64));
+}
+
+// `1 << -1`.
+static NodeId shlNeg(Tree *tree) {
+  return binOp(tree, intNode(tree, 1), TOK_SHL, intNode(tree, -1));
+}
+
+// `-8 >> 65`.
+static NodeId shrRange(Tree *tree) {
+  return binOp(tree, intNode(tree, -8), TOK_SHR, intNode(tree, 65));
+}
+
+// `(12 & 10) ^ (12 | 3)`.
+static NodeId bits(Tree *tree) {
+  const NodeId both = binOp(
+    tree,
+    intNode(tree, 12),
+    TOK_BIT_AND,
+    intNode(tree, 10)
+  );
+  const NodeId either = binOp(
+    tree,
+    intNode(tree, 12),
+    TOK_PIPE,
+    intNode(tree, 3)
+  );
+
+  return binOp(tree, both, TOK_BIT_XOR, either);
+}
+
+// `(3 > 2) == (2.5 <= 1)`.
+static NodeId comparisons(Tree *tree) {
+  const NodeId greater = binOp(
+    tree,
+    intNode(tree, 3),
+    TOK_GREATER,
+    intNode(tree, 2)
+  );
+  const NodeId lessEq = binOp(
+    tree,
+    floatNode(tree, 2.5),
+    TOK_LESS_EQUAL,
+    intNode(tree, 1)
+  );
+
+  return binOp(tree, greater, TOK_EQUAL, lessEq);
+}
+
+// `(1 + 2) * 0.5 / 4 - 1.5`.
+static NodeId floats(Tree *tree) {
+  NodeId total = binOp(tree, intNode(tree, 1), TOK_PLUS, intNode(tree, 2));
+
+  total = binOp(tree, total, TOK_STAR, floatNode(tree, 0.5));
+  total = binOp(tree, total, TOK_SLASH, intNode(tree, 4));
+
+  return binOp(tree, total, TOK_MINUS, floatNode(tree, 1.5));
+}
+
+// `"foo" + "bar"`.
+static NodeId twoPieces(Tree *tree) {
+  return binOp(tree, strNode(tree, "foo"), TOK_PLUS, strNode(tree, "bar"));
+}
+
+// more pieces than a single `concatN()` takes.
+static NodeId manyPieces(Tree *tree) {
+  NodeId total = strNode(tree, "ab");
+
+  for (int i = 1; i < MAX_CONCAT_PIECES + 6; i++) {
+    total = binOp(tree, total, TOK_PLUS, strNode(tree, "ab"));
+  }
+
+  return total;
+}
+
+// `"ab" + "c" == "a" + "bc"`.
+static NodeId strEq(Tree *tree) {
+  const NodeId left = binOp(
+    tree,
+    strNode(tree, "ab"),
+    TOK_PLUS,
+    strNode(tree, "c")
+  );
+  const NodeId right = binOp(
+    tree,
+    strNode(tree, "a"),
+    TOK_PLUS,
+    strNode(tree, "bc")
+  );
+
+  return binOp(tree, left, TOK_EQUAL, right);
+}
+
+// drops the newline, so that it can go in the middle of a message.
+static void trimNewline(char *out, size_t length) {
+  if (length > 0 && out[length - 1] == '\n') {
+    length--;
+  }
+
+  out[length] = '\0';
+}
+
+// runs `ch` with everything it prints going to `out`.  stdout is a
+// temporary file by now, so what was printed can be read back from it.
+static void runInto(VM *vm, Chunk *ch, char *out) {
+  fflush(stdout);
+  const off_t start = lseek(STDOUT_FILENO, 0, SEEK_CUR);
+
+  resetStack(vm);
+  runChunk(vm, ch);
+
+  fflush(stdout);
+  const off_t end = lseek(STDOUT_FILENO, 0, SEEK_CUR);
+
+  size_t length = (size_t)(end - start);
+
+  if (length > MAX_OUTPUT - 1) {
+    length = MAX_OUTPUT - 1;
+  }
+
+  const ssize_t got = pread(STDOUT_FILENO, out, length, start);
+  trimNewline(out, got > 0 ? (size_t)got : 0);
+}
+
+// lowers `root` to C, builds it the way `neve --aot` does, and runs it with
+// what it prints going to `out`.
+static bool buildAndRun(Tree *tree, NodeId root, char *out) {
+  char command[MAX_COMMAND];
+  FILE *f = fopen(src, "w");
+
+  if (f == NULL) {
+    return false;
+  }
+
+  lowerToC(tree, root, "check", f);
+
+  if (fclose(f) != 0) {
+    return false;
+  }
+
+  snprintf(
+    command,
+    sizeof (command),
+    "%s -O2 %s -I %s -o %s %s -lm",
+    cc,
+    src,
+    NEVE_RUNTIME_INCLUDE,
+    exe,
+    NEVE_RUNTIME_LIB
+  );
+
+  if (system(command) != 0) {
+    return false;
+  }
+
+  FILE *program = popen(exe, "r");
+
+  if (program == NULL) {
+    return false;
+  }
+
+  const size_t length = fread(out, 1, MAX_OUTPUT - 1, program);
+  trimNewline(out, length);
+
+  return pclose(program) == 0;
+}
+
+static bool check(VM *vm, const char *name, Build build) {
+  Chunk ch = newChunk();
+  char interpreted[MAX_OUTPUT];
+  char compiled[MAX_OUTPUT];
+
+  // `compile()` would root it for us.
+  rootChunk(vm, &ch);
+
+  Ctx ctx = newCtx(vm, newErrMod("check", ""), 0, &ch, MODE_OPTIMIZE);
+  const NodeId root = build(&ctx.tree);
+
+  emitNode(&ctx, root);
+  emitReturn(&ctx, getLoc(&ctx.tree, root));
+  optimizeChunk(&ch);
+
+  runInto(vm, &ch, interpreted);
+
+  bool agree = buildAndRun(&ctx.tree, root, compiled);
+
+  if (!agree) {
+    fprintf(stderr, "%s: couldn’t build or run the program\n", name);
+  } else if (strcmp(interpreted, compiled) != 0) {
+    fprintf(
+      stderr,
+      "%s: run() printed %s, but the program printed %s\n",
+      name,
+      interpreted,
+      compiled
+    );
+    agree = false;
+  }
+
+  freeTokStream(&ctx.toks);
+  freeTree(&ctx.tree);
+  freeArena(&ctx.arena);
+  freeChunk(&ch);
+
+  return agree;
+}
+
+int main() {
+  cc = getenv("CC");
+
+  if (cc == NULL || *cc == '\0') {
+    cc = "cc";
+  }
+
+  char probe[MAX_COMMAND];
+  snprintf(probe, sizeof (probe), "command -v %s > /dev/null", cc);
+
+  if (system(probe) != 0) {
+    fprintf(stderr, "%s: no C compiler, so nothing to check\n", cc);
+    return 0;
+  }
+
+  if (mkdtemp(dir) == NULL) {
+    return 1;
+  }
+
+  snprintf(src, sizeof (src), "%s/check.c", dir);
+  snprintf(exe, sizeof (exe), "%s/check", dir);
+
+  if (freopen("/dev/null", "w", stdout) == NULL) {
+    return 1;
+  }
+
+  FILE *out = tmpfile();
+
+  if (out == NULL || dup2(fileno(out), STDOUT_FILENO) < 0) {
+    return 1;
+  }
+
+  VM vm = newVM();
+  int failed = 0;
+
+  // collections look at the stack, so it has to start out empty.
+  resetStack(&vm);
+
+  failed += !check(&vm, "arith", arith);
+  failed += !check(&vm, "wrapping add", wrapAdd);
+  failed += !check(&vm, "wrapping mul", wrapMul);
+  failed += !check(&vm, "wrapping neg", wrapNeg);
+  failed += !check(&vm, "long shift left", shlRange);
+  failed += !check(&vm, "negative shift left", shlNeg);
+  failed += !check(&vm, "long shift right", shrRange);
+  failed += !check(&vm, "bits", bits);
+  failed += !check(&vm, "comparisons", comparisons);
+  failed += !check(&vm, "floats", floats);
+  failed += !check(&vm, "two pieces", twoPieces);
+  failed += !check(&vm, "many pieces", manyPieces);
+  failed += !check(&vm, "str eq", strEq);
+
+  freeVM(&vm);
+  fclose(out);
+
+  unlink(src);
+  unlink(exe);
+  rmdir(dir);
+
+  return failed != 0;
+}
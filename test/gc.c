@@ -0,0 +1,116 @@
+// checks that a chunk’s constants survive collections for as long as the
+// chunk does, whether it’s the one running or not, and that they can be
+// collected once it’s gone.
+//
+// usage: neve-check-gc
+
+#include <stdio.h>
+#include <string.h>
+
+#include "compiler.h"
+#include "gc.h"
+#include "obj.h"
+#include "vm.h"
+
+// long enough to build a rope, so that running makes objects of its own.
+static const char first[] =
+  "\"0123456789abcdefghijklmnopqrstuv\" + \"ABCDEFGHIJKLMNOPQRSTUVWXYZ012345\"";
+static const char second[] = "\"foo\" + \"bar\" == \"foobar\"";
+
+static bool isLive(VM *vm, Obj *obj) {
+  for (Obj *live = vm->objs; live != NULL; live = live->next) {
+    if (live == obj) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+// whether every constant of `ch` is still around.
+static bool constsLive(VM *vm, Chunk *ch) {
+  for (size_t i = 0; i < ch->consts.next; i++) {
+    const Val val = ch->consts.consts[i];
+
+    if (IS_VAL_OBJ(val) && !isLive(vm, VAL_AS_OBJ(val))) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+static bool compileStr(VM *vm, const char *src, Chunk *ch) {
+  if (!compile(vm, "check", src, strlen(src), ch, MODE_DIRECT)) {
+    fprintf(stderr, "%s: doesn’t compile\n", src);
+    return false;
+  }
+
+  return true;
+}
+
+static bool runTwice(VM *vm, Chunk *ch, const char *name) {
+  for (int i = 0; i < 2; i++) {
+    resetStack(vm);
+
+    if (runChunk(vm, ch) != AFTERMATH_OK) {
+      fprintf(stderr, "%s: didn’t run\n", name);
+      return false;
+    }
+  }
+
+  return true;
+}
+
+int main() {
+  // every chunk prints what it returns; nobody needs to see that.
+  if (freopen("/dev/null", "w", stdout) == NULL) {
+    return 1;
+  }
+
+  VM vm = newVM();
+  Chunk a = newChunk();
+  Chunk b = newChunk();
+  int failed = 0;
+
+  resetStack(&vm);
+
+  if (!compileStr(&vm, first, &a) || !compileStr(&vm, second, &b)) {
+    return 1;
+  }
+
+  // neither chunk is running now.
+  collectGarbage(&vm);
+
+  if (!constsLive(&vm, &a) || !constsLive(&vm, &b)) {
+    fprintf(stderr, "idle chunks lost their constants\n");
+    failed++;
+  }
+
+  failed += !runTwice(&vm, &a, "first");
+  failed += !runTwice(&vm, &b, "second");
+
+  // what `b` was the only one to use can go now.
+  const Val foobar = b.consts.consts[b.consts.next - 1];
+
+  freeChunk(&b);
+  resetStack(&vm);
+  collectGarbage(&vm);
+
+  if (isLive(&vm, VAL_AS_OBJ(foobar))) {
+    fprintf(stderr, "a freed chunk kept its constants\n");
+    failed++;
+  }
+
+  if (!constsLive(&vm, &a)) {
+    fprintf(stderr, "collecting another chunk’s constants took these too\n");
+    failed++;
+  }
+
+  failed += !runTwice(&vm, &a, "first, again");
+
+  freeVM(&vm);
+  freeChunk(&a);
+
+  return failed != 0;
+}
@@ -0,0 +1,308 @@
+// checks that chunks survive being saved as `.geada` files and loaded back,
+// and that the loader turns away files the VM can’t safely run.
+//
+// the chunks are assembled by hand: compiling would fold everything down to
+// a single constant, and would never produce a malformed chunk anyway.
+//
+// usage: neve-check-geada
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "chunk.h"
+#include "geada.h"
+#include "obj.h"
+#include "vm.h"
+
+typedef void (*Build)(VM *vm, Chunk *ch);
+
+// where the header keeps its flags: after the magic and the version.
+#define FLAGS_OFFSET 6
+
+static char path[] = "/tmp/neve-check-XXXXXX";
+
+static void writeStr(VM *vm, Chunk *ch, const char *chars) {
+  writeConst(ch, OBJ_VAL(borrowStr(vm, chars, strlen(chars))), 1);
+}
+
+static void sum(VM *vm, Chunk *ch) {
+  IGNORE(vm);
+
+  writeChunk(ch, OP_ONE, 1);
+  writeConst(ch, INT_VAL(41), 1);
+  writeChunk(ch, OP_INT_ADD, 2);
+  writeConst(ch, NUM_VAL(0.5), 2);
+  writeChunk(ch, OP_INT_TO_FLOAT_UNDER, 2);
+  writeChunk(ch, OP_FLOAT_MUL, 3);
+  writeChunk(ch, OP_RET, 3);
+}
+
+static void strs(VM *vm, Chunk *ch) {
+  writeStr(vm, ch, "ab");
+  writeStr(vm, ch, "cd");
+  writeStr(vm, ch, "ef");
+  writeChunk(ch, OP_CONCAT_N, 1);
+  writeChunk(ch, 3, 1);
+  writeChunk(ch, OP_NIL, 1);
+  writeChunk(ch, OP_NEQ, 1);
+  writeChunk(ch, OP_RET, 1);
+}
+
+static void underflow(VM *vm, Chunk *ch) {
+  IGNORE(vm);
+
+  writeChunk(ch, OP_ONE, 1);
+  writeChunk(ch, OP_INT_ADD, 1);
+  writeChunk(ch, OP_RET, 1);
+}
+
+static void twoLeft(VM *vm, Chunk *ch) {
+  IGNORE(vm);
+
+  writeChunk(ch, OP_ONE, 1);
+  writeChunk(ch, OP_ONE, 1);
+  writeChunk(ch, OP_RET, 1);
+}
+
+static void noneLeft(VM *vm, Chunk *ch) {
+  IGNORE(vm);
+
+  writeChunk(ch, OP_RET, 1);
+}
+
+static void noRet(VM *vm, Chunk *ch) {
+  IGNORE(vm);
+
+  writeChunk(ch, OP_ONE, 1);
+}
+
+static void earlyRet(VM *vm, Chunk *ch) {
+  IGNORE(vm);
+
+  writeChunk(ch, OP_ONE, 1);
+  writeChunk(ch, OP_RET, 1);
+  writeChunk(ch, OP_INT_ADD, 1);
+  writeChunk(ch, OP_RET, 1);
+}
+
+static void missingConst(VM *vm, Chunk *ch) {
+  IGNORE(vm);
+
+  writeChunk(ch, OP_CONST, 1);
+  writeChunk(ch, 0, 1);
+  writeChunk(ch, OP_RET, 1);
+}
+
+static void unknownOp(VM *vm, Chunk *ch) {
+  IGNORE(vm);
+
+  writeChunk(ch, OP_RET + 1, 1);
+  writeChunk(ch, OP_RET, 1);
+}
+
+// `depth` Strs, concatenated a pair at a time once they’re all on the
+// stack.  concatenating makes `run()` put the whole stack in memory.
+static void pieces(VM *vm, Chunk *ch, int depth) {
+  for (int i = 0; i < depth; i++) {
+    writeStr(vm, ch, "ab");
+  }
+
+  for (int i = 1; i < depth; i++) {
+    writeChunk(ch, OP_CONCAT, 1);
+  }
+
+  writeChunk(ch, OP_RET, 1);
+}
+
+static void deepest(VM *vm, Chunk *ch) {
+  pieces(vm, ch, MAX_DEPTH);
+}
+
+static void overflow(VM *vm, Chunk *ch) {
+  pieces(vm, ch, MAX_DEPTH + 1);
+}
+
+static void lonePiece(VM *vm, Chunk *ch) {
+  writeStr(vm, ch, "ab");
+  writeChunk(ch, OP_CONCAT_N, 1);
+  writeChunk(ch, 1, 1);
+  writeChunk(ch, OP_RET, 1);
+}
+
+static void noLines(VM *vm, Chunk *ch) {
+  sum(vm, ch);
+  ch->lines.next = 0;
+}
+
+static void linesAfterCode(VM *vm, Chunk *ch) {
+  sum(vm, ch);
+  ch->lines.lines[0].offset = 1;
+}
+
+static bool sameChunk(const Chunk *a, const Chunk *b) {
+  if (
+    a->next != b->next ||
+    memcmp(a->code, b->code, a->next) != 0 ||
+    a->consts.next != b->consts.next ||
+    a->lines.next != b->lines.next
+  ) {
+    return false;
+  }
+
+  for (size_t i = 0; i < a->consts.next; i++) {
+    if (!valsEq(a->consts.consts[i], b->consts.consts[i])) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+// saves what `build` makes, cut short by `cut` bytes, and loads it back.
+// the loaded chunk has to match the saved one, and run.
+static bool check(const char *name, Build build, long cut, bool loads) {
+  VM vm = newVM();
+  Chunk ch = newChunk();
+
+  resetStack(&vm);
+  rootChunk(&vm, &ch);
+  build(&vm, &ch);
+
+  bool passed = saveGeada(&ch, path);
+
+  if (passed && cut > 0) {
+    FILE *f = fopen(path, "rb");
+    passed = f != NULL && fseek(f, 0, SEEK_END) == 0;
+
+    const long size = passed ? ftell(f) : 0;
+
+    if (f != NULL) {
+      fclose(f);
+    }
+
+    passed = passed && truncate(path, size - cut) == 0;
+  }
+
+  if (!passed) {
+    fprintf(stderr, "%s: couldn’t write %s\n", name, path);
+  }
+
+  Geada file;
+
+  if (passed && loadGeada(&vm, path, &file)) {
+    if (!loads) {
+      fprintf(stderr, "%s: loaded, but shouldn’t have\n", name);
+      passed = false;
+    } else if (!sameChunk(&ch, &file.ch)) {
+      fprintf(stderr, "%s: came back different\n", name);
+      passed = false;
+    } else if (runChunk(&vm, &file.ch) != AFTERMATH_OK) {
+      fprintf(stderr, "%s: didn’t run\n", name);
+      passed = false;
+    }
+
+    // the VM’s strings may point into the file, so it has to go first.
+    freeVM(&vm);
+    closeGeada(&file);
+  } else {
+    if (passed && loads) {
+      fprintf(stderr, "%s: didn’t load\n", name);
+      passed = false;
+    }
+
+    freeVM(&vm);
+  }
+
+  freeChunk(&ch);
+
+  return passed;
+}
+
+// saves `sum` as if by a build whose flags differ from ours in `flip`:
+// one that stores numbers in the other byte order, or NaN-boxes its values
+// when we don’t.  the loader has to turn it away.
+static bool foreign(const char *name, uint16_t flip) {
+  VM vm = newVM();
+  Chunk ch = newChunk();
+
+  resetStack(&vm);
+  rootChunk(&vm, &ch);
+  sum(&vm, &ch);
+
+  uint16_t flags;
+  FILE *f = NULL;
+
+  bool passed = (
+    saveGeada(&ch, path) &&
+    (f = fopen(path, "r+b")) != NULL &&
+    fseek(f, FLAGS_OFFSET, SEEK_SET) == 0 &&
+    fread(&flags, sizeof (flags), 1, f) == 1 &&
+    fseek(f, FLAGS_OFFSET, SEEK_SET) == 0 &&
+    fwrite(&(uint16_t){ flags ^ flip }, sizeof (flags), 1, f) == 1
+  );
+
+  if (f != NULL && fclose(f) != 0) {
+    passed = false;
+  }
+
+  if (!passed) {
+    fprintf(stderr, "%s: couldn’t write %s\n", name, path);
+  }
+
+  Geada file;
+
+  if (passed && loadGeada(&vm, path, &file)) {
+    fprintf(stderr, "%s: loaded, but shouldn’t have\n", name);
+    passed = false;
+
+    freeVM(&vm);
+    closeGeada(&file);
+  } else {
+    freeVM(&vm);
+  }
+
+  freeChunk(&ch);
+
+  return passed;
+}
+
+int main() {
+  const int fd = mkstemp(path);
+
+  if (fd < 0) {
+    return 1;
+  }
+
+  close(fd);
+
+  // every chunk prints what it returns; nobody needs to see that.
+  if (freopen("/dev/null", "w", stdout) == NULL) {
+    return 1;
+  }
+
+  int failed = 0;
+
+  failed += !check("sum", sum, 0, true);
+  failed += !check("strs", strs, 0, true);
+  failed += !check("truncated", sum, 1, false);
+  failed += !check("underflow", underflow, 0, false);
+  failed += !check("two left", twoLeft, 0, false);
+  failed += !check("none left", noneLeft, 0, false);
+  failed += !check("no return", noRet, 0, false);
+  failed += !check("early return", earlyRet, 0, false);
+  failed += !check("missing constant", missingConst, 0, false);
+  failed += !check("unknown opcode", unknownOp, 0, false);
+  failed += !check("deepest", deepest, 0, true);
+  failed += !check("overflow", overflow, 0, false);
+  failed += !check("lone piece", lonePiece, 0, false);
+  failed += !check("no lines", noLines, 0, false);
+  failed += !check("lines after code", linesAfterCode, 0, false);
+  failed += !foreign("other byte order", 0x1);
+  failed += !foreign("other values", 0x2);
+
+  unlink(path);
+
+  return failed != 0;
+}
@@ -0,0 +1,216 @@
+// checks that the JIT and `run()` agree: every expression is compiled once
+// and run twice, the first time by `run()` and the second from machine code,
+// and both runs have to print the same thing.  in builds without the JIT,
+// both runs are interpreted.
+//
+// expressions are compiled in direct mode, since folding would leave
+// nothing but a constant to run.  that’s also the only way to get the stack
+// as deep as it may go, so the deepest expression is checked here, along
+// with one that’s too deep to compile.
+//
+// usage: neve-check-jit
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "compiler.h"
+#include "jit.h"
+#include "vm.h"
+
+#define MAX_OUTPUT 512
+
+// `"a" + (` and its closing parenthesis.
+#define NEST_LENGTH 8
+
+static const char *exprs[] = {
+  // Ints.
+  "7 + 3",
+  "7 - 10",
+  "6 * 7",
+  "(3 + 4) * 5",
+  "1 << 10",
+  "-256 >> 3",
+  "12 & 10",
+  "12 ^ 10",
+  "12 | 3",
+  "-(5 + 2)",
+  "3 > 2",
+  "3 < 2",
+  "3 >= 3",
+  "2 <= 1",
+  "(2 + 3) * 4 - 6 * 7 + 9",
+  "140737488355327 + 1",
+  "-140737488355327 - 2",
+  "70368744177664 * 4",
+  "1 << 64",
+  "1 << -1",
+
+  // Floats, and Ints that become Floats.
+  "1.5 + 2.25",
+  "1.5 - 4",
+  "3 * 2.5",
+  "7 / 2",
+  "-(1.5 * 2)",
+  "1.5 > 1",
+  "2 < 2.5",
+  "2.5 >= 3.5",
+  "1.0 <= 1",
+  "not (1.5 > 2)",
+  "(1 + 2) * 0.5 - 1",
+
+  // concatenation, short and long enough for ropes.
+  "\"foo\" + \"bar\"",
+  "\"a\" + \"b\" + \"c\" + \"d\" + \"e\"",
+  "(\"0123456789012345678901234567890123456789\" + "
+  "\"0123456789012345678901234567890123456789\") + \"!\"",
+
+  // equality.
+  "1 == 1",
+  "1.5 != 1.5",
+  "nil == nil",
+  "true != false",
+  "\"ab\" + \"c\" == \"a\" + \"bc\"",
+  "(1 < 2) == (3 > 4)"
+};
+
+// runs `ch` with everything it prints going to `out`.  stdout is a
+// temporary file by now, so what was printed can be read back from it.
+static void runInto(VM *vm, Chunk *ch, char *out) {
+  fflush(stdout);
+  const off_t start = lseek(STDOUT_FILENO, 0, SEEK_CUR);
+
+  resetStack(vm);
+  runChunk(vm, ch);
+
+  fflush(stdout);
+  const off_t end = lseek(STDOUT_FILENO, 0, SEEK_CUR);
+
+  size_t length = (size_t)(end - start);
+
+  if (length > MAX_OUTPUT - 1) {
+    length = MAX_OUTPUT - 1;
+  }
+
+  const ssize_t got = pread(STDOUT_FILENO, out, length, start);
+  length = got > 0 ? (size_t)got : 0;
+
+  // without the newline, it can go in the middle of a message.
+  if (length > 0 && out[length - 1] == '\n') {
+    length--;
+  }
+
+  out[length] = '\0';
+}
+
+static bool check(VM *vm, const char *src) {
+  Chunk ch = newChunk();
+  char interpreted[MAX_OUTPUT];
+  char translated[MAX_OUTPUT];
+
+  if (!compile(vm, "check", src, strlen(src), &ch, MODE_DIRECT)) {
+    freeChunk(&ch);
+
+    fprintf(stderr, "%s: doesn’t compile\n", src);
+    return false;
+  }
+
+  runInto(vm, &ch, interpreted);
+  runInto(vm, &ch, translated);
+
+  bool agree = strcmp(interpreted, translated) == 0;
+
+  if (!agree) {
+    fprintf(
+      stderr,
+      "%s: run() printed %s, but the JIT printed %s\n",
+      src,
+      interpreted,
+      translated
+    );
+  }
+
+#ifdef JIT
+  if (ch.jit == NULL) {
+    fprintf(stderr, "%s: wasn’t translated\n", src);
+    agree = false;
+  }
+#endif
+
+  freeChunk(&ch);
+
+  return agree;
+}
+
+// nests `depth` Strs like `"a" + ("a" + "a")`, so the stack holds all of
+// them at once before the innermost concatenation.
+static void nest(char *src, int depth) {
+  char *end = src;
+
+  for (int i = 1; i < depth; i++) {
+    end += sprintf(end, "\"a\" + (");
+  }
+
+  end += sprintf(end, "\"a\"");
+
+  for (int i = 1; i < depth; i++) {
+    *end++ = ')';
+  }
+
+  *end = '\0';
+}
+
+static bool tooDeep(VM *vm, const char *src) {
+  Chunk ch = newChunk();
+  const bool compiled = compile(
+    vm,
+    "check",
+    src,
+    strlen(src),
+    &ch,
+    MODE_DIRECT
+  );
+
+  freeChunk(&ch);
+
+  if (compiled) {
+    fprintf(stderr, "too deep: compiled, but shouldn’t have\n");
+  }
+
+  return !compiled;
+}
+
+int main() {
+  if (freopen("/dev/null", "w", stdout) == NULL) {
+    return 1;
+  }
+
+  FILE *out = tmpfile();
+
+  if (out == NULL || dup2(fileno(out), STDOUT_FILENO) < 0) {
+    return 1;
+  }
+
+  VM vm = newVM();
+  int failed = 0;
+
+  // collections look at the stack, so it has to start out empty.
+  resetStack(&vm);
+
+  for (size_t i = 0; i < sizeof (exprs) / sizeof (exprs[0]); i++) {
+    failed += !check(&vm, exprs[i]);
+  }
+
+  char deep[(MAX_DEPTH + 1) * NEST_LENGTH];
+
+  nest(deep, MAX_DEPTH);
+  failed += !check(&vm, deep);
+
+  nest(deep, MAX_DEPTH + 1);
+  failed += !tooDeep(&vm, deep);
+
+  freeVM(&vm);
+  fclose(out);
+
+  return failed != 0;
+}
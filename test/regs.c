@@ -0,0 +1,330 @@
+// checks that the register VM and `run()` agree: every tree is emitted both
+// as register code and as bytecode, and both have to print the same thing
+// when run.
+//
+// the trees are built by hand rather than parsed, since the compiler would
+// fold them into a single constant, and neither VM would have anything to
+// compute.  a tree that needs more registers than a frame has has to be
+// turned away by the emitter, and still run on the stack.
+//
+// usage: neve-check-regs
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "ctx.h"
+#include "emit.h"
+#include "peephole.h"
+#include "reg.h"
+#include "regemit.h"
+#include "vm.h"
+
+#define MAX_OUTPUT 512
+
+typedef NodeId (*Build)(Tree *tree);
+
+static const Span noSpan = {0, 0};
+
+static NodeId intNode(Tree *tree, long value) {
+  return newInt(tree, value, noSpan);
+}
+
+static NodeId floatNode(Tree *tree, double value) {
+  return newFloat(tree, value, noSpan);
+}
+
+static NodeId strNode(Tree *tree, const char *chars) {
+  return newStr(tree, chars, strlen(chars), false, noSpan);
+}
+
+static NodeId binOp(Tree *tree, NodeId left, TokType op, NodeId right) {
+  return newBinOp(tree, left, op, right, noSpan);
+}
+
+// `(7 + 3) * 6 - 10`.
+static NodeId arith(Tree *tree) {
+  const NodeId seven = intNode(tree, 7);
+  const NodeId sum = binOp(tree, seven, TOK_PLUS, intNode(tree, 3));
+  const NodeId product = binOp(tree, sum, TOK_STAR, intNode(tree, 6));
+
+  return binOp(tree, product, TOK_MINUS, intNode(tree, 10));
+}
+
+// `140737488355327 + 1`, the largest Int plus one.
+static NodeId wrapAdd(Tree *tree) {
+  return binOp(
+    tree,
+    intNode(tree, 140737488355327),
+    TOK_PLUS,
+    intNode(tree, 1)
+  );
+}
+
+// `-(-140737488355327 - 1)`, the negation of the smallest Int.
+static NodeId wrapNeg(Tree *tree) {
+  const NodeId smallest = binOp(
+    tree,
+    intNode(tree, -140737488355327),
+    TOK_MINUS,
+    intNode(tree, 1)
+  );
+
+  return newUnOp(tree, UNOP_NEG, smallest, noSpan);
+}
+
+// `(1 << -1) + (-8 >> 65)`: shift counts only keep their lowest 6 bits.
+static NodeId shifts(Tree *tree) {
+  const NodeId left = binOp(
+    tree,
+    intNode(tree, 1),
+    TOK_SHL,
+    intNode(tree, -1)
+  );
+  const NodeId right = binOp(
+    tree,
+    intNode(tree, -8),
+    TOK_SHR,
+    intNode(tree, 65)
+  );
+
+  return binOp(tree, left, TOK_PLUS, right);
+}
+
+// `(12 & 10) ^ (12 | 3)`.
+static NodeId bits(Tree *tree) {
+  const NodeId both = binOp(
+    tree,
+    intNode(tree, 12),
+    TOK_BIT_AND,
+    intNode(tree, 10)
+  );
+  const NodeId either = binOp(
+    tree,
+    intNode(tree, 12),
+    TOK_PIPE,
+    intNode(tree, 3)
+  );
+
+  return binOp(tree, both, TOK_BIT_XOR, either);
+}
+
+// `not ((3 > 2) == (2.5 <= 1))`.
+static NodeId comparisons(Tree *tree) {
+  const NodeId greater = binOp(
+    tree,
+    intNode(tree, 3),
+    TOK_GREATER,
+    intNode(tree, 2)
+  );
+  const NodeId lessEq = binOp(
+    tree,
+    floatNode(tree, 2.5),
+    TOK_LESS_EQUAL,
+    intNode(tree, 1)
+  );
+  const NodeId same = binOp(tree, greater, TOK_EQUAL, lessEq);
+
+  return newUnOp(tree, UNOP_NOT, same, noSpan);
+}
+
+// `-((1 + 2) * 0.5 / 4 - 1.5)`.
+static NodeId floats(Tree *tree) {
+  NodeId total = binOp(tree, intNode(tree, 1), TOK_PLUS, intNode(tree, 2));
+
+  total = binOp(tree, total, TOK_STAR, floatNode(tree, 0.5));
+  total = binOp(tree, total, TOK_SLASH, intNode(tree, 4));
+  total = binOp(tree, total, TOK_MINUS, floatNode(tree, 1.5));
+
+  return newUnOp(tree, UNOP_NEG, total, noSpan);
+}
+
+// more pieces than a single `REG_CONCAT_N` takes.
+static NodeId manyPieces(Tree *tree) {
+  NodeId total = strNode(tree, "ab");
+
+  for (int i = 1; i < MAX_CONCAT_PIECES + 6; i++) {
+    total = binOp(tree, total, TOK_PLUS, strNode(tree, "ab"));
+  }
+
+  return total;
+}
+
+// `"ab" + "c" == "a" + "bc"`.
+static NodeId strEq(Tree *tree) {
+  const NodeId left = binOp(
+    tree,
+    strNode(tree, "ab"),
+    TOK_PLUS,
+    strNode(tree, "c")
+  );
+  const NodeId right = binOp(
+    tree,
+    strNode(tree, "a"),
+    TOK_PLUS,
+    strNode(tree, "bc")
+  );
+
+  return binOp(tree, left, TOK_EQUAL, right);
+}
+
+// `(1 + 1) + ((1 + 1) + ...)`, with `count` sums of ones.  every one of them
+// holds on to a register until the innermost is done, and the ones share a
+// single constant.
+static NodeId nestedSums(Tree *tree, int count) {
+  NodeId total = binOp(tree, intNode(tree, 1), TOK_PLUS, intNode(tree, 1));
+
+  for (int i = 1; i < count; i++) {
+    const NodeId two = binOp(
+      tree,
+      intNode(tree, 1),
+      TOK_PLUS,
+      intNode(tree, 1)
+    );
+
+    total = binOp(tree, two, TOK_PLUS, total);
+  }
+
+  return total;
+}
+
+// fills the frame, registers and constant, to the last slot.
+static NodeId fullFrame(Tree *tree) {
+  return nestedSums(tree, REG_FRAME_MAX - 1);
+}
+
+static NodeId overfullFrame(Tree *tree) {
+  return nestedSums(tree, REG_FRAME_MAX + 1);
+}
+
+// stdout is a temporary file by now, so whatever was printed since `start`
+// can be read back from it.
+static void readBack(off_t start, char *out) {
+  fflush(stdout);
+  const off_t end = lseek(STDOUT_FILENO, 0, SEEK_CUR);
+
+  size_t length = (size_t)(end - start);
+
+  if (length > MAX_OUTPUT - 1) {
+    length = MAX_OUTPUT - 1;
+  }
+
+  const ssize_t got = pread(STDOUT_FILENO, out, length, start);
+  length = got > 0 ? (size_t)got : 0;
+
+  // without the newline, it can go in the middle of a message.
+  if (length > 0 && out[length - 1] == '\n') {
+    length--;
+  }
+
+  out[length] = '\0';
+}
+
+static Aftermath runStackInto(VM *vm, Chunk *ch, char *out) {
+  fflush(stdout);
+  const off_t start = lseek(STDOUT_FILENO, 0, SEEK_CUR);
+
+  resetStack(vm);
+  const Aftermath aftermath = runChunk(vm, ch);
+
+  readBack(start, out);
+  return aftermath;
+}
+
+static Aftermath runRegsInto(VM *vm, RegChunk *rc, char *out) {
+  fflush(stdout);
+  const off_t start = lseek(STDOUT_FILENO, 0, SEEK_CUR);
+
+  resetStack(vm);
+  const Aftermath aftermath = runRegs(vm, rc);
+
+  readBack(start, out);
+  return aftermath;
+}
+
+// `fits` says whether the register emitter should take the tree at all.
+static bool check(VM *vm, const char *name, Build build, bool fits) {
+  Chunk ch = newChunk();
+  RegChunk rc = newRegChunk();
+  char interpreted[MAX_OUTPUT];
+  char registered[MAX_OUTPUT];
+
+  // `compile()` would root it for us.
+  rootChunk(vm, &ch);
+
+  Ctx ctx = newCtx(vm, newErrMod("check", ""), 0, &ch, MODE_OPTIMIZE);
+  const NodeId root = build(&ctx.tree);
+
+  emitNode(&ctx, root);
+  emitReturn(&ctx, getLoc(&ctx.tree, root));
+  optimizeChunk(&ch);
+
+  bool passed = runStackInto(vm, &ch, interpreted) == AFTERMATH_OK;
+
+  if (!passed) {
+    fprintf(stderr, "%s: run() failed\n", name);
+  } else if (emitRegs(vm, &ctx.tree, root, &rc) != fits) {
+    fprintf(
+      stderr,
+      "%s: %s, but shouldn’t have\n",
+      name,
+      fits ? "didn’t fit in a frame" : "fit in a frame"
+    );
+    passed = false;
+  } else if (fits && runRegsInto(vm, &rc, registered) != AFTERMATH_OK) {
+    fprintf(stderr, "%s: runRegs() failed\n", name);
+    passed = false;
+  } else if (fits && strcmp(interpreted, registered) != 0) {
+    fprintf(
+      stderr,
+      "%s: run() printed %s, but runRegs() printed %s\n",
+      name,
+      interpreted,
+      registered
+    );
+    passed = false;
+  }
+
+  freeTokStream(&ctx.toks);
+  freeTree(&ctx.tree);
+  freeArena(&ctx.arena);
+  freeRegChunk(&rc);
+  freeChunk(&ch);
+
+  return passed;
+}
+
+int main() {
+  if (freopen("/dev/null", "w", stdout) == NULL) {
+    return 1;
+  }
+
+  FILE *out = tmpfile();
+
+  if (out == NULL || dup2(fileno(out), STDOUT_FILENO) < 0) {
+    return 1;
+  }
+
+  VM vm = newVM();
+  int failed = 0;
+
+  // collections look at the stack, so it has to start out empty.
+  resetStack(&vm);
+
+  failed += !check(&vm, "arith", arith, true);
+  failed += !check(&vm, "wrapping add", wrapAdd, true);
+  failed += !check(&vm, "wrapping neg", wrapNeg, true);
+  failed += !check(&vm, "shifts", shifts, true);
+  failed += !check(&vm, "bits", bits, true);
+  failed += !check(&vm, "comparisons", comparisons, true);
+  failed += !check(&vm, "floats", floats, true);
+  failed += !check(&vm, "many pieces", manyPieces, true);
+  failed += !check(&vm, "str eq", strEq, true);
+  failed += !check(&vm, "full frame", fullFrame, true);
+  failed += !check(&vm, "overfull frame", overfullFrame, false);
+
+  freeVM(&vm);
+  fclose(out);
+
+  return failed != 0;
+}
@@ -0,0 +1,102 @@
+#!/bin/sh
+# runs every `.neve` file under the given directories, every way `neve` can
+# run it, and checks the last thing each run prints against the file’s
+# `# expect: <value>` comment.  a file with an `# expect error: <message>`
+# comment has to fail with that message instead.
+#
+# usage: test/run.sh <neve> <dir>...
+
+neve=$1
+shift
+
+tmp=$(mktemp -d)
+trap 'rm -rf "$tmp"' EXIT
+
+esc=$(printf '\033')
+failed=0
+
+# drops the colors, and whatever a trace printed before the result.
+lastLine() {
+  sed "s/$esc\[[0-9;]*m//g" "$1" | grep -v '^$' | tail -n 1
+}
+
+fail() {
+  echo "$file ($1): $2" >&2
+  failed=1
+}
+
+# `$1` is how the file was run, and `$2` how that went, or `-` if it doesn’t
+# say.
+check() {
+  if [ -n "$expectErr" ]; then
+    # the offending line is shown too, comment and all.
+    if ! sed "s/$esc\[[0-9;]*m//g" "$tmp/err" | grep '^error: ' |
+      grep -qF "error: $expectErr"
+    then
+      fail "$1" "expected error: $expectErr"
+    elif [ "$2" != - ] && [ "$2" -eq 0 ]; then
+      fail "$1" "reported the error, but succeeded"
+    fi
+
+    return
+  fi
+
+  got=$(lastLine "$tmp/out")
+
+  if [ "$2" != - ] && [ "$2" -ne 0 ]; then
+    fail "$1" "failed: $(lastLine "$tmp/err")"
+  elif [ "$got" != "$expect" ]; then
+    fail "$1" "expected $expect, got $got"
+  fi
+}
+
+# the second run of a file finds it in the cache, in builds that use one.
+runFile() {
+  NEVE_CACHE_DIR="$tmp/cache" "$neve" "$file" > "$tmp/out" 2> "$tmp/err"
+  check file $?
+
+  NEVE_CACHE_DIR="$tmp/cache" "$neve" "$file" > "$tmp/out" 2> "$tmp/err"
+  check cached $?
+}
+
+runEmitted() {
+  "$neve" --emit "$file" "$tmp/emitted.geada" > "$tmp/out" 2> "$tmp/err" &&
+    "$neve" run "$tmp/emitted.geada" > "$tmp/out" 2> "$tmp/err"
+  check emitted $?
+}
+
+# the repl compiles without folding, so this is the run where strings are
+# actually concatenated.  it carries on after errors, so its status says
+# nothing, and its prompts end up in front of the result.
+runDirect() {
+  "$neve" < "$file" 2> "$tmp/err" | sed 's/^\(? \)*//' > "$tmp/out"
+  check direct -
+}
+
+runRegs() {
+  "$neve" --regs "$file" > "$tmp/out" 2> "$tmp/err"
+  check regs $?
+}
+
+# needs a C compiler, which not every machine that runs these has.
+runAot() {
+  "$neve" --aot "$file" "$tmp/aot" > "$tmp/out" 2> "$tmp/err" &&
+    "$tmp/aot" > "$tmp/out" 2> "$tmp/err"
+  check aot $?
+}
+
+for file in $(find "$@" -name '*.neve' | sort); do
+  expect=$(sed -n 's/.*# expect: //p' "$file")
+  expectErr=$(sed -n 's/.*# expect error: //p' "$file")
+
+  runFile
+  runEmitted
+  runDirect
+  runRegs
+
+  if command -v "${CC:-cc}" > /dev/null; then
+    runAot
+  fi
+done
+
+exit $failed